@@ -83,11 +83,13 @@ BuildRequires: backtrace-devel
 
 # External
 Requires: zeromq
+Requires: zlib
 Requires: python-cffi >= 1.6.0
 Requires: python-configobj
 
 BuildRequires: python-cffi >= 1.6.0
 BuildRequires: zeromq-devel
+BuildRequires: zlib-devel
 BuildRequires: gcc
 buildRequires: gcc-c++
 BuildRequires: net-snmp-devel
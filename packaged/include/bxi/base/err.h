@@ -240,6 +240,29 @@
  */
 #define bxierr_gen(...) bxierr_simple(BXIERR_GENERIC_CODE, __VA_ARGS__)
 
+/**
+ * Initializer of a preallocated error with the given code and constant message.
+ *
+ * Such an error requires no allocation and has no backtrace: it is meant for
+ * expected conditions on hot paths (EAGAIN, retries, ...) where the cost of
+ * bxierr_new() is not acceptable. It is used as any other error: bxierr_destroy()
+ * does nothing on it and private copies are chained instead (see bxierr_unshare()).
+ *
+ * Example:
+ *
+ *     static bxierr_s MY_AGAIN_ERR_S = BXIERR_STATIC_INIT(EAGAIN, "Try again");
+ *     ...
+ *     if (busy) return &MY_AGAIN_ERR_S;
+ *
+ * @see bxierr_unshare()
+ */
+#define BXIERR_STATIC_INIT(errcode, errmsg) {           \
+        .code = (errcode),                              \
+        .msg = (char *) (errmsg),                       \
+        .msg_len = sizeof(errmsg),                      \
+        .preallocated = true,                           \
+}
+
 /**
  * Define an error with the given code and the given error list.
  *
@@ -352,7 +375,8 @@ typedef struct bxierr_s * bxierr_p;
  */
 struct bxierr_s {
     int    code;                            //!< the error code
-    char * backtrace;                       //!< the backtrace
+    char * backtrace;                       //!< the backtrace, NULL until first
+                                            //!< required (see bxierr_get_backtrace())
     size_t backtrace_len;                   //!< the backtrace string length (including
                                             //!< the NULL terminating byte)
     void * data;                            //!< some data related to the error
@@ -364,6 +388,11 @@ struct bxierr_s {
     bxierr_p last_cause;                    //!< the initial cause valid only on the first error
     char * msg;                             //!< the message of the error
     size_t msg_len;                         //!< the length of the message
+    bool preallocated;                      //!< a static error, never freed
+                                            //!< nor modified (see BXIERR_STATIC_INIT())
+    int tid;                                //!< the thread that created the error
+    int addresses_nb;                       //!< number of raw backtrace addresses
+    void ** addresses;                      //!< the raw backtrace, symbolized on demand
 };
 
 
@@ -475,6 +504,35 @@ __attribute__ ((format (printf, 6, 7)))
 void bxierr_free(bxierr_p self);
 
 
+/**
+ * Return the human readable backtrace of the given error.
+ *
+ * Only raw addresses are recorded when an error is created: they are symbolized
+ * on the first call (bxierr_str() and reports call it). Symbols are cached per
+ * process, so errors created at the same place are cheap to report as well.
+ *
+ * @param[in] self the error
+ * @param[out] len the backtrace length (including the NULL terminating byte),
+ *             can be NULL
+ *
+ * @return the backtrace, owned by the error, NULL if the error has none
+ */
+char * bxierr_get_backtrace(bxierr_p self, size_t * len);
+
+
+/**
+ * Return an error that can be modified (chained): self unless it is a preallocated
+ * error, in which case a new mallocated copy is returned.
+ *
+ * @param[in] self the error
+ *
+ * @return self or a copy of self
+ *
+ * @see BXIERR_STATIC_INIT()
+ */
+bxierr_p bxierr_unshare(bxierr_p self);
+
+
 /**
  * Return the depth of the given error.
  *
@@ -730,18 +788,23 @@ inline void bxierr_chain(bxierr_p *err, const bxierr_p *tmp) {
             bxiassert(NULL != (*tmp));
 
             if (bxierr_isko((*tmp)) && bxierr_isko((*err))) {
-                bxiassert(*err != *tmp);
-                if (NULL != (*tmp)->cause) {
-                    bxiassert((*tmp)->last_cause->cause == NULL);
-                    (*tmp)->last_cause->cause = (*err);
+                bxiassert(*err != *tmp || (*tmp)->preallocated);
+                // Preallocated errors are shared: chain private copies instead
+                bxierr_p head = bxierr_unshare(*tmp);
+                bxierr_p cause = bxierr_unshare(*err);
+                if (NULL != head->cause) {
+                    bxiassert(head->last_cause->cause == NULL);
+                    head->last_cause->cause = cause;
                 } else {
-                    (*tmp)->cause = (*err);
+                    head->cause = cause;
                 }
-                if ((*err)->last_cause != NULL) {
-                    (*tmp)->last_cause = (*err)->last_cause;
+                if (cause->last_cause != NULL) {
+                    head->last_cause = cause->last_cause;
                 } else {
-                    (*tmp)->last_cause = (*err);
+                    head->last_cause = cause;
                 }
+                (*err) = head;
+                return;
             }
             (*err) = bxierr_isko((*tmp)) ? (*tmp) : (*err);
 }
@@ -228,6 +228,20 @@ bool bxilog_is_ready();
  */
 bxierr_p bxilog_flush(void);
 
+/**
+ * Replace the filters of a running handler.
+ *
+ * Handlers are not restarted: the given handler matches the records it has not
+ * processed yet against the new filters, then loggers are reconfigured accordingly.
+ *
+ * @param[in] handler_rank the rank of the handler in the configuration given to
+ *            bxilog_init(), that is the order of bxilog_config_add_handler() calls
+ * @param[in] filters the new filters, owned by the library from now on (even on error)
+ *
+ * @return BXIERR_OK on success, anything else is an error.
+ */
+bxierr_p bxilog_set_filters(size_t handler_rank, bxilog_filters_p filters);
+
 
 /**
  * Write the set of registered loggers along with the list of bxilog_level_e to
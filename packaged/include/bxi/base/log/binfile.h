@@ -0,0 +1,263 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_BINFILE_H_
+#define BXILOG_BINFILE_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/log/level.h"
+
+
+/**
+ * @file    binfile.h
+ * @authors Pierre Vignéras <pierre.vigneras@bull.net>
+ * @copyright 2013  Bull S.A.S.  -  All rights reserved.\n
+ *         This is not Free or Open Source software.\n
+ *         Please contact Bull SAS for details about its license.\n
+ *         Bull - Rue Jean Jaurès - B.P. 68 - 78340 Les Clayes-sous-Bois
+ * @brief  The Binary Log File Format and its Reader
+ *
+ * Files produced by ::BXILOG_FILE_HANDLER_BINARY are made of:
+ *
+ * - a file header (::bxilog_binfile_header_s), only when the file was empty
+ *   when opened;
+ * - a sequence of blocks, each one starting with a ::bxilog_binfile_block_s
+ *   header followed by its payload.
+ *
+ * The payload of a block is a sequence of entries, each one starting with a
+ * ::bxilog_binfile_entry_s header giving its type and its length, so unknown
+ * entry types can be skipped. Strings (program, file, function and logger names)
+ * are defined once per block by a ::BXILOG_BINFILE_STRING entry and referred to
+ * by their identifier in the ::BXILOG_BINFILE_RECORD entries that follow.
+ * Blocks are therefore self-contained: a file truncated by a crash or a corrupted
+ * block (detected by its checksum) only loses the related block.
+ *
+ * The payload of a block may be compressed (see ::BXILOG_BINFILE_ZLIB): each block
+ * is compressed independently so the file can still be read incrementally.
+ *
+ * All integers are in the byte order of the producer, as given by the file
+ * header byte order mark. No padding is ever inserted between entries.
+ *
+ * `bin/bxilog-parser` reads such files and renders the classic text format.
+ */
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+/**
+ * The file magic number.
+ */
+#define BXILOG_BINFILE_MAGIC "BXILOGB"
+
+/**
+ * The current version of the file format.
+ */
+#define BXILOG_BINFILE_VERSION 1
+
+/**
+ * The byte order mark as written by the producer.
+ */
+#define BXILOG_BINFILE_BOM 0x01020304
+
+/**
+ * The block magic number ("BXIB" when read as little endian bytes).
+ */
+#define BXILOG_BINFILE_BLOCK_MAGIC 0x42495842
+
+/**
+ * Block flags: the payload is a `uint32_t` giving the length of the
+ * decompressed payload followed by its raw deflate (RFC 1951) stream.
+ *
+ * The checksum applies to the payload as stored.
+ */
+#define BXILOG_BINFILE_ZLIB 0x1
+
+/**
+ * The error code returned when a file is not a binary log file.
+ */
+#define BXILOG_BINFILE_FORMAT_ERR 8105
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/**
+ * The file header.
+ */
+typedef struct {
+    char magic[8];                      //!< ::BXILOG_BINFILE_MAGIC (NULL terminated)
+    uint32_t bom;                       //!< ::BXILOG_BINFILE_BOM
+    uint16_t version;                   //!< ::BXILOG_BINFILE_VERSION
+    uint16_t header_size;               //!< sizeof(bxilog_binfile_header_s)
+} bxilog_binfile_header_s;
+
+/**
+ * The block header.
+ */
+typedef struct {
+    uint32_t magic;                     //!< ::BXILOG_BINFILE_BLOCK_MAGIC
+    uint32_t flags;                     //!< Payload encoding, 0 for raw entries
+                                        //!< (see ::BXILOG_BINFILE_ZLIB)
+    uint32_t payload_len;               //!< Number of bytes following this header
+    uint32_t crc32;                     //!< CRC-32 (IEEE, as zlib) of the payload
+    uint32_t records_nb;                //!< Number of records in the block
+} bxilog_binfile_block_s;
+
+/**
+ * The entry types.
+ */
+typedef enum {
+    BXILOG_BINFILE_STRING = 1,          //!< uint32_t id, followed by the string
+    BXILOG_BINFILE_RECORD = 2,          //!< bxilog_binfile_record_s, then the message
+} bxilog_binfile_entry_type_e;
+
+/**
+ * The entry header.
+ */
+typedef struct {
+    uint16_t type;                      //!< a ::bxilog_binfile_entry_type_e
+    uint16_t reserved;
+    uint32_t len;                       //!< Number of bytes following this header
+} bxilog_binfile_entry_s;
+
+/**
+ * The fixed part of a ::BXILOG_BINFILE_RECORD entry.
+ *
+ * The message follows (without its NULL terminating byte), it is made of
+ * the remaining bytes of the entry.
+ */
+typedef struct {
+    int64_t sec;                        //!< timestamp seconds (CLOCK_REALTIME)
+    uint64_t thread_rank;               //!< user thread rank
+    int32_t nsec;                       //!< timestamp nanoseconds
+    int32_t pid;                        //!< process pid
+    int32_t tid;                        //!< kernel thread id
+    int32_t line_nb;                    //!< line nb
+    uint32_t progname_id;               //!< program name string identifier
+    uint32_t filename_id;               //!< file name string identifier
+    uint32_t funcname_id;               //!< function name string identifier
+    uint32_t logname_id;                //!< logger name string identifier
+    uint32_t level;                     //!< a ::bxilog_level_e
+    uint32_t reserved;
+} bxilog_binfile_record_s;
+
+#ifndef BXICFFI
+BXIERR_CASSERT(binfile_header_size, 16 == sizeof(bxilog_binfile_header_s));
+BXIERR_CASSERT(binfile_block_size, 20 == sizeof(bxilog_binfile_block_s));
+BXIERR_CASSERT(binfile_entry_size, 8 == sizeof(bxilog_binfile_entry_s));
+BXIERR_CASSERT(binfile_record_size, 56 == sizeof(bxilog_binfile_record_s));
+#endif
+
+/**
+ * A record as returned by the reader.
+ *
+ * Strings are not NULL terminated, they remain valid until the next call to
+ * bxilog_binfile_next().
+ */
+typedef struct {
+    bxilog_level_e level;               //!< log level
+    struct timespec detail_time;        //!< log timestamp
+    pid_t pid;                          //!< process pid
+    pid_t tid;                          //!< kernel thread id
+    uintptr_t thread_rank;              //!< user thread rank
+    int line_nb;                        //!< line nb
+    const char * progname;              //!< program name
+    size_t progname_len;                //!< program name length
+    const char * filename;              //!< file name
+    size_t filename_len;                //!< file name length
+    const char * funcname;              //!< function name
+    size_t funcname_len;                //!< function name length
+    const char * logname;               //!< logger name
+    size_t logname_len;                 //!< logger name length
+    const char * logmsg;                //!< the log message (may hold several lines)
+    size_t logmsg_len;                  //!< the log message length
+} bxilog_binfile_entry_record_s;
+
+/**
+ * A binary log file reader.
+ */
+typedef struct bxilog_binfile_s bxilog_binfile_s;
+
+/**
+ * A binary log file reader object.
+ */
+typedef bxilog_binfile_s * bxilog_binfile_p;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interfaces        ****************************
+//*********************************************************************************
+
+/**
+ * Open the given binary log file for reading.
+ *
+ * @param[in] filename the binary log file name
+ * @param[out] result the reader
+ *
+ * @return BXIERR_OK on success, ::BXILOG_BINFILE_FORMAT_ERR if the file is not
+ *         a binary log file (or was produced with another byte order).
+ */
+bxierr_p bxilog_binfile_open(const char * filename, bxilog_binfile_p * result);
+
+/**
+ * Read the next record.
+ *
+ * Corrupted blocks are skipped (see bxilog_binfile_corrupted_nb()), a truncated
+ * last block or a zeroed tail (left by a crash in mmap mode) is considered as the
+ * end of file.
+ *
+ * @param[in] self the reader
+ * @param[out] record where the next record is stored
+ *
+ * @return true if a record has been read, false at the end of the file.
+ */
+bool bxilog_binfile_next(bxilog_binfile_p self, bxilog_binfile_entry_record_s * record);
+
+/**
+ * Return the number of corrupted blocks skipped so far.
+ *
+ * @param[in] self the reader
+ *
+ * @return the number of corrupted blocks skipped so far
+ */
+size_t bxilog_binfile_corrupted_nb(bxilog_binfile_p self);
+
+/**
+ * Close the given reader.
+ *
+ * @param[inout] self_p the reader, nullified on return
+ *
+ * @return BXIERR_OK on success, anything else on error.
+ */
+bxierr_p bxilog_binfile_close(bxilog_binfile_p * self_p);
+
+/**
+ * Compute the CRC-32 (IEEE 802.3, as zlib crc32()) of the given data.
+ *
+ * @param[in] crc the CRC of the previous data (0 for the first call)
+ * @param[in] data the data
+ * @param[in] len the data length
+ *
+ * @return the updated CRC
+ */
+uint32_t bxilog_binfile_crc32(uint32_t crc, const void * data, size_t len);
+
+#endif
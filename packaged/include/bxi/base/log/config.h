@@ -10,6 +10,7 @@
 
 #include "bxi/base/mem.h"
 #include "bxi/base/err.h"
+#include "bxi/base/time_source.h"
 
 #include "bxi/base/log/handler.h"
 
@@ -53,13 +54,29 @@
 // ********************************** Types   **************************************
 // *********************************************************************************
 
+/**
+ * The transport used by business code threads to send their logs to handlers.
+ */
+typedef enum {
+    BXILOG_TRANSPORT_ZMQ = 0,     //!< ZMQ PUSH/PULL zockets (default)
+    BXILOG_TRANSPORT_RING = 1,    //!< Per-thread lock-free rings swept by handlers
+} bxilog_transport_e;
+
 /**
  * The bxilog configuration structure.
  */
 typedef struct {
     int data_hwm;                               //!< ZMQ High Water Mark of data zocket
     int ctrl_hwm;                               //!< ZMQ High Water Mark of control zocket
+    bxilog_transport_e transport;               //!< The data transport to use
+    size_t ring_size;                           //!< Number of records per ring
+                                                //!< (BXILOG_TRANSPORT_RING only)
     size_t tsd_log_buf_size;                    //!< Size in bytes of the logging buffer
+    bool deferred_formatting;                   //!< When true, log messages are
+                                                //!< formatted by handler threads:
+                                                //!< format strings must then remain
+                                                //!< valid (string literals)
+    bxitime_source_e timestamp_source;          //!< The source of log timestamps
     size_t handlers_nb;                         //!< Number of logging handlers
     const char * progname;                      //!< Program name used by bxilog_init()
                                                 //!< to set the process name (on linux
@@ -28,6 +28,10 @@
  *
  * The console handler produces logs to the console, that is stdout and stderr
  * according to the level of a given log.
+ *
+ * Lines are written to the file descriptors directly (not through stdio) by
+ * batches: output of the program made with stdio is not ordered with logs
+ * unless flushed.
  */
 //*********************************************************************************
 //********************************** Defines **************************************
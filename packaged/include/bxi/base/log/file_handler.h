@@ -14,6 +14,10 @@
 #ifndef BXILOG_FILE_HANDLER_H_
 #define BXILOG_FILE_HANDLER_H_
 
+#ifndef BXICFFI
+#include <stdbool.h>
+#endif
+
 #include "bxi/base/err.h"
 #include "bxi/base/log.h"
 
@@ -28,6 +32,35 @@
  * @brief  The File Logging Handler
  *
  * The file handler writes logs to a file.
+ *
+ * By default, formatted logs are written with writev() (::BXILOG_FILE_HANDLER_IO_WRITE).
+ * For regular files, bxilog_file_handler_set_io() can request the
+ * ::BXILOG_FILE_HANDLER_IO_MMAP mode instead: the file is extended by segments which
+ * are mapped in memory and logs are formatted directly into the mapping.
+ *
+ * @note In mmap mode, a file must be written by a single process at a time and
+ *       the preallocated part of the last segment reads as zeros until the handler
+ *       exits, where the file is truncated to what has actually been logged.
+ *
+ * The file can also be rotated by the handler itself according to its size or to
+ * the wall clock (see bxilog_file_handler_set_rotation()): the current file is
+ * renamed with a timestamp suffix (e.g. `app.log.20140918T090752`) and a new file
+ * is opened under the original name. Rotated files can be compressed (gzip) in the
+ * background.
+ *
+ * Logs can also be compressed on the fly (see bxilog_file_handler_set_compression())
+ * by blocks which are independent of each other, so a file can be read back
+ * incrementally, even after a crash.
+ *
+ * By default, written logs are left in the page cache and the kernel decides when
+ * they reach the storage. Durability can be requested with
+ * bxilog_file_handler_set_durability(): periodically, on each flush and/or as soon
+ * as a record of a given level (or more important) has been written.
+ *
+ * A single file handler can also split logs over several files (see
+ * bxilog_file_handler_add_route() and bxilog_file_handler_set_main_filters()): each
+ * log is received once by the handler thread whatever the number of files it is
+ * written to.
  */
 //*********************************************************************************
 //********************************** Defines **************************************
@@ -37,6 +70,35 @@
 //********************************** Types ****************************************
 //*********************************************************************************
 
+/**
+ * How the file handler writes to its file.
+ */
+typedef enum {
+    BXILOG_FILE_HANDLER_IO_WRITE = 0,   //!< Buffers written with writev() (default)
+    BXILOG_FILE_HANDLER_IO_MMAP,        //!< Mapped segments (regular files only)
+} bxilog_file_handler_io_e;
+
+/**
+ * When data written in mmap mode is pushed to the storage with msync().
+ */
+typedef enum {
+    BXILOG_FILE_HANDLER_MSYNC_NONE = 0, //!< Left to the kernel
+    BXILOG_FILE_HANDLER_MSYNC_ASYNC,    //!< Scheduled on each flush (default)
+    BXILOG_FILE_HANDLER_MSYNC_SYNC,     //!< Waited for on each explicit flush
+} bxilog_file_handler_msync_e;
+
+/**
+ * When written logs are made durable with fdatasync().
+ *
+ * Whatever the policy, records at or above the level given to
+ * bxilog_file_handler_set_durability() are made durable without delay.
+ */
+typedef enum {
+    BXILOG_FILE_HANDLER_DURABILITY_NONE = 0,    //!< Left to the kernel (default)
+    BXILOG_FILE_HANDLER_DURABILITY_PERIODIC,    //!< At most once per period, and
+                                                //!< on each explicit flush
+    BXILOG_FILE_HANDLER_DURABILITY_FLUSH,       //!< On each flush
+} bxilog_file_handler_durability_e;
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
@@ -55,10 +117,20 @@
  *       are specified for appending/truncating the file respectively.
  */
 extern const bxilog_handler_p BXILOG_FILE_HANDLER;
+/**
+ * The Binary File Handler.
+ *
+ * It takes the same parameters than ::BXILOG_FILE_HANDLER but logs are written
+ * in the binary format described in bxi/base/log/binfile.h.
+ *
+ * Use `bxilog-parser` to render such a file in the classic text format.
+ */
+extern const bxilog_handler_p BXILOG_FILE_HANDLER_BINARY;
 extern const bxilog_handler_p BXILOG_FILE_HANDLER_STDIO;
 extern const char BXILOG_FILE_HANDLER_LOG_LEVEL_STR[];
 #else
 extern bxilog_handler_p BXILOG_FILE_HANDLER;
+extern bxilog_handler_p BXILOG_FILE_HANDLER_BINARY;
 extern bxilog_handler_p BXILOG_FILE_HANDLER_STDIO;
 extern char BXILOG_FILE_HANDLER_LOG_LEVEL_STR[];
 #endif
@@ -67,6 +139,119 @@ extern char BXILOG_FILE_HANDLER_LOG_LEVEL_STR[];
 //********************************** Interfaces        ****************************
 //*********************************************************************************
 
+/**
+ * Set how the file handler related to the given parameter writes to its file.
+ *
+ * It must be called before bxilog_init(). If the file is not a regular file or
+ * cannot be mapped, the ::BXILOG_FILE_HANDLER_IO_WRITE mode is used.
+ *
+ * @param[in] param a parameter of ::BXILOG_FILE_HANDLER or
+ *            ::BXILOG_FILE_HANDLER_BINARY (see bxilog_config_p.handlers_params)
+ * @param[in] io the I/O mode
+ * @param[in] msync the msync() policy (mmap mode only)
+ */
+void bxilog_file_handler_set_io(bxilog_handler_param_p param,
+                                bxilog_file_handler_io_e io,
+                                bxilog_file_handler_msync_e msync);
+
+/**
+ * Set when the file handler related to the given parameter rotates its file.
+ *
+ * It must be called before bxilog_init(). Rotation only applies to regular files
+ * given by their name. A record is never split over two files: the rotation occurs
+ * before the first record that follows the triggering condition.
+ *
+ * @param[in] param a parameter of ::BXILOG_FILE_HANDLER or
+ *            ::BXILOG_FILE_HANDLER_BINARY (see bxilog_config_p.handlers_params)
+ * @param[in] max_size the file is rotated once it reaches this size in bytes,
+ *            0 for no size based rotation
+ * @param[in] interval the file is rotated when the wall clock reaches a multiple
+ *            of this number of seconds since the Epoch (e.g. 3600 for every
+ *            hour), 0 for no time based rotation
+ * @param[in] compress if true, rotated files are compressed (gzip) by a low
+ *            priority thread and get the `.gz` suffix
+ */
+void bxilog_file_handler_set_rotation(bxilog_handler_param_p param,
+                                      size_t max_size,
+                                      size_t interval,
+                                      bool compress);
+
+/**
+ * Set the compression level of the file handler related to the given parameter.
+ *
+ * It must be called before bxilog_init(). With ::BXILOG_FILE_HANDLER, each written
+ * buffer becomes a gzip member: the file is a regular gzip file (e.g. for `zcat`)
+ * and the ::BXILOG_FILE_HANDLER_IO_MMAP mode is not used. With
+ * ::BXILOG_FILE_HANDLER_BINARY, blocks are compressed (see ::BXILOG_BINFILE_ZLIB).
+ * Rotated files are not compressed again and rotation sizes apply to the logs
+ * before compression.
+ *
+ * @note a compressed text file should not be appended to an uncompressed one.
+ *
+ * @param[in] param a parameter of ::BXILOG_FILE_HANDLER or
+ *            ::BXILOG_FILE_HANDLER_BINARY (see bxilog_config_p.handlers_params)
+ * @param[in] level the zlib compression level, from 1 (fastest) to 9 (best),
+ *            0 for no compression (default)
+ */
+void bxilog_file_handler_set_compression(bxilog_handler_param_p param, int level);
+
+/**
+ * Set when the file handler related to the given parameter makes its logs durable.
+ *
+ * It must be called before bxilog_init(). Synchronizations requested while one is
+ * in progress are done by a single fdatasync() (group commit), by the I/O helper
+ * thread when there is one. An explicit flush (bxilog_flush()) returns once logs
+ * are durable, unless the policy is ::BXILOG_FILE_HANDLER_DURABILITY_NONE.
+ *
+ * @param[in] param a parameter of ::BXILOG_FILE_HANDLER or
+ *            ::BXILOG_FILE_HANDLER_BINARY (see bxilog_config_p.handlers_params)
+ * @param[in] durability the durability policy
+ * @param[in] period_ms the minimum period between two synchronizations in
+ *            milliseconds (::BXILOG_FILE_HANDLER_DURABILITY_PERIODIC only); note
+ *            that they occur on implicit flushes (see bxilog_handler_param_s)
+ * @param[in] sync_level records of this level or more important are made durable
+ *            once written, ::BXILOG_OFF for none
+ */
+void bxilog_file_handler_set_durability(bxilog_handler_param_p param,
+                                        bxilog_file_handler_durability_e durability,
+                                        long period_ms,
+                                        bxilog_level_e sync_level);
+
+/**
+ * Add a file to the file handler related to the given parameter.
+ *
+ * It must be called before bxilog_init(). Logs accepted by the handler filters
+ * are written to each route whose filters also accept them (e.g. errors to a
+ * dedicated file), and to the main file unless its own filters reject them (see
+ * bxilog_file_handler_set_main_filters()). All settings of the main file (I/O mode,
+ * rotation, compression, durability) apply to the routes as well.
+ *
+ * @note the handler filters must accept everything needed by the files.
+ *
+ * @param[in] param a parameter of ::BXILOG_FILE_HANDLER or
+ *            ::BXILOG_FILE_HANDLER_BINARY (see bxilog_config_p.handlers_params)
+ * @param[in] filters the route filters (owned by the handler from now on)
+ * @param[in] filename the route file, opened with the same flags as the main file
+ */
+void bxilog_file_handler_add_route(bxilog_handler_param_p param,
+                                   bxilog_filters_p filters,
+                                   const char * filename);
+
+/**
+ * Restrict the main file of the file handler related to the given parameter.
+ *
+ * It must be called before bxilog_init(). By default, the main file receives all
+ * logs accepted by the handler filters. With routes (see
+ * bxilog_file_handler_add_route()), this keeps their logs out of the main file,
+ * e.g. a subsystem logging to its own file only. ::BXILOG_FILTERS_ALL_OFF leaves
+ * the main file empty.
+ *
+ * @param[in] param a parameter of ::BXILOG_FILE_HANDLER or
+ *            ::BXILOG_FILE_HANDLER_BINARY (see bxilog_config_p.handlers_params)
+ * @param[in] filters the main file filters (owned by the handler from now on)
+ */
+void bxilog_file_handler_set_main_filters(bxilog_handler_param_p param,
+                                          bxilog_filters_p filters);
 
 #endif
 
@@ -53,6 +53,11 @@
  */
 #define BXILOG_TOO_MANY_IERR 700471322     // Leet code  for TOO .A.7 IERR
 
+/**
+ * Maximum number of records given at once to bxilog_handler_s.process_log_batch()
+ */
+#define BXILOG_HANDLER_BATCH_MAX 64
+
 #if defined(__x86_64__)  || defined(__aarch64__)
 #define TIMESPEC_SIZE 16
 #elif defined(__i386__) || defined(__arm__)
@@ -104,6 +109,34 @@ typedef struct {
  */
 typedef bxilog_record_s * bxilog_record_p;
 
+/**
+ * A log as given to bxilog_handler_s.process_log_batch(): the record and its
+ * strings (which do not necessarily follow the record in memory).
+ */
+typedef struct {
+    bxilog_record_p record;             //!< the logging record
+    char * filename;                    //!< the filename
+    char * funcname;                    //!< the function name
+    char * loggername;                  //!< the logger name
+    char * logmsg;                      //!< the actual log message
+} bxilog_batch_record_s;
+
+/**
+ * What to do with a log when the handler queue is full.
+ *
+ * @see bxilog_handler_param_s.overflow_policy
+ */
+typedef enum {
+    BXILOG_OVERFLOW_BLOCK=0,            //!< Block the logging thread until there is room
+    BXILOG_OVERFLOW_DROP_NEWEST=1,      //!< Drop the log being produced
+    BXILOG_OVERFLOW_DROP_OLDEST=2,      //!< Drop the oldest queued log to make room
+                                        //!< (same as BXILOG_OVERFLOW_DROP_NEWEST with
+                                        //!< the zmq transport)
+    BXILOG_OVERFLOW_DROP_BELOW=3,       //!< Drop the log if its level is less important
+                                        //!< than overflow_level, block otherwise
+    BXILOG_OVERFLOW_SPILL=4,            //!< Write the log to overflow_file instead
+} bxilog_overflow_policy_e;
+
 typedef enum {
     BXI_LOG_HANDLER_NOT_READY=0,
     BXI_LOG_HANDLER_READY=1,
@@ -133,6 +166,13 @@ struct bxilog_handler_param_s {
     size_t ierr_max;                    //!< Maximal number of internal errors before
                                         //!< exiting
     long flush_freq_ms;                 //!< Implicit flush frequency
+    bxilog_overflow_policy_e overflow_policy; //!< What to do when the queue is full
+    bxilog_level_e overflow_level;      //!< Used by BXILOG_OVERFLOW_DROP_BELOW
+    char * overflow_file;               //!< Used by BXILOG_OVERFLOW_SPILL
+    int overflow_fd;                    //!< The opened overflow_file (internal)
+    size_t overflow_writers_nb;         //!< Threads writing to overflow_fd (internal)
+    size_t dropped_nb;                  //!< Number of dropped logs (exact)
+    size_t spilled_nb;                  //!< Number of logs written to overflow_file
     char * data_url;                    //!< The data zocket URL
     char * ctrl_url;                    //!< The control zocket URL
     bxilog_filters_p filters;           //!< The filters
@@ -204,6 +244,8 @@ struct bxilog_handler_s_f {
      * send it to another process such as syslog, or even send it to another logging
      * backend such as netsnmp-log.
      *
+     * This function is not used when process_log_batch() is defined.
+     *
      * @param[in] record a logging record
      * @param[in] filename the filename
      * @param[in] funcname the function name
@@ -239,6 +281,8 @@ struct bxilog_handler_s_f {
      */
     bxierr_p (*process_exit)(bxilog_handler_param_p param);
     /**
+     * Called when the handler filters have been replaced by bxilog_set_filters().
+     *
      * @param[in] param the log handler parameter as returned by param_new()
      */
     bxierr_p (*process_cfg)(bxilog_handler_param_p param);
@@ -247,6 +291,25 @@ struct bxilog_handler_s_f {
      * @param[in] param the log handler parameter as returned by param_new()
      */
     bxierr_p (*param_destroy)(bxilog_handler_param_p* param);
+
+    /**
+     * Process a batch of logs at once (optional).
+     *
+     * When defined, this function is used instead of process_log(): logs accepted
+     * by the handler filters are accumulated and given by batches of at most
+     * BXILOG_HANDLER_BATCH_MAX logs, so the handler can amortize its processing
+     * (I/O for example) over the whole batch. A batch never spans more than
+     * one wakeup of the handler: it is always processed before any flush.
+     *
+     * Records and strings are only valid during the call.
+     *
+     * @param[in] records the logs to process
+     * @param[in] n the number of logs in records
+     * @param[in] param the log handler parameter as returned by param_new()
+     */
+    bxierr_p (*process_log_batch)(bxilog_batch_record_s * records,
+                                  size_t n,
+                                  bxilog_handler_param_p param);
 };
 
 
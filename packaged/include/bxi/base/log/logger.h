@@ -5,6 +5,7 @@
 
 #ifndef BXICFFI
 #include <stdbool.h>
+#include <stdint.h>
 #endif
 
 
@@ -32,54 +33,58 @@
 // *********************************************************************************
 // ********************************** Defines **************************************
 // *********************************************************************************
+/**
+ * Number of log levels, from `BXILOG_OFF` to `BXILOG_LOWEST`
+ */
+#define BXILOG_LOGGER_LEVELS_NB 13
 /**
  * Produce a log at the `BXILOG_LOWEST` level
  */
-#define LOWEST(logger, ...) bxilog_logger_log(logger, BXILOG_LOWEST, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__);
+#define LOWEST(logger, ...) bxilog_logger_log_site(logger, BXILOG_LOWEST, __VA_ARGS__);
 /**
  * Produce a log at the `BXILOG_TRACE` level
  */
-#define TRACE(logger, ...) bxilog_logger_log(logger, BXILOG_TRACE, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__);
+#define TRACE(logger, ...) bxilog_logger_log_site(logger, BXILOG_TRACE, __VA_ARGS__);
 /**
  * Produce a log at the `BXILOG_FINE` level
  */
-#define FINE(logger, ...) bxilog_logger_log(logger, BXILOG_FINE, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define FINE(logger, ...) bxilog_logger_log_site(logger, BXILOG_FINE, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_DEBUG` level
  */
-#define DEBUG(logger, ...) bxilog_logger_log(logger, BXILOG_DEBUG, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define DEBUG(logger, ...) bxilog_logger_log_site(logger, BXILOG_DEBUG, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_INFO` level
  */
-#define INFO(logger, ...)  bxilog_logger_log(logger, BXILOG_INFO, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define INFO(logger, ...)  bxilog_logger_log_site(logger, BXILOG_INFO, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_OUTPUT` level
  */
-#define OUT(logger, ...)   bxilog_logger_log(logger, BXILOG_OUTPUT, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define OUT(logger, ...)   bxilog_logger_log_site(logger, BXILOG_OUTPUT, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_NOTICE` level
  */
-#define NOTICE(logger, ...)  bxilog_logger_log(logger, BXILOG_NOTICE, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define NOTICE(logger, ...)  bxilog_logger_log_site(logger, BXILOG_NOTICE, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_WARNING` level
  */
-#define WARNING(logger, ...)  bxilog_logger_log(logger, BXILOG_WARNING, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define WARNING(logger, ...)  bxilog_logger_log_site(logger, BXILOG_WARNING, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_ERROR` level
  */
-#define ERROR(logger, ...)   bxilog_logger_log(logger, BXILOG_ERROR, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define ERROR(logger, ...)   bxilog_logger_log_site(logger, BXILOG_ERROR, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_CRITICAL` level
  */
-#define CRITICAL(logger, ...)  bxilog_logger_log(logger, BXILOG_CRITICAL, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define CRITICAL(logger, ...)  bxilog_logger_log_site(logger, BXILOG_CRITICAL, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_ALERT` level
  */
-#define ALERT(logger, ...)  bxilog_logger_log(logger, BXILOG_ALERT, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define ALERT(logger, ...)  bxilog_logger_log_site(logger, BXILOG_ALERT, __VA_ARGS__)
 /**
  * Produce a log at the `BXILOG_PANIC` level
  */
-#define PANIC(logger, ...)  bxilog_logger_log(logger, BXILOG_PANIC, (char *)__FILE__, ARRAYLEN(__FILE__), __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
+#define PANIC(logger, ...)  bxilog_logger_log_site(logger, BXILOG_PANIC, __VA_ARGS__)
 
 
 
@@ -102,6 +107,94 @@
         }                                                                               \
     } while(false);
 
+/**
+ * Initializer of a static call-site descriptor bxilog_site_s at the given level.
+ */
+#define BXILOG_SITE_INIT(lvl) { (char *)__FILE__, ARRAYLEN(__FILE__),               \
+                                __func__, ARRAYLEN(__func__),                        \
+                                __LINE__, (lvl), NULL, 0, 0 }
+
+/**
+ * Create a log using the given logger at the given level, from a static
+ * call-site descriptor.
+ *
+ * The source location is stored once per call site instead of being copied into
+ * each log record.
+ *
+ * @see bxilog_site_s
+ * @see `bxilog_logger_log_site_nolevelcheck()`
+ */
+#define bxilog_logger_log_site(logger, lvl, ...) do {                                   \
+        static bxilog_site_s __bxilog_site__ = BXILOG_SITE_INIT(lvl);                   \
+        if (bxilog_logger_is_enabled_for((logger), (lvl))) {                            \
+            bxierr_p __err__ = bxilog_logger_log_site_nolevelcheck((logger),            \
+                                                                   &__bxilog_site__,    \
+                                                                   __VA_ARGS__);        \
+            if (bxierr_isko(__err__)) {                                                 \
+                bxierr_report(&__err__, STDOUT_FILENO);                                 \
+            }                                                                           \
+        }                                                                               \
+    } while(false)
+
+/**
+ * Initializer of a static rate limiter bxilog_limit_s.
+ */
+#define BXILOG_LIMIT_INIT(policy, rate, burst) { (policy), (rate), (burst), 0, 0 }
+
+/**
+ * Create a log using the given logger at the given level, unless the given call
+ * site rate limiter suppresses it.
+ *
+ * The limiter is checked before the message is formatted: suppressed logs cost an
+ * atomic operation. Once a log is emitted again, it is preceded by a log with the
+ * number of logs suppressed meanwhile.
+ *
+ * @see bxilog_limit_policy_e
+ * @see bxilog_limit_allow()
+ */
+#define bxilog_logger_log_limit(logger, lvl, policy, rate, burst, ...) do {             \
+        static bxilog_site_s __bxilog_site__ = BXILOG_SITE_INIT(lvl);                   \
+        static bxilog_limit_s __bxilog_limit__ = BXILOG_LIMIT_INIT((policy),            \
+                                                                   (rate), (burst));    \
+        size_t __suppressed__;                                                          \
+        if (bxilog_logger_is_enabled_for((logger), (lvl))                               \
+            && bxilog_limit_allow(&__bxilog_limit__, &__suppressed__)) {                \
+            bxierr_p __err__ = BXIERR_OK;                                               \
+            if (0 < __suppressed__) {                                                   \
+                __err__ = bxilog_logger_log_site_nolevelcheck((logger),                 \
+                                                              &__bxilog_site__,         \
+                                                              "%zu similar logs "       \
+                                                              "suppressed",             \
+                                                              __suppressed__);          \
+            }                                                                           \
+            if (bxierr_isok(__err__)) {                                                 \
+                __err__ = bxilog_logger_log_site_nolevelcheck((logger),                 \
+                                                              &__bxilog_site__,         \
+                                                              __VA_ARGS__);             \
+            }                                                                           \
+            if (bxierr_isko(__err__)) {                                                 \
+                bxierr_report(&__err__, STDOUT_FILENO);                                 \
+            }                                                                           \
+        }                                                                               \
+    } while(false)
+
+/**
+ * Produce at most `n` logs per second at the given level from the call site
+ */
+#define BXILOG_LIMIT(logger, lvl, n, ...) \
+    bxilog_logger_log_limit(logger, lvl, BXILOG_LIMIT_PER_SECOND, n, 0, __VA_ARGS__)
+/**
+ * Produce one log out of `k` at the given level from the call site
+ */
+#define BXILOG_SAMPLE(logger, lvl, k, ...) \
+    bxilog_logger_log_limit(logger, lvl, BXILOG_LIMIT_SAMPLE, k, 0, __VA_ARGS__)
+/**
+ * Produce `rate` logs per second on average at the given level from the call site,
+ * with bursts of at most `burst` logs
+ */
+#define BXILOG_BURST(logger, lvl, rate, burst, ...) \
+    bxilog_logger_log_limit(logger, lvl, BXILOG_LIMIT_BUCKET, rate, burst, __VA_ARGS__)
+
 
 /**
  * Defines a new logger as a global variable
@@ -114,7 +207,8 @@
                                         false, \
                                         logger_name,\
                                         ARRAYLEN(logger_name),\
-                                        BXILOG_LOWEST\
+                                        BXILOG_LOWEST,\
+                                        {0}\
     };\
     static bxilog_logger_p const variable_name = &variable_name ## _s;\
     static __attribute__((constructor)) void __bxilog_register_log__ ## variable_name(void) {\
@@ -166,8 +260,14 @@ struct bxilog_logger_s {
     const char * name;              //!< Logger name
     size_t name_length;             //!< Logger name length, including NULL ending byte
     bxilog_level_e level;           //!< Logger level
+    uint64_t handlers[BXILOG_LOGGER_LEVELS_NB]; //!< Per level, the handlers accepting
+                                                //!< its logs (bit i for handler i)
 };
 
+#ifndef BXICFFI
+BXIERR_CASSERT(logger_levels_nb, BXILOG_LOWEST + 1 == BXILOG_LOGGER_LEVELS_NB);
+#endif
+
 
 /**
  * A logger "object".
@@ -177,6 +277,64 @@ struct bxilog_logger_s {
  */
 typedef struct bxilog_logger_s * bxilog_logger_p;
 
+/**
+ * A static descriptor of a logging call site.
+ *
+ * One such descriptor is emitted by each use of the logging macros (`DEBUG()`,
+ * `INFO()`, ...). Log records refer to it instead of holding a copy of the
+ * source location. The last fields are resolved once by handlers, on the first
+ * log produced by the call site.
+ *
+ * @see BXILOG_SITE_INIT()
+ */
+typedef struct bxilog_site_s {
+    const char * fullfilename;      //!< Source file name (__FILE__)
+    size_t fullfilename_len;        //!< Including the NULL terminating byte
+    const char * funcname;          //!< Function name (__func__)
+    size_t funcname_len;            //!< Including the NULL terminating byte
+    int line;                       //!< Line number
+    bxilog_level_e level;           //!< Log level
+    const char * filename;          //!< Basename of fullfilename (resolved)
+    size_t filename_len;            //!< Including the NULL terminating byte (resolved)
+    uint32_t id;                    //!< Unique call site identifier (resolved),
+                                    //!< 0 when not yet resolved
+} bxilog_site_s;
+
+/**
+ * A call site descriptor.
+ */
+typedef bxilog_site_s * bxilog_site_p;
+
+/**
+ * How a rate limiter bxilog_limit_s suppresses logs.
+ */
+typedef enum {
+    BXILOG_LIMIT_PER_SECOND,        //!< At most `rate` logs per second
+    BXILOG_LIMIT_SAMPLE,            //!< One log out of `rate`, suppressed ones are
+                                    //!< not reported
+    BXILOG_LIMIT_BUCKET,            //!< Token bucket: `rate` logs per second on average,
+                                    //!< bursts of `burst` logs
+} bxilog_limit_policy_e;
+
+/**
+ * A static rate limiter of a logging call site, updated without lock.
+ *
+ * @see BXILOG_LIMIT_INIT()
+ * @see bxilog_logger_log_limit()
+ */
+typedef struct bxilog_limit_s {
+    bxilog_limit_policy_e policy;   //!< How logs are suppressed
+    uint32_t rate;                  //!< See bxilog_limit_policy_e
+    uint32_t burst;                 //!< See bxilog_limit_policy_e
+    uint64_t state;                 //!< Current window, count or next arrival time
+    uint64_t suppressed;            //!< Logs suppressed since the last one allowed
+} bxilog_limit_s;
+
+/**
+ * A call site rate limiter.
+ */
+typedef bxilog_limit_s * bxilog_limit_p;
+
 
 // *********************************************************************************
 // ********************************** Global Variables *****************************
@@ -274,6 +432,30 @@ bxierr_p bxilog_logger_log_nolevelcheck(const bxilog_logger_p logger, const bxil
                                         ;
 
 
+/**
+ * Create a log unconditionally from a static call-site descriptor. This is used by
+ * macros defined above that already check the logger level.
+ *
+ * The site must remain valid for the whole program life (it is usually static,
+ * see `bxilog_logger_log_site()`).
+ *
+ * @param[in] logger the logger to perform the log with
+ * @param[in] site the call site the log comes from
+ * @param[in] fmt the printf like format of the message
+ *
+ * @return BXIERR_OK on success, any other value is an error
+ *
+ * @see bxilog_logger_log_site()
+ * @see bxierr_p
+ */
+bxierr_p bxilog_logger_log_site_nolevelcheck(const bxilog_logger_p logger,
+                                             bxilog_site_p site,
+                                             const char * fmt, ...)
+#ifndef BXICFFI
+                                        __attribute__ ((format (printf, 3, 4)))
+#endif
+                                        ;
+
 #ifndef BXICFFI
 /**
  * Equivalent to `bxilog_log_nolevelcheck()` but with a va_list instead of
@@ -297,8 +479,37 @@ bxierr_p bxilog_logger_vlog_nolevelcheck(const bxilog_logger_p logger, const bxi
                                          const char * funcname, size_t funcname_len,
                                          const int line,
                                          const char * fmt, va_list arglist);
+
+/**
+ * Equivalent to `bxilog_logger_log_site_nolevelcheck()` but with a va_list instead
+ * of a variable number of arguments.
+ *
+ * @param[in] logger the logger to perform the log with
+ * @param[in] site the call site the log comes from
+ * @param[in] fmt the printf like format of the message
+ * @param[in] arglist the va_list of all parameters for the given format string 'fmt'
+ *
+ * @return BXIERR_OK on success, any other value is an error
+ * @see bxilog_logger_log_site_nolevelcheck
+ */
+bxierr_p bxilog_logger_vlog_site_nolevelcheck(const bxilog_logger_p logger,
+                                              bxilog_site_p site,
+                                              const char * fmt, va_list arglist);
 #endif
 
+/**
+ * Return true if the given rate limiter allows a new log now.
+ *
+ * @param[inout] limit the rate limiter of the call site
+ * @param[out] suppressed the number of logs suppressed since the last one allowed,
+ *             only set when true is returned
+ *
+ * @return true if the log must be produced, false if it is suppressed
+ *
+ * @see bxilog_logger_log_limit()
+ */
+bool bxilog_limit_allow(bxilog_limit_p limit, size_t * suppressed);
+
 /**
  * Get the log level of the given logger
  *
@@ -25,6 +25,13 @@
 
 #define BXILOG_REMOTE_HANDLER_RECORD_HEADER "level/"
 #define BXILOG_REMOTE_HANDLER_EXITING_HEADER ".ctrl/exit"
+/**
+ * Header of a compressed block of records (see bxilog_remote_handler_set_compression()).
+ *
+ * It is followed by two frames: the `uint32_t` size of the decompressed block and
+ * the raw deflate (RFC 1951) stream of the concatenated records.
+ */
+#define BXILOG_REMOTE_HANDLER_BLOCK_HEADER "block/"
 #define BXILOG_REMOTE_HANDLER_CFG_CMD "get-config"
 
 #define BXILOG_REMOTE_HANDLER_URLS "URLs?"
@@ -65,5 +72,21 @@ extern bxilog_handler_p BXILOG_REMOTE_HANDLER;
 //********************************  Interfaces  ***********************************
 //*********************************************************************************
 
+/**
+ * Set the compression level of the remote handler related to the given parameter.
+ *
+ * It must be called before bxilog_init(). When compression is enabled, records are
+ * sent by compressed blocks (see ::BXILOG_REMOTE_HANDLER_BLOCK_HEADER) on each flush
+ * or once enough records have been gathered. Since blocks may mix log levels,
+ * subscribers can't filter them by level: ::BXILOG_REMOTE_HANDLER_BLOCK_HEADER
+ * must be subscribed to.
+ *
+ * @param[in] param a parameter of ::BXILOG_REMOTE_HANDLER
+ *            (see bxilog_config_p.handlers_params)
+ * @param[in] level the zlib compression level, from 1 (fastest) to 9 (best),
+ *            0 for no compression (default)
+ */
+void bxilog_remote_handler_set_compression(bxilog_handler_param_p param, int level);
+
 
 #endif
@@ -26,15 +26,37 @@
  * @brief  The Syslog Logging Handler
  *
  * The syslog handler writes logs to syslog (see: man 3 syslog).
+ *
+ * In its native mode (see bxilog_syslog_handler_set_native()), the handler does
+ * not use syslog(3): messages are formatted directly from records as specified by
+ * RFC 3164 or RFC 5424 and sent to the syslog daemon socket in batches with
+ * sendmmsg(). Messages the daemon can't receive yet are kept in a bounded buffer
+ * so a slow daemon does not slow the handler thread down.
  */
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
 
+/**
+ * The maximum size of a message sent in native mode (including its header).
+ *
+ * @see bxilog_syslog_handler_set_native()
+ */
+#define BXILOG_SYSLOG_HANDLER_MSG_MAX 2048
+
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
 
+/**
+ * How the syslog handler formats and sends its messages.
+ */
+typedef enum {
+    BXILOG_SYSLOG_HANDLER_LIBC = 0,     //!< syslog(3) is used (default)
+    BXILOG_SYSLOG_HANDLER_RFC3164,      //!< Native mode, BSD syslog format
+    BXILOG_SYSLOG_HANDLER_RFC5424,      //!< Native mode, IETF syslog format
+} bxilog_syslog_handler_format_e;
+
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
@@ -60,6 +82,34 @@ extern bxilog_handler_p BXILOG_SYSLOG_HANDLER;
 //********************************** Interfaces        ****************************
 //*********************************************************************************
 
+/**
+ * Set how the syslog handler related to the given parameter sends its messages.
+ *
+ * It must be called before bxilog_init(). In native mode, each line of a log is
+ * sent as a single datagram to the given unix socket, with the facility and
+ * the identity given to ::BXILOG_SYSLOG_HANDLER. The process id is always
+ * given with ::BXILOG_SYSLOG_HANDLER_RFC5424, only with `LOG_PID` otherwise.
+ * Other openlog() options are not supported in native mode.
+ *
+ * When the daemon does not keep up, messages are kept until `pending_max` of
+ * them are waiting, next ones are dropped and their number is reported once
+ * the daemon receives messages again. An explicit flush (bxilog_flush()) and
+ * bxilog_finalize() wait a bounded time for the daemon.
+ *
+ * @note messages longer than ::BXILOG_SYSLOG_HANDLER_MSG_MAX bytes are truncated
+ *
+ * @param[in] param a parameter of ::BXILOG_SYSLOG_HANDLER
+ *            (see bxilog_config_p.handlers_params)
+ * @param[in] format the message format, ::BXILOG_SYSLOG_HANDLER_LIBC to use syslog(3)
+ * @param[in] path the unix datagram socket of the daemon, NULL for `/dev/log`
+ * @param[in] pending_max the maximum number of messages waiting for the daemon,
+ *            0 for the default (1024)
+ */
+void bxilog_syslog_handler_set_native(bxilog_handler_param_p param,
+                                      bxilog_syslog_handler_format_e format,
+                                      const char * path,
+                                      size_t pending_max);
+
 
 #endif
 
@@ -16,9 +16,11 @@
 
 #ifndef BXICFFI
 #include <time.h>
+#include <stdint.h>
 #endif
 
 #include "bxi/base/err.h"
+#include "bxi/base/time_source.h"
 
 
 /**
@@ -38,6 +40,22 @@
 // ********************************** Types   **************************************
 // *********************************************************************************
 
+/**
+ * The calibration of the CPU timestamp counter against the wall clock time.
+ *
+ * @see bxitime_tsc_calibrate()
+ */
+typedef struct {
+    uint64_t ticks;                     //!< Counter value at calibration time
+    int64_t time_ns;                    //!< CLOCK_REALTIME at calibration time (ns)
+    double ns_per_tick;                 //!< Counter period in nanoseconds
+} bxitime_tsc_calib_s;
+
+/**
+ * A CPU timestamp counter calibration.
+ */
+typedef bxitime_tsc_calib_s * bxitime_tsc_calib_p;
+
 
 // *********************************************************************************
 // ********************************** Global Variables *****************************
@@ -131,6 +149,93 @@ bxierr_p bxitime_duration(clockid_t clk_id,
  */
 bxierr_p bxitime_str(struct timespec * time, char ** result);
 
+/**
+ * Calibrate the CPU timestamp counter against CLOCK_REALTIME.
+ *
+ * This takes about 10 milliseconds. The calibration is a snapshot: later
+ * adjustments of the wall clock (NTP for example) are not followed.
+ *
+ * @param[out] calib the calibration to fill
+ *
+ * @return BXIERR_OK on success
+ */
+bxierr_p bxitime_tsc_calibrate(bxitime_tsc_calib_p calib);
+
+/**
+ * Convert the given CPU timestamp counter value to wall clock time.
+ *
+ * @param[in] calib the calibration to use
+ * @param[in] ticks the counter value as returned by bxitime_tsc_read()
+ * @param[out] time the timespec data structure to fill with the result
+ */
+void bxitime_tsc_to_timespec(const bxitime_tsc_calib_s * calib,
+                             uint64_t ticks,
+                             struct timespec * time);
+
+/**
+ * Read the CPU timestamp counter.
+ *
+ * On architectures without a known counter, CLOCK_MONOTONIC in nanoseconds is
+ * returned instead: bxitime_tsc_calibrate() and bxitime_tsc_to_timespec() still apply.
+ *
+ * @return the current counter value
+ */
+#ifndef BXICFFI
+inline uint64_t bxitime_tsc_read(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t) hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+#endif
+}
+#else
+uint64_t bxitime_tsc_read(void);
+#endif
+
+/**
+ * Get the current wall clock time from the given source, without error handling.
+ *
+ * This is the fast path version of bxitime_get(CLOCK_REALTIME, time), meant to be
+ * called at very high rates (logging for example).
+ *
+ * @param[in] source the timestamp source
+ * @param[in] calib the calibration to use for BXITIME_SOURCE_TSC (NULL otherwise)
+ * @param[out] time the timespec data structure to fill with the result
+ *
+ * @see bxitime_source_e
+ */
+#ifndef BXICFFI
+inline void bxitime_fast_get(const bxitime_source_e source,
+                             const bxitime_tsc_calib_s * const calib,
+                             struct timespec * const time) {
+    switch (source) {
+#ifdef CLOCK_REALTIME_COARSE
+        case BXITIME_SOURCE_REALTIME_COARSE:
+            clock_gettime(CLOCK_REALTIME_COARSE, time);
+            break;
+#endif
+        case BXITIME_SOURCE_TSC:
+            bxitime_tsc_to_timespec(calib, bxitime_tsc_read(), time);
+            break;
+        default:
+            clock_gettime(CLOCK_REALTIME, time);
+            break;
+    }
+}
+#else
+void bxitime_fast_get(const bxitime_source_e source,
+                      const bxitime_tsc_calib_s * const calib,
+                      struct timespec * const time);
+#endif
+
 
 /**
  * Return an ISO8601 string for representing the given duration.
@@ -0,0 +1,53 @@
+/* -*- coding: utf-8 -*-  */
+
+#ifndef BXITIME_SOURCE_H_
+#define BXITIME_SOURCE_H_
+
+#ifndef BXICFFI
+
+#endif
+
+
+/**
+ * @file    time_source.h
+ * @authors Pierre Vignéras <pierre.vigneras@bull.net>
+ * @copyright 2013  Bull S.A.S.  -  All rights reserved.\n
+ *         This is not Free or Open Source software.\n
+ *         Please contact Bull SAS for details about its license.\n
+ *         Bull - Rue Jean Jaurès - B.P. 68 - 78340 Les Clayes-sous-Bois
+ * @brief  Timestamp sources
+ *
+ * Kept apart from time.h so that it can be parsed by cffi.
+ *
+ */
+
+// *********************************************************************************
+// ********************************** Defines **************************************
+// *********************************************************************************
+
+// *********************************************************************************
+// ********************************** Types   **************************************
+// *********************************************************************************
+
+/**
+ * The source of a timestamp.
+ *
+ * @see bxitime_fast_get()
+ */
+typedef enum {
+    BXITIME_SOURCE_REALTIME = 0,        //!< CLOCK_REALTIME: precise (default)
+    BXITIME_SOURCE_REALTIME_COARSE = 1, //!< CLOCK_REALTIME_COARSE: cheap, about 1-4 ms
+                                        //!< resolution
+    BXITIME_SOURCE_TSC = 2,             //!< CPU timestamp counter: cheapest, converted
+                                        //!< to wall clock time using a calibration
+} bxitime_source_e;
+
+// *********************************************************************************
+// ********************************** Global Variables *****************************
+// *********************************************************************************
+
+// *********************************************************************************
+// ********************************** Interface ************************************
+// *********************************************************************************
+
+#endif /* BXITIME_SOURCE_H_ */
@@ -262,9 +262,8 @@ bxierr_p bxizmq_msg_close(zmq_msg_t * zmsg);
  *
  * After each failure (EAGAIN) sleep for `delay` seconds.
  * If after `retries_max` retries, it still fails (EAGAIN), retry
- * synchronously and return a bxierr with error code
- * `BXIZMQ_RETRIES_MAX_ERR` and the number of retries
- * as the error data (casted from a `size_t`, it is not a pointer).
+ * synchronously and return a preallocated bxierr with error code
+ * `BXIZMQ_RETRIES_MAX_ERR` (see BXIERR_STATIC_INIT()).
  *
  * Note: if `retries_max == 0`, this call is equivalent to a synchronous
  * send.
@@ -275,7 +274,7 @@ bxierr_p bxizmq_msg_close(zmq_msg_t * zmsg);
  * @param retries_max the number of retries before switching to synchronous sending
  * @param delay_ns the maximum number of nanoseconds to sleep before a retry
  * @return BXIERR_OK on succes,
- *         `bxierr(code=BXIZMQ_RETRIES_MAX_ERR, data=(size_t) retries_nb)`
+ *         `bxierr(code=BXIZMQ_RETRIES_MAX_ERR)`
  *         among others.
  */
 bxierr_p bxizmq_msg_snd(zmq_msg_t * zmsg,
@@ -310,8 +309,8 @@ bxierr_p bxizmq_msg_rcv(void * zocket, zmq_msg_t * zmsg, int flags);
  * and tries again, up to `retries_max` attempt.
  *
  * If after `retries_max` attempt, the message cannot be received without blocking,
- * the error with error code BXIERR_RETRIES_MAX_ERR is returned with the number of
- * retries as the data (casted from a `size_t`, it is not a pointer).
+ * a preallocated bxierr with error code `BXIZMQ_RETRIES_MAX_ERR` is returned
+ * (see BXIERR_STATIC_INIT()).
  *
  * @param zocket the zeromq socket
  * @param msg the zeromq message
@@ -319,7 +318,7 @@ bxierr_p bxizmq_msg_rcv(void * zocket, zmq_msg_t * zmsg, int flags);
  * @param delay_ns the maximum number of nanoseconds to sleep between two retries
  *
  * @return BXIERR_OK on success,
- *         `bxierr(code=BXIZMQ_RETRIES_MAX_ERR, data=(size_t) retries_nb)`
+ *         `bxierr(code=BXIZMQ_RETRIES_MAX_ERR)`
  *         among others
  */
 bxierr_p bxizmq_msg_rcv_async(void *zocket, zmq_msg_t *msg,
@@ -444,6 +444,21 @@ def flush():
     bxierr.BXICError.raise_if_ko(err_p)
 
 
+def set_filters(handler_rank, filters_str):
+    """
+    Replace the filters of a running handler without restarting it.
+
+    @param[in] handler_rank the rank of the handler in the 'handlers' configuration
+    @param[in] filters_str the new filters, see bxi.base.log.filter.parse_filters()
+
+    @return
+    """
+    from . import filter as bxilogfilter
+    filters = bxilogfilter.parse_filters(filters_str)
+    err_p = __BXIBASE_CAPI__.bxilog_set_filters(handler_rank, filters._cstruct)
+    bxierr.BXICError.raise_if_ko(err_p)
+
+
 def get_all_loggers_iter():
     """
     Return an iterator over all loggers.
@@ -0,0 +1,254 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+"""
+@file binfile.py bxilog binary file reader
+@authors Pierre Vignéras <pierre.vigneras@bull.net>
+@copyright 2013  Bull S.A.S.  -  All rights reserved.\n
+           This is not Free or Open Source software.\n
+           Please contact Bull SAS for details about its license.\n
+           Bull - Rue Jean Jaurès - B.P. 68 - 78340 Les Clayes-sous-Bois
+@namespace bxi.base.log.binfile bxilog binary file reader
+
+Read files produced by the binary file handler (see bxi/base/log/binfile.h for
+the format description) and render them in the classic text format.
+
+This module does not depend on the C library so it can be used on any host.
+"""
+
+from __future__ import print_function
+import collections
+import mmap
+import struct
+import time
+import zlib
+
+MAGIC = b'BXILOGB\0'
+BOM = 0x01020304
+VERSION = 1
+BLOCK_MAGIC = 0x42495842
+FLAG_ZLIB = 0x1
+ENTRY_STRING = 1
+ENTRY_RECORD = 2
+
+"""The level characters used by the text format"""
+LEVEL_STR = '-PACEWNOIDFTL'
+
+_HEADER_FMT = '8sIHH'
+_BLOCK_FMT = 'IIIII'
+_ENTRY_FMT = 'HHI'
+_RECORD_FMT = 'qQiiiiIIIIII'
+
+Record = collections.namedtuple('Record', ['level', 'sec', 'nsec', 'pid', 'tid',
+                                           'thread_rank', 'line_nb', 'progname',
+                                           'filename', 'funcname', 'logname',
+                                           'logmsg'])
+
+
+def _str(data):
+    """Return a native string from the given bytes"""
+    if isinstance(data, str):
+        return data
+    return data.decode('utf-8', 'replace')
+
+
+def is_binfile(path):
+    """
+    Return True if the given file is a bxilog binary file.
+
+    @param[in] path the file path
+    @return True if the given file is a bxilog binary file
+    """
+    with open(path, 'rb') as f:
+        return f.read(len(MAGIC)) == MAGIC
+
+
+class BinFileReader(object):
+    """
+    Iterate over the records of a bxilog binary file.
+
+    Corrupted blocks are skipped and counted in corrupted_nb. A truncated last block
+    is considered as the end of the file.
+    """
+
+    def __init__(self, data):
+        """
+        Create a reader over the given data (bytes or mmap).
+
+        @param[in] data the whole file content
+        """
+        self.data = data
+        self.corrupted_nb = 0
+        self.offset = 0
+        if len(data) == 0:
+            # Nothing to read, but iterating must still work
+            self._init_structs('<')
+            return
+        magic, bom, version, header_size = struct.unpack_from('<' + _HEADER_FMT, data)
+        if magic != MAGIC:
+            raise ValueError("Not a bxilog binary file (bad magic)")
+        if bom == BOM:
+            self.order = '<'
+        else:
+            self.order = '>'
+            magic, bom, version, header_size = struct.unpack_from('>' + _HEADER_FMT,
+                                                                  data)
+            if bom != BOM:
+                raise ValueError("Not a bxilog binary file (bad byte order mark)")
+        if version > VERSION:
+            raise ValueError("Unsupported bxilog binary file version: %d" % version)
+        self.offset = header_size
+        self._init_structs(self.order)
+
+    def _init_structs(self, order):
+        self.order = order
+        self._block = struct.Struct(order + _BLOCK_FMT)
+        self._entry = struct.Struct(order + _ENTRY_FMT)
+        self._record = struct.Struct(order + _RECORD_FMT)
+        self._block_magic = struct.pack(order + 'I', BLOCK_MAGIC)
+
+    @classmethod
+    def open(cls, path):
+        """
+        Return a reader over the given file (memory mapped).
+
+        @param[in] path the file path
+        @return a reader
+        """
+        with open(path, 'rb') as f:
+            f.seek(0, 2)
+            if f.tell() == 0:
+                return cls(b'')
+            return cls(mmap.mmap(f.fileno(), 0, prot=mmap.PROT_READ))
+
+    def _find_block(self, start):
+        pos = self.data.find(self._block_magic, start)
+        return len(self.data) if pos == -1 else pos
+
+    def _blocks(self):
+        data = self.data
+        size = len(data)
+        while size - self.offset >= self._block.size:
+            magic, flags, payload_len, crc, records_nb = \
+                self._block.unpack_from(data, self.offset)
+            if magic != BLOCK_MAGIC:
+                next_block = self._find_block(self.offset + 1)
+                # Zeroed tail of a mapped segment (crash in mmap mode)
+                if magic == 0 and next_block == size:
+                    return
+                self.corrupted_nb += 1
+                self.offset = next_block
+                continue
+            start = self.offset + self._block.size
+            end = start + payload_len
+            if end > size:
+                # Truncated last block
+                next_block = self._find_block(self.offset + 1)
+                if next_block == size:
+                    return
+                self.corrupted_nb += 1
+                self.offset = next_block
+                continue
+            payload = data[start:end]
+            if (zlib.crc32(payload) & 0xffffffff) != crc:
+                payload = None
+            elif flags == FLAG_ZLIB:
+                payload = self._inflate(payload)
+            elif flags != 0:
+                payload = None
+            if payload is None:
+                self.corrupted_nb += 1
+                self.offset = self._find_block(self.offset + 1)
+                continue
+            self.offset = end
+            yield payload
+
+    def _inflate(self, payload):
+        if len(payload) < 4:
+            return None
+        raw_len, = struct.unpack_from(self.order + 'I', payload)
+        try:
+            raw = zlib.decompress(payload[4:], -zlib.MAX_WBITS)
+        except zlib.error:
+            return None
+        return raw if len(raw) == raw_len else None
+
+    def __iter__(self):
+        entry_size = self._entry.size
+        record_size = self._record.size
+        for payload in self._blocks():
+            strings = {}
+            pos = 0
+            while len(payload) - pos >= entry_size:
+                etype, _, elen = self._entry.unpack_from(payload, pos)
+                start = pos + entry_size
+                pos = start + elen
+                if pos > len(payload):
+                    break
+                if etype == ENTRY_STRING and elen >= 4:
+                    sid, = struct.unpack_from(self.order + 'I', payload, start)
+                    strings[sid] = _str(payload[start + 4:pos])
+                elif etype == ENTRY_RECORD and elen >= record_size:
+                    (sec, rank, nsec, pid, tid, line_nb,
+                     prog_id, file_id, func_id, log_id,
+                     level, _) = self._record.unpack_from(payload, start)
+                    yield Record(level, sec, nsec, pid, tid, rank, line_nb,
+                                 strings.get(prog_id, ''),
+                                 strings.get(file_id, ''),
+                                 strings.get(func_id, ''),
+                                 strings.get(log_id, ''),
+                                 _str(payload[start + record_size:pos]))
+
+
+def format_level(record):
+    """
+    Return the level of the given record as in the text format.
+
+    @param[in] record a Record
+    @return a single character, '?' for an unknown level
+    """
+    return LEVEL_STR[record.level] if record.level < len(LEVEL_STR) else '?'
+
+
+def format_timestamp(record):
+    """
+    Return the timestamp of the given record as in the text format.
+
+    @param[in] record a Record
+    @return a string such as 20140918T090752.472145261
+    """
+    return time.strftime('%Y%m%dT%H%M%S', time.localtime(record.sec)) + \
+        '.%09d' % record.nsec
+
+
+def format_pkrid(record):
+    """
+    Return the process/kernel task/thread rank id of the given record as in the
+    text format.
+
+    @param[in] record a Record
+    @return a string such as 11297.11302=01792
+    """
+    return '%05u.%05u=%05x' % (record.pid, record.tid, record.thread_rank)
+
+
+def format_source(record):
+    """
+    Return the source of the given record as in the text format.
+
+    @param[in] record a Record
+    @return a string such as unit_t.c:308@_dummy
+    """
+    return '%s:%d@%s' % (record.filename, record.line_nb, record.funcname)
+
+
+def format_record(record):
+    """
+    Return the lines of the given record in the classic text format.
+
+    @param[in] record a Record
+    @return a list of lines (including their end of line character)
+    """
+    prefix = '%s|%s|%s:%s|%s|%s|' % (format_level(record), format_timestamp(record),
+                                      format_pkrid(record), record.progname,
+                                      format_source(record), record.logname)
+    return [prefix + line + '\n' for line in record.logmsg.split('\n')]
@@ -33,6 +33,30 @@ FILTERS_AUTO = 'auto'
 STDOUT = '-'
 STDERR = '+'
 
+"""
+The file formats: the classic text format or the binary format.
+
+@see ::BXILOG_FILE_HANDLER_BINARY
+@see bxi.base.log.binfile
+"""
+FORMAT_TEXT = 'text'
+FORMAT_BINARY = 'binary'
+FORMATS = [FORMAT_TEXT, FORMAT_BINARY]
+
+"""
+The I/O modes and msync() policies (mmap mode only).
+
+@see ::bxilog_file_handler_set_io()
+"""
+IO_MODES = {'write': 'BXILOG_FILE_HANDLER_IO_WRITE',
+            'mmap': 'BXILOG_FILE_HANDLER_IO_MMAP'}
+MSYNC_POLICIES = {'none': 'BXILOG_FILE_HANDLER_MSYNC_NONE',
+                  'async': 'BXILOG_FILE_HANDLER_MSYNC_ASYNC',
+                  'sync': 'BXILOG_FILE_HANDLER_MSYNC_SYNC'}
+DURABILITY_POLICIES = {'none': 'BXILOG_FILE_HANDLER_DURABILITY_NONE',
+                       'periodic': 'BXILOG_FILE_HANDLER_DURABILITY_PERIODIC',
+                       'flush': 'BXILOG_FILE_HANDLER_DURABILITY_FLUSH'}
+
 
 def add_handler(configobj, section_name, c_config):
     """
@@ -50,6 +74,39 @@ def add_handler(configobj, section_name, c_config):
         filename = os.path.abspath(filename)
     section['path'] = filename
     append = section.as_bool('append')
+    fmt = section.get('format', FORMAT_TEXT)
+    if fmt not in FORMATS:
+        raise bxierr.BXIError("Unknown file format '%s' in section %s, "
+                              "expecting one of %s" % (fmt, section_name, FORMATS))
+    io_mode = section.get('io', 'write')
+    if io_mode not in IO_MODES:
+        raise bxierr.BXIError("Unknown I/O mode '%s' in section %s, "
+                              "expecting one of %s" % (io_mode, section_name,
+                                                       sorted(IO_MODES)))
+    msync = section.get('msync', 'async')
+    if msync not in MSYNC_POLICIES:
+        raise bxierr.BXIError("Unknown msync policy '%s' in section %s, "
+                              "expecting one of %s" % (msync, section_name,
+                                                       sorted(MSYNC_POLICIES)))
+    # Rotation: size in bytes, interval in seconds (0 disables each one)
+    rotate_size = int(section.get('rotate_size', 0))
+    rotate_interval = int(section.get('rotate_interval', 0))
+    rotate_compress = section.as_bool('rotate_compress') \
+        if 'rotate_compress' in section else False
+    # Streaming compression level (0 disables it)
+    compression = int(section.get('compression', 0))
+    durability = section.get('durability', 'none')
+    if durability not in DURABILITY_POLICIES:
+        raise bxierr.BXIError("Unknown durability policy '%s' in section %s, "
+                              "expecting one of %s" % (durability, section_name,
+                                                       sorted(DURABILITY_POLICIES)))
+    # Period in milliseconds ('periodic' policy only)
+    sync_period = int(section.get('sync_period', 1000))
+    if 'sync_level' in section:
+        import bxi.base.log as bxilog
+        sync_level = bxilog.get_level_from_str(section['sync_level'])
+    else:
+        sync_level = __BXIBASE_CAPI__.BXILOG_OFF
 
     if filters_str == FILTERS_AUTO:
         # Compute file filters automatically according to console handler filters
@@ -82,10 +139,44 @@ def add_handler(configobj, section_name, c_config):
     open_flags = __FFI__.cast('int',
                               os.O_CREAT |
                               (os.O_APPEND if append else os.O_TRUNC))
+    handler = __BXIBASE_CAPI__.BXILOG_FILE_HANDLER_BINARY if fmt == FORMAT_BINARY \
+        else __BXIBASE_CAPI__.BXILOG_FILE_HANDLER
     __BXIBASE_CAPI__.bxilog_config_add_handler(c_config,
-                                               __BXIBASE_CAPI__.BXILOG_FILE_HANDLER,
+                                               handler,
                                                file_filters._cstruct,
                                                c_config.progname,
                                                filename,
                                                open_flags)
+    param = c_config.handlers_params[c_config.handlers_nb - 1]
+    __BXIBASE_CAPI__.bxilog_file_handler_set_io(param,
+                                                getattr(__BXIBASE_CAPI__,
+                                                        IO_MODES[io_mode]),
+                                                getattr(__BXIBASE_CAPI__,
+                                                        MSYNC_POLICIES[msync]))
+    __BXIBASE_CAPI__.bxilog_file_handler_set_rotation(param,
+                                                      rotate_size,
+                                                      rotate_interval,
+                                                      rotate_compress)
+    __BXIBASE_CAPI__.bxilog_file_handler_set_compression(param, compression)
+    __BXIBASE_CAPI__.bxilog_file_handler_set_durability(param,
+                                                        getattr(__BXIBASE_CAPI__,
+                                                                DURABILITY_POLICIES[durability]),
+                                                        sync_period,
+                                                        sync_level)
+    # Routes: subsections with their own 'filters' and 'path' (see the C API)
+    routes = configobj[section_name].get('routes', {})
+    for route_name in routes:
+        route = routes[route_name]
+        route_filters = bxilogfilter.parse_filters(route['filters'])
+        route_path = __FFI__.new('char[]',
+                                 os.path.abspath(route['path']).encode("utf-8", "replace"))
+        __BXIBASE_CAPI__.bxilog_file_handler_add_route(param,
+                                                       route_filters._cstruct,
+                                                       route_path)
+    # The main file writes all logs accepted by 'filters' unless restricted
+    main_filters_str = configobj[section_name].get('main_filters', None)
+    if main_filters_str is not None:
+        main_filters = bxilogfilter.parse_filters(main_filters_str)
+        __BXIBASE_CAPI__.bxilog_file_handler_set_main_filters(param,
+                                                              main_filters._cstruct)
 #    __BXIBASE_CAPI__.bxilog_filters_free(file_filters);
@@ -43,8 +43,12 @@ def add_handler(configobj, section_name, c_config):
 
     url = __FFI__.new('char[]', url.encode("utf-8", "replace"))
     bind = __FFI__.cast('bool', section.as_bool('bind'))
+    # Records are sent in compressed blocks when a level is given (0 disables it)
+    compression = int(section.get('compression', 0))
     __BXIBASE_CAPI__.bxilog_config_add_handler(c_config,
                                                __BXIBASE_CAPI__.BXILOG_REMOTE_HANDLER,
                                                filters._cstruct,
                                                url,
                                                bind)
+    param = c_config.handlers_params[c_config.handlers_nb - 1]
+    __BXIBASE_CAPI__.bxilog_remote_handler_set_compression(param, compression)
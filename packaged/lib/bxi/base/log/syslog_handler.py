@@ -17,12 +17,22 @@ import sys
 import syslog
 
 import bxi.base as bxibase
+import bxi.base.err as bxierr
 import bxi.base.log.filter as bxilogfilter
 
 # Find the C library
 __FFI__ = bxibase.get_ffi()
 __BXIBASE_CAPI__ = bxibase.get_capi()
 
+"""
+The message formats: 'libc' uses syslog(3), others are sent natively.
+
+@see ::bxilog_syslog_handler_set_native()
+"""
+FORMATS = {'libc': 'BXILOG_SYSLOG_HANDLER_LIBC',
+           'rfc3164': 'BXILOG_SYSLOG_HANDLER_RFC3164',
+           'rfc5424': 'BXILOG_SYSLOG_HANDLER_RFC5424'}
+
 
 def add_handler(configobj, section_name, c_config):
     """
@@ -35,6 +45,14 @@ def add_handler(configobj, section_name, c_config):
     section = configobj[section_name]
     filters_str = section['filters']
     facility_str = section['facility']
+    fmt = section.get('format', 'libc')
+    if fmt not in FORMATS:
+        raise bxierr.BXIError("Unknown syslog format '%s' in section %s, "
+                              "expecting one of %s" % (fmt, section_name,
+                                                       sorted(FORMATS)))
+    # Native mode only: the daemon socket and the bound of its buffer
+    socket_path = section.get('socket', None)
+    pending_max = int(section.get('pending_max', 0))
 
     filters = bxilogfilter.parse_filters(filters_str)
     facility = __FFI__.cast('int', eval('syslog.%s' % facility_str))
@@ -47,3 +65,12 @@ def add_handler(configobj, section_name, c_config):
                                                identity,
                                                option,
                                                facility)
+    if fmt != 'libc':
+        param = c_config.handlers_params[c_config.handlers_nb - 1]
+        path = __FFI__.NULL if socket_path is None \
+            else __FFI__.new('char[]', socket_path.encode("utf-8", "replace"))
+        __BXIBASE_CAPI__.bxilog_syslog_handler_set_native(param,
+                                                          getattr(__BXIBASE_CAPI__,
+                                                                  FORMATS[fmt]),
+                                                          path,
+                                                          pending_max)
@@ -536,6 +536,16 @@ def _configure_log(parser):
                                "%s, instead of owerwriting. " % section +
                                "Value: %(default)s")
 
+            default = conf.get('format', bxilog_filehandler.FORMAT_TEXT)
+            group.add_argument("--log-%s-format" % section,
+                               metavar='format',
+                               mustbeprinted=False,
+                               default=default,
+                               choices=bxilog_filehandler.FORMATS,
+                               help="Define the file format of handler %s. " % section +
+                               "Binary files are read with bxilog-parser. "
+                               "Value: %(default)s. choices=%(choices)s")
+
     def _override_logconfig(config, known_args, parser):
         """
         Override the given logging configuration with given known_args
@@ -568,6 +578,7 @@ def _configure_log(parser):
             _override_kv(option, 'colors', config, args)
             _override_kv(option, 'path', config, args)
             _override_kv(option, 'append', config, args)
+            _override_kv(option, 'format', config, args)
 
             # if --quiet option is provided, set output log level for console handlers
             # to minimal settings so that nothing is printed on stdout (nothing change
@@ -18,6 +18,7 @@
 #include <errno.h>
 #include <signal.h>
 #include <sys/syscall.h>
+#include <pthread.h>
 #include <backtrace.h>
 #include <backtrace-supported.h>
 
@@ -31,6 +32,7 @@
 #define OK_MSG "No problem found - everything is ok"
 
 #define BACKTRACE_MAX 64 // Number of maximum depth of a backtrace
+#define SYMBOLS_CACHE_SIZE 1024 // Number of symbolized addresses kept (power of 2)
 #define ERR_BT_PREFIX   "##trce## "
 #define ERR_CODE_PREFIX "##code## "
 #define ERR_MSG_PREFIX  "##mesg## "
@@ -40,6 +42,11 @@
 // ********************************** Types ****************************************
 // *********************************************************************************
 
+typedef struct {
+    void * address;
+    char * symbol;
+} symbol_entry_s;
+
 // *********************************************************************************
 // **************************** Static function declaration ************************
 // *********************************************************************************
@@ -47,7 +54,11 @@ static void _err_list_init(bxierr_list_p errlist);
 static int _bt_full_cb(void *data, uintptr_t pc,
                        const char *filename, int lineno, const char *function);
 static void _bt_error_cb(void *data, const char *msg, int errnum);
-static char** _pretty_backtrace(void* addresses[], int array_size);
+static int _get_tid(void);
+static size_t _backtrace_str(void * addresses[], int addresses_nb, int tid,
+                             char ** result);
+static void _print_symbol(FILE * file, void * address);
+static char * _symbolize(void * address);
 static void __bt_init__(void);
 // *********************************************************************************
 // ********************************** Global Variables *****************************
@@ -66,6 +77,10 @@ const int BXIERR_CAUSED_BY_STR_LEN = ARRAYLEN(CAUSED_BY_STR);
 
 struct backtrace_state * BT_STATE = NULL;
 
+// Address to symbol cache (open addressing), shared by all threads
+static symbol_entry_s SYMBOLS_CACHE[SYMBOLS_CACHE_SIZE];
+static pthread_mutex_t SYMBOLS_CACHE_MUTEX = PTHREAD_MUTEX_INITIALIZER;
+
 // *********************************************************************************
 // ********************************** Implementation   *****************************
 // *********************************************************************************
@@ -89,18 +104,25 @@ bxierr_p bxierr_new(int code,
                     const char * fmt,
                     ...) {
 
-    bxierr_p self = bximem_calloc(sizeof(*self));
+    // Only the raw addresses are recorded (in the same block as the error):
+    // symbolization is done on demand, most errors are never displayed.
+    void * addresses[BACKTRACE_MAX];
+    const int addresses_nb = backtrace(addresses, BACKTRACE_MAX);
+    const size_t addresses_size = (size_t) addresses_nb * sizeof(*addresses);
+
+    bxierr_p self = bximem_calloc(sizeof(*self) + addresses_size);
     self->code = code;
-    char * tmp = NULL;
-    self->backtrace_len = bxierr_backtrace_str(&tmp);
-    self->backtrace = tmp;
+    self->tid = _get_tid();
+    self->addresses_nb = addresses_nb;
+    self->addresses = (void **) (self + 1);
+    memcpy(self->addresses, addresses, addresses_size);
     self->data = data;
     self->free_fn = free_fn;
     self->add_to_report = (NULL == add_to_report) ?
                                 bxierr_report_add_from_limit :
                                 add_to_report;
 
-    self->cause = bxierr_isok(cause) ? NULL : cause;
+    self->cause = bxierr_isok(cause) ? NULL : bxierr_unshare(cause);
 
     if (self->cause != NULL) {
         if (self->cause->last_cause != NULL) {
@@ -121,6 +143,7 @@ bxierr_p bxierr_new(int code,
 void bxierr_free(bxierr_p self) {
     if (NULL == self) return;
     if (self == BXIERR_OK) return;
+    if (self->preallocated) return;
     if (NULL != self->cause) bxierr_destroy(&(self->cause));
     if (NULL != self->free_fn) {
         self->free_fn(self->data);
@@ -207,8 +230,14 @@ void bxierr_report_add_from_limit(bxierr_p self, bxierr_report_p report, size_t
 
     char * result = bxistr_new(ERR_CODE_PREFIX"%d\n%s", self->code, final_msg);
 
-    char * bt = (NULL == self->backtrace) ? "" : self->backtrace;
-    size_t bt_len = (NULL == self->backtrace) ? 1 : (self->backtrace_len + 1);
+    size_t bt_len;
+    char * bt = bxierr_get_backtrace(self, &bt_len);
+    if (NULL == bt) {
+        bt = "";
+        bt_len = 1;
+    } else {
+        bt_len++;
+    }
 
     bxierr_report_add(report, result, strlen(result) + 1, bt, bt_len);
     BXIFREE(result);
@@ -291,6 +320,33 @@ char * bxierr_str_limit(bxierr_p self, size_t depth) {
 
 bxierr_p bxierr_get_ok() { return BXIERR_OK; }
 
+char * bxierr_get_backtrace(bxierr_p self, size_t * len) {
+    bxiassert(NULL != self);
+
+    if (NULL == self->backtrace && 0 < self->addresses_nb) {
+        self->backtrace_len = _backtrace_str(self->addresses, self->addresses_nb,
+                                             self->tid, &self->backtrace);
+    }
+    if (NULL != len) *len = self->backtrace_len;
+
+    return self->backtrace;
+}
+
+bxierr_p bxierr_unshare(bxierr_p self) {
+    if (NULL == self || bxierr_isok(self) || !self->preallocated) return self;
+
+    // Preallocated errors have neither cause, nor data to free, nor backtrace
+    bxierr_p result = bximem_calloc(sizeof(*result));
+    result->code = self->code;
+    result->data = self->data;
+    result->add_to_report = self->add_to_report;
+    result->msg_len = self->msg_len;
+    result->msg = bximem_calloc(self->msg_len);
+    memcpy(result->msg, self->msg, self->msg_len);
+
+    return result;
+}
+
 size_t bxierr_get_depth(bxierr_p self) {
 //    bxiassert(NULL != self);
 
@@ -353,59 +409,10 @@ bxierr_p bxierr_vfromidx(const int erridx,
 }
 
 size_t bxierr_backtrace_str(char ** result) {
-    *result = NULL;
-    size_t size;
-    errno = 0;
-    FILE * faked_file = open_memstream(result, &size);
-    if (NULL == faked_file) {
-        perror("Calling open_memstream() failed");
-        *result = strdup("Unavailable backtrace (open_memstream() failed)");
-        return strlen(*result) + 1;
-    }
     void *addresses[BACKTRACE_MAX];
-    sigset_t orig_set;
-    sigset_t mask;
-    sigfillset(&mask);
-    sigemptyset(&orig_set);
-
-    int rc = pthread_sigmask(SIG_BLOCK, &mask, &orig_set);
-    if (rc != 0) {
-        perror("Calling pthread_sigmask() failed");
-        *result = strdup("Unavailable backtrace (pthread_sigmask() failed)");
-        return strlen(*result) + 1;
-    }
-    int c = backtrace(addresses, BACKTRACE_MAX);
-    errno = 0;
-    char **symbols = backtrace_symbols(addresses, c);
-    char **strings = _pretty_backtrace(addresses, c);
-
-    rc = pthread_sigmask(SIG_SETMASK, &orig_set, NULL);
-    if (rc != 0) {
-        perror("Calling pthread_sigmask() unblocking failed");
-    }
+    const int c = backtrace(addresses, BACKTRACE_MAX);
 
-#ifdef __linux__
-    pid_t tid = (pid_t) syscall(SYS_gettid);
-#else
-    int tid;
-    bxierr_p err = bxilog_get_thread_rank(&tid);
-    if (BXIERR_OK != err) tid = -1;
-#endif
-    const char * const truncated = (c == BACKTRACE_MAX) ? "(truncated) " : "";
-
-    fprintf(faked_file,
-            ERR_BT_PREFIX"Backtrace of tid %d: %d function calls %s\n",
-            tid, c, truncated);
-    for(int i = 0; i < c; i++) {
-        fprintf(faked_file, ERR_BT_PREFIX"[%02d] %s\n", i,
-                NULL == strings[i] ? symbols[i] : strings[i]);
-        BXIFREE(strings[i]);
-    }
-    fprintf(faked_file,ERR_BT_PREFIX"Backtrace end\n");
-    fclose(faked_file);
-    BXIFREE(symbols);
-    BXIFREE(strings);
-    return size;
+    return _backtrace_str(addresses, c, _get_tid(), result);
 }
 
 void bxierr_assert_fail(const char *assertion, const char *file,
@@ -556,21 +563,116 @@ void _err_list_init(bxierr_list_p errlist) {
 }
 
 
-char** _pretty_backtrace(void* addresses[], int array_size) {
-    // Used to return the strings generated from the addresses
-    char** backtrace_strings = bximem_calloc(sizeof(*backtrace_strings) * (unsigned)array_size);
-    for(int i = 0; i < array_size; i++) {
-        int rc = backtrace_pcinfo(BT_STATE,
-                                  (uintptr_t) addresses[i],
-                                  _bt_full_cb,
-                                  _bt_error_cb,
-                                  &backtrace_strings[i]);
-        bxiassert(0 == rc);
+int _get_tid(void) {
+#ifdef __linux__
+    return (int) syscall(SYS_gettid);
+#else
+    int tid;
+    bxierr_p err = bxilog_get_thread_rank(&tid);
+    if (BXIERR_OK != err) tid = -1;
+    return tid;
+#endif
+}
+
+size_t _backtrace_str(void * addresses[], const int addresses_nb, const int tid,
+                      char ** result) {
+    *result = NULL;
+    size_t size;
+    errno = 0;
+    FILE * faked_file = open_memstream(result, &size);
+    if (NULL == faked_file) {
+        perror("Calling open_memstream() failed");
+        *result = strdup("Unavailable backtrace (open_memstream() failed)");
+        return strlen(*result) + 1;
+    }
+    sigset_t orig_set;
+    sigset_t mask;
+    sigfillset(&mask);
+    sigemptyset(&orig_set);
+
+    int rc = pthread_sigmask(SIG_BLOCK, &mask, &orig_set);
+    if (rc != 0) {
+        perror("Calling pthread_sigmask() failed");
+        fclose(faked_file);
+        BXIFREE(*result);
+        *result = strdup("Unavailable backtrace (pthread_sigmask() failed)");
+        return strlen(*result) + 1;
     }
-    return backtrace_strings;
+
+    const char * const truncated = (addresses_nb == BACKTRACE_MAX) ? "(truncated) " : "";
+
+    fprintf(faked_file,
+            ERR_BT_PREFIX"Backtrace of tid %d: %d function calls %s\n",
+            tid, addresses_nb, truncated);
+    for(int i = 0; i < addresses_nb; i++) {
+        fprintf(faked_file, ERR_BT_PREFIX"[%02d] ", i);
+        _print_symbol(faked_file, addresses[i]);
+        fputc('\n', faked_file);
+    }
+    fprintf(faked_file,ERR_BT_PREFIX"Backtrace end\n");
+
+    rc = pthread_sigmask(SIG_SETMASK, &orig_set, NULL);
+    if (rc != 0) {
+        perror("Calling pthread_sigmask() unblocking failed");
+    }
+
+    fclose(faked_file);
+    return size;
+}
+
+void _print_symbol(FILE * const file, void * const address) {
+    int rc = pthread_mutex_lock(&SYMBOLS_CACHE_MUTEX);
+    bxiassert(0 == rc);
+
+    size_t i = ((uintptr_t) address >> 4) & (SYMBOLS_CACHE_SIZE - 1);
+    for (size_t n = 0; n < SYMBOLS_CACHE_SIZE; n++) {
+        symbol_entry_s * entry = &SYMBOLS_CACHE[i];
+        if (NULL == entry->address) {
+            entry->symbol = _symbolize(address);
+            entry->address = address;
+        }
+        if (address == entry->address) {
+            fputs(entry->symbol, file);
+            rc = pthread_mutex_unlock(&SYMBOLS_CACHE_MUTEX);
+            bxiassert(0 == rc);
+            return;
+        }
+        i = (i + 1) & (SYMBOLS_CACHE_SIZE - 1);
+    }
+    rc = pthread_mutex_unlock(&SYMBOLS_CACHE_MUTEX);
+    bxiassert(0 == rc);
+
+    // The cache is full: symbolize each time
+    char * symbol = _symbolize(address);
+    fputs(symbol, file);
+    BXIFREE(symbol);
+}
+
+char * _symbolize(void * const address) {
+    char * result = NULL;
+    int rc = backtrace_pcinfo(BT_STATE,
+                              (uintptr_t) address,
+                              _bt_full_cb,
+                              _bt_error_cb,
+                              &result);
+    bxiassert(0 == rc);
+    if (NULL != result) return result;
+
+    // No debug information, use the dynamic symbols
+    char ** symbols = backtrace_symbols(&address, 1);
+    if (NULL == symbols) return bxistr_new("%p", address);
+    result = strdup(symbols[0]);
+    BXIFREE(symbols);
+
+    return result;
 }
 
 __attribute__((constructor)) void __bt_init__(void) {
+    // The first call to backtrace() loads libgcc: do it now so that errors
+    // can be created without this cost (and from signal handlers)
+    void * address;
+    backtrace(&address, 1);
+
     BT_STATE = backtrace_create_state(NULL,
                                       BACKTRACE_SUPPORTS_THREADS,
                                       _bt_error_cb, NULL);
@@ -55,6 +55,7 @@
 #include "log/handler_impl.h"
 #include "log/fork_impl.h"
 #include "log/registry_impl.h"
+#include "log/record_impl.h"
 
 #include "log/log_impl.h"
 
@@ -318,6 +319,83 @@ bxierr_p bxilog_flush(void) {
     return BXIERR_OK;
 }
 
+bxierr_p bxilog_set_filters(size_t handler_rank, bxilog_filters_p filters) {
+    bxiassert(NULL != filters);
+
+    bxierr_p err = BXIERR_OK, err2;
+    // Handlers must not be stopped meanwhile
+    int rc = pthread_mutex_lock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) {
+        bxilog_filters_destroy(&filters);
+        return bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_lock() failed (rc=%d)", rc);
+    }
+    if (INITIALIZED != BXILOG__GLOBALS->state) {
+        bxilog_filters_destroy(&filters);
+        err = bxierr_new(BXILOG_ILLEGAL_STATE_ERR,
+                         NULL, NULL, NULL, NULL,
+                         "Illegal state: %d", BXILOG__GLOBALS->state);
+        goto UNLOCK;
+    }
+    if (handler_rank >= BXILOG__GLOBALS->config->handlers_nb) {
+        bxilog_filters_destroy(&filters);
+        err = bxierr_gen("Bad handler rank: %zu (%zu handlers)",
+                         handler_rank, BXILOG__GLOBALS->config->handlers_nb);
+        goto UNLOCK;
+    }
+    tsd_p tsd = NULL;
+    err = bxilog__tsd_get(&tsd);
+    if (bxierr_isko(err)) {
+        bxilog_filters_destroy(&filters);
+        goto UNLOCK;
+    }
+
+    bxilog_handler_param_p param = BXILOG__GLOBALS->config->handlers_params[handler_rank];
+    bxilog_filters_p old = __atomic_exchange_n(&param->filters, filters, __ATOMIC_ACQ_REL);
+
+    // First, the handler takes the new filters: records sent to it from now on
+    // are matched against them
+    void * ctl_channel = tsd->ctrl_channel;
+    for (size_t i = 0; i < BXILOG__GLOBALS->internal_handlers_nb; i++) {
+
+        int ret = pthread_kill(BXILOG__GLOBALS->handlers_threads[i], 0);
+        if (ESRCH == ret) continue;
+
+        err2 = bxizmq_str_snd(FILTERS_CTRL_MSG_REQ, ctl_channel, 0, 0, 0);
+        BXIERR_CHAIN(err, err2);
+        if (bxierr_isko(err2)) continue;
+
+        char * reply = NULL;
+        err2 = bxizmq_str_rcv(ctl_channel, 0, false, &reply);
+        BXIERR_CHAIN(err, err2);
+        if (NULL != reply && 0 != strcmp(FILTERS_CTRL_MSG_REP, reply)) {
+            err2 = bxierr_new(BXILOG_IHT2BC_PROTO_ERR,
+                              NULL, NULL, NULL, NULL,
+                              "Wrong message received in reply "
+                              "to %s: %s. Expecting: %s",
+                              FILTERS_CTRL_MSG_REQ, reply,
+                              FILTERS_CTRL_MSG_REP);
+            BXIERR_CHAIN(err, err2);
+        }
+        BXIFREE(reply);
+    }
+
+    // Then, producers send records according to the new filters
+    bxilog__registry_reconfigure_handler(handler_rank, old);
+
+    // Handlers may still be using the previous filters on error
+    if (bxierr_isok(err)) bxilog_filters_destroy(&old);
+
+UNLOCK:
+    rc = pthread_mutex_unlock(&BXILOG_INITIALIZED_MUTEX);
+    if (0 != rc) {
+        err2 = bxierr_fromidx(rc, NULL,
+                              "Calling pthread_mutex_unlock() failed (rc=%d)", rc);
+        BXIERR_CHAIN(err, err2);
+    }
+    return err;
+}
+
 
 void bxilog_display_loggers(int fd) {
     char ** level_names;
@@ -391,6 +469,28 @@ bxierr_p bxilog__init_globals() {
 
     BXILOG__GLOBALS->zmq_ctx = ctx;
 
+    if (BXILOG_TRANSPORT_RING == BXILOG__GLOBALS->config->transport) {
+        bxiassert(NULL == BXILOG__GLOBALS->rings);
+        const size_t handlers_nb = BXILOG__GLOBALS->config->handlers_nb;
+        BXILOG__GLOBALS->rings = bximem_calloc(handlers_nb *
+                                               sizeof(*BXILOG__GLOBALS->rings));
+        for (size_t i = 0; i < handlers_nb; i++) {
+            err = bxilog__ring_registry_new(&BXILOG__GLOBALS->rings[i]);
+            if (bxierr_isko(err)) {
+                BXILOG__GLOBALS->state = ILLEGAL;
+                return err;
+            }
+        }
+    }
+
+    if (BXITIME_SOURCE_TSC == BXILOG__GLOBALS->config->timestamp_source) {
+        err = bxitime_tsc_calibrate(&BXILOG__GLOBALS->tsc_calib);
+        if (bxierr_isko(err)) {
+            BXILOG__GLOBALS->state = ILLEGAL;
+            return err;
+        }
+    }
+
     rc = pthread_once(&BXILOG__GLOBALS->tsd_key_once, bxilog__tsd_key_new);
     if (0 != rc) {
         BXILOG__GLOBALS->state = ILLEGAL;
@@ -615,6 +715,15 @@ bxierr_p _reset_globals() {
     int rc = pthread_key_delete(BXILOG__GLOBALS->tsd_key);
     UNUSED(rc); // Nothing to do on pthread_key_delete() see man page
     BXILOG__GLOBALS->tsd_key_once = PTHREAD_ONCE_INIT;
+    if (NULL != BXILOG__GLOBALS->rings) {
+        // Handlers are gone: records still in rings are lost
+        for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
+            err2 = bxilog__ring_registry_destroy(&BXILOG__GLOBALS->rings[i],
+                                                 (void (*)(void *)) bxilog__record_unref);
+            BXIERR_CHAIN(err, err2);
+        }
+        BXIFREE(BXILOG__GLOBALS->rings);
+    }
     BXILOG__GLOBALS->internal_handlers_nb = 0;
     BXIFREE(BXILOG__GLOBALS->handlers_threads);
 
@@ -635,6 +744,7 @@ bxierr_p _cleanup(void) {
 void _check_set_params(bxilog_config_p config) {
     bxiassert(NULL != config->progname);
     bxiassert(0 < config->tsd_log_buf_size);
+    bxiassert(BXILOG_TRANSPORT_RING != config->transport || 0 < config->ring_size);
 
     BXILOG__GLOBALS->config = config;
 }
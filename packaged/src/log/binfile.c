@@ -0,0 +1,570 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+#include "bxi/base/str.h"
+
+#include "bxi/base/log.h"
+#include "bxi/base/log/binfile.h"
+
+#include "binfile_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+
+// Worst case size of a string entry
+#define STRING_ENTRY_SIZE(len) (sizeof(bxilog_binfile_entry_s) + sizeof(uint32_t) + (len))
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef struct {
+    const char * str;
+    size_t len;
+} string_s;
+
+struct bxilog_binfile_s {
+    int fd;
+    char * filename;
+    const char * map;                   // The whole file
+    size_t size;
+    size_t offset;                      // Next block offset
+    const char * payload;               // Current block payload
+    size_t payload_len;
+    size_t entry;                       // Next entry offset in the payload
+    string_s * strings;                 // Current block strings, by identifier
+    size_t strings_size;
+    size_t corrupted_nb;
+    char * inflated;                    // Current block payload when compressed
+    size_t inflated_size;
+};
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void _init_crc32_table(void);
+static void _reserve(bxilog__binfile_writer_p writer, size_t size);
+static uint32_t _string_id(bxilog__binfile_writer_p writer, const char * str, size_t len);
+static void _append(bxilog__binfile_writer_p writer, const void * data, size_t len);
+static void _append_entry(bxilog__binfile_writer_p writer,
+                          bxilog_binfile_entry_type_e type, size_t len);
+static void _compress(bxilog__binfile_writer_p writer, size_t * payload_len);
+static bool _inflate(bxilog_binfile_p self, const char ** payload, size_t * payload_len);
+static bool _next_block(bxilog_binfile_p self);
+static size_t _find_block(bxilog_binfile_p self, size_t from);
+static void _get_string(bxilog_binfile_p self, uint32_t id,
+                        const char ** str, size_t * len);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+static pthread_once_t CRC32_ONCE = PTHREAD_ONCE_INIT;
+static uint32_t CRC32_TABLE[256];
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+uint32_t bxilog_binfile_crc32(uint32_t crc, const void * data, size_t len) {
+    int rc = pthread_once(&CRC32_ONCE, _init_crc32_table);
+    bxiassert(0 == rc);
+
+    const uint8_t * p = data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = CRC32_TABLE[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void bxilog__binfile_header(bxilog_binfile_header_s * header) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, BXILOG_BINFILE_MAGIC, ARRAYLEN(BXILOG_BINFILE_MAGIC));
+    header->bom = BXILOG_BINFILE_BOM;
+    header->version = BXILOG_BINFILE_VERSION;
+    header->header_size = sizeof(*header);
+}
+
+bxilog__binfile_writer_p bxilog__binfile_writer_new(const char * progname, int level) {
+    bxilog__binfile_writer_p writer = bximem_calloc(sizeof(*writer));
+    writer->progname = strdup(progname);
+    writer->progname_len = strlen(progname);
+    if (0 < level) writer->zblock = bxilog__zblock_new(level, false);
+
+    return writer;
+}
+
+void bxilog__binfile_writer_destroy(bxilog__binfile_writer_p * writer_p) {
+    bxilog__binfile_writer_p writer = *writer_p;
+    if (NULL == writer) return;
+
+    BXIFREE(writer->block);
+    BXIFREE(writer->progname);
+    bxilog__zblock_destroy(&writer->zblock);
+    bximem_destroy((char**) writer_p);
+}
+
+void bxilog__binfile_writer_add(bxilog__binfile_writer_p writer,
+                                const bxilog_record_p record,
+                                const char * filename,
+                                const char * funcname,
+                                const char * loggername,
+                                const char * logmsg,
+                                char ** block, size_t * block_len) {
+
+    *block = NULL;
+    *block_len = 0;
+
+    // Exclude NULL terminating bytes
+    const size_t filename_len = record->filename_len - 1;
+    const size_t funcname_len = record->funcname_len - 1;
+    const size_t logname_len = record->logname_len - 1;
+    const size_t logmsg_len = record->logmsg_len - 1;
+
+    // Assume all strings are new in the block
+    const size_t needed = STRING_ENTRY_SIZE(writer->progname_len) +
+                          STRING_ENTRY_SIZE(filename_len) +
+                          STRING_ENTRY_SIZE(funcname_len) +
+                          STRING_ENTRY_SIZE(logname_len) +
+                          sizeof(bxilog_binfile_entry_s) +
+                          sizeof(bxilog_binfile_record_s) + logmsg_len;
+
+    // Keep the dictionary sparse enough for a short probing
+    const bool dict_full = writer->strings_nb + 4 > BXILOG__BINFILE_DICT_SIZE / 2;
+    if (0 < writer->records_nb &&
+        (dict_full ||
+         writer->block_used + needed > sizeof(bxilog_binfile_block_s) +
+                                       BXILOG__BINFILE_BLOCK_SIZE)) {
+        bxilog__binfile_writer_close(writer, block, block_len);
+    }
+
+    _reserve(writer, needed);
+
+    bxilog_binfile_record_s bin;
+    memset(&bin, 0, sizeof(bin));
+    bin.sec = (int64_t) record->detail_time.tv_sec;
+    bin.nsec = (int32_t) record->detail_time.tv_nsec;
+    bin.thread_rank = (uint64_t) record->thread_rank;
+    bin.pid = (int32_t) record->pid;
+#ifdef __linux__
+    bin.tid = (int32_t) record->tid;
+#endif
+    bin.line_nb = (int32_t) record->line_nb;
+    bin.level = (uint32_t) record->level;
+    bin.progname_id = _string_id(writer, writer->progname, writer->progname_len);
+    bin.filename_id = _string_id(writer, filename, filename_len);
+    bin.funcname_id = _string_id(writer, funcname, funcname_len);
+    bin.logname_id = _string_id(writer, loggername, logname_len);
+
+    _append_entry(writer, BXILOG_BINFILE_RECORD, sizeof(bin) + logmsg_len);
+    _append(writer, &bin, sizeof(bin));
+    _append(writer, logmsg, logmsg_len);
+    writer->records_nb++;
+}
+
+void bxilog__binfile_writer_close(bxilog__binfile_writer_p writer,
+                                  char ** block, size_t * block_len) {
+
+    *block = NULL;
+    *block_len = 0;
+    if (0 == writer->records_nb) return;
+
+    size_t payload_len = writer->block_used - sizeof(bxilog_binfile_block_s);
+    bxilog_binfile_block_s header;
+    header.magic = BXILOG_BINFILE_BLOCK_MAGIC;
+    header.flags = 0;
+    if (NULL != writer->zblock) {
+        _compress(writer, &payload_len);
+        if (payload_len < writer->block_used - sizeof(header)) {
+            header.flags = BXILOG_BINFILE_ZLIB;
+            writer->block_used = sizeof(header) + payload_len;
+        }
+    }
+    header.payload_len = (uint32_t) payload_len;
+    header.crc32 = bxilog_binfile_crc32(0,
+                                        writer->block + sizeof(header),
+                                        payload_len);
+    header.records_nb = writer->records_nb;
+    memcpy(writer->block, &header, sizeof(header));
+
+    *block = writer->block;
+    *block_len = writer->block_used;
+
+    writer->block = NULL;
+    writer->block_size = 0;
+    writer->block_used = 0;
+    writer->records_nb = 0;
+    writer->strings_nb = 0;
+    memset(writer->dict, 0, sizeof(writer->dict));
+}
+
+bxierr_p bxilog_binfile_open(const char * filename, bxilog_binfile_p * result) {
+    bxiassert(NULL != result);
+    *result = NULL;
+
+    errno = 0;
+    int fd = open(filename, O_RDONLY);
+    if (-1 == fd) return bxierr_errno("Can't open %s", filename);
+
+    struct stat st;
+    int rc = fstat(fd, &st);
+    if (0 != rc) {
+        bxierr_p err = bxierr_errno("Calling fstat(%s) failed", filename);
+        close(fd);
+        return err;
+    }
+
+    bxilog_binfile_p self = bximem_calloc(sizeof(*self));
+    self->fd = fd;
+    self->filename = strdup(filename);
+    self->size = (size_t) st.st_size;
+
+    if (0 == self->size) {
+        // Nothing produced yet
+        *result = self;
+        return BXIERR_OK;
+    }
+
+    errno = 0;
+    void * map = mmap(NULL, self->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == map) {
+        bxierr_p err = bxierr_errno("Calling mmap(%s) failed", filename);
+        self->size = 0;
+        bxilog_binfile_close(&self);
+        return err;
+    }
+    self->map = map;
+    rc = posix_madvise(map, self->size, POSIX_MADV_SEQUENTIAL);
+    UNUSED(rc);
+
+    bxilog_binfile_header_s header;
+    if (self->size < sizeof(header)) {
+        bxilog_binfile_close(&self);
+        return bxierr_new(BXILOG_BINFILE_FORMAT_ERR, NULL, NULL, NULL, NULL,
+                          "%s: not a binary log file (too small)", filename);
+    }
+    memcpy(&header, self->map, sizeof(header));
+    if (0 != memcmp(header.magic, BXILOG_BINFILE_MAGIC, ARRAYLEN(BXILOG_BINFILE_MAGIC))) {
+        bxilog_binfile_close(&self);
+        return bxierr_new(BXILOG_BINFILE_FORMAT_ERR, NULL, NULL, NULL, NULL,
+                          "%s: not a binary log file (bad magic)", filename);
+    }
+    if (BXILOG_BINFILE_BOM != header.bom) {
+        bxilog_binfile_close(&self);
+        return bxierr_new(BXILOG_BINFILE_FORMAT_ERR, NULL, NULL, NULL, NULL,
+                          "%s: produced with another byte order (0x%08x)",
+                          filename, header.bom);
+    }
+    if (BXILOG_BINFILE_VERSION < header.version ||
+        sizeof(header) > header.header_size || self->size < header.header_size) {
+        bxierr_p err = bxierr_new(BXILOG_BINFILE_FORMAT_ERR, NULL, NULL, NULL, NULL,
+                                  "%s: unsupported version %u (header size: %u)",
+                                  filename, header.version, header.header_size);
+        bxilog_binfile_close(&self);
+        return err;
+    }
+    self->offset = header.header_size;
+
+    *result = self;
+    return BXIERR_OK;
+}
+
+bool bxilog_binfile_next(bxilog_binfile_p self, bxilog_binfile_entry_record_s * record) {
+    bxiassert(NULL != self);
+    bxiassert(NULL != record);
+
+    while (true) {
+        while (self->payload_len - self->entry >= sizeof(bxilog_binfile_entry_s)) {
+            bxilog_binfile_entry_s entry;
+            memcpy(&entry, self->payload + self->entry, sizeof(entry));
+            const char * data = self->payload + self->entry + sizeof(entry);
+            const size_t remaining = self->payload_len - self->entry - sizeof(entry);
+            // The checksum was fine: this is a writer bug, skip the whole block
+            if (entry.len > remaining) break;
+            self->entry += sizeof(entry) + entry.len;
+
+            if (BXILOG_BINFILE_STRING == entry.type && sizeof(uint32_t) <= entry.len) {
+                uint32_t id;
+                memcpy(&id, data, sizeof(id));
+                if (id >= self->strings_size) {
+                    const size_t size = ((size_t) id + 1) * 2;
+                    self->strings = bximem_realloc(self->strings,
+                                                   self->strings_size * sizeof(*self->strings),
+                                                   size * sizeof(*self->strings));
+                    self->strings_size = size;
+                }
+                self->strings[id].str = data + sizeof(id);
+                self->strings[id].len = entry.len - sizeof(id);
+                continue;
+            }
+            if (BXILOG_BINFILE_RECORD != entry.type) continue; // Unknown: skip
+            if (sizeof(bxilog_binfile_record_s) > entry.len) continue;
+
+            bxilog_binfile_record_s bin;
+            memcpy(&bin, data, sizeof(bin));
+            record->level = (bxilog_level_e) bin.level;
+            record->detail_time.tv_sec = (time_t) bin.sec;
+            record->detail_time.tv_nsec = (long) bin.nsec;
+            record->pid = (pid_t) bin.pid;
+            record->tid = (pid_t) bin.tid;
+            record->thread_rank = (uintptr_t) bin.thread_rank;
+            record->line_nb = (int) bin.line_nb;
+            _get_string(self, bin.progname_id, &record->progname, &record->progname_len);
+            _get_string(self, bin.filename_id, &record->filename, &record->filename_len);
+            _get_string(self, bin.funcname_id, &record->funcname, &record->funcname_len);
+            _get_string(self, bin.logname_id, &record->logname, &record->logname_len);
+            record->logmsg = data + sizeof(bin);
+            record->logmsg_len = entry.len - sizeof(bin);
+
+            return true;
+        }
+        if (!_next_block(self)) return false;
+    }
+}
+
+size_t bxilog_binfile_corrupted_nb(bxilog_binfile_p self) {
+    bxiassert(NULL != self);
+    return self->corrupted_nb;
+}
+
+bxierr_p bxilog_binfile_close(bxilog_binfile_p * self_p) {
+    bxilog_binfile_p self = *self_p;
+    if (NULL == self) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    if (NULL != self->map) {
+        errno = 0;
+        int rc = munmap((void *) self->map, self->size);
+        if (0 != rc) {
+            err2 = bxierr_errno("Calling munmap(%s) failed", self->filename);
+            BXIERR_CHAIN(err, err2);
+        }
+    }
+    errno = 0;
+    int rc = close(self->fd);
+    if (0 != rc) {
+        err2 = bxierr_errno("Calling close(%s) failed", self->filename);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    BXIFREE(self->strings);
+    BXIFREE(self->inflated);
+    BXIFREE(self->filename);
+    bximem_destroy((char**) self_p);
+
+    return err;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void _init_crc32_table(void) {
+    for (uint32_t i = 0; i < ARRAYLEN(CRC32_TABLE); i++) {
+        uint32_t c = i;
+        for (size_t k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+        }
+        CRC32_TABLE[i] = c;
+    }
+}
+
+void _reserve(bxilog__binfile_writer_p writer, size_t size) {
+    if (NULL == writer->block) {
+        writer->block_size = sizeof(bxilog_binfile_block_s) + BXILOG__BINFILE_BLOCK_SIZE;
+        writer->block = bximem_calloc(writer->block_size);
+        writer->block_used = sizeof(bxilog_binfile_block_s);
+    }
+    if (writer->block_used + size <= writer->block_size) return;
+
+    // A single record larger than a block
+    const size_t new_size = writer->block_used + size;
+    writer->block = bximem_realloc(writer->block, writer->block_size, new_size);
+    writer->block_size = new_size;
+}
+
+uint32_t _string_id(bxilog__binfile_writer_p writer, const char * str, size_t len) {
+    uint32_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t) str[i];
+        hash *= FNV_PRIME;
+    }
+
+    const size_t mask = BXILOG__BINFILE_DICT_SIZE - 1;
+    size_t i = hash & mask;
+    while (0 != writer->dict[i].id) {
+        const bxilog__binfile_string_s * slot = &writer->dict[i];
+        if (slot->hash == hash && slot->len == len &&
+            0 == memcmp(writer->block + slot->offset, str, len)) {
+            return slot->id;
+        }
+        i = (i + 1) & mask;
+    }
+
+    const uint32_t id = ++writer->strings_nb;
+    _append_entry(writer, BXILOG_BINFILE_STRING, sizeof(id) + len);
+    _append(writer, &id, sizeof(id));
+    writer->dict[i].hash = hash;
+    writer->dict[i].id = id;
+    writer->dict[i].offset = (uint32_t) writer->block_used;
+    writer->dict[i].len = (uint32_t) len;
+    _append(writer, str, len);
+
+    return id;
+}
+
+inline void _append(bxilog__binfile_writer_p writer, const void * data, size_t len) {
+    memcpy(writer->block + writer->block_used, data, len);
+    writer->block_used += len;
+}
+
+void _append_entry(bxilog__binfile_writer_p writer,
+                   bxilog_binfile_entry_type_e type, size_t len) {
+    bxilog_binfile_entry_s entry;
+    entry.type = (uint16_t) type;
+    entry.reserved = 0;
+    entry.len = (uint32_t) len;
+    _append(writer, &entry, sizeof(entry));
+}
+
+void _compress(bxilog__binfile_writer_p writer, size_t * payload_len) {
+    char * payload = writer->block + sizeof(bxilog_binfile_block_s);
+    const struct iovec iov = {.iov_base = payload, .iov_len = *payload_len};
+    const char * out;
+    size_t out_len;
+    bxierr_p err = bxilog__zblock_deflate(writer->zblock, &iov, 1, &out, &out_len);
+    // Keep the block as is when compression does not help
+    if (bxierr_isko(err) || sizeof(uint32_t) + out_len >= *payload_len) {
+        bxierr_destroy(&err);
+        return;
+    }
+
+    const uint32_t raw_len = (uint32_t) *payload_len;
+    memcpy(payload, &raw_len, sizeof(raw_len));
+    memcpy(payload + sizeof(raw_len), out, out_len);
+    *payload_len = sizeof(raw_len) + out_len;
+}
+
+bool _inflate(bxilog_binfile_p self, const char ** payload, size_t * payload_len) {
+    uint32_t raw_len;
+    if (sizeof(raw_len) > *payload_len) return false;
+    memcpy(&raw_len, *payload, sizeof(raw_len));
+
+    if (self->inflated_size < raw_len) {
+        self->inflated = bximem_realloc(self->inflated, self->inflated_size, raw_len);
+        self->inflated_size = raw_len;
+    }
+    bxierr_p err = bxilog__zblock_inflate(*payload + sizeof(raw_len),
+                                          *payload_len - sizeof(raw_len),
+                                          self->inflated, raw_len);
+    if (bxierr_isko(err)) {
+        bxierr_destroy(&err);
+        return false;
+    }
+    *payload = self->inflated;
+    *payload_len = raw_len;
+
+    return true;
+}
+
+bool _next_block(bxilog_binfile_p self) {
+    self->payload = NULL;
+    self->payload_len = 0;
+    self->entry = 0;
+
+    bxilog_binfile_block_s header;
+    while (self->size - self->offset >= sizeof(header)) {
+        memcpy(&header, self->map + self->offset, sizeof(header));
+        if (BXILOG_BINFILE_BLOCK_MAGIC != header.magic) {
+            const size_t next = _find_block(self, self->offset + 1);
+            // Zeroed tail of a mapped segment (crash in mmap mode): end of file
+            if (0 == header.magic && next == self->size) return false;
+            self->corrupted_nb++;
+            self->offset = next;
+            continue;
+        }
+        const size_t available = self->size - self->offset - sizeof(header);
+        // Truncated last block (crash): stop here unless a new block can be found
+        if (header.payload_len > available) {
+            const size_t next = _find_block(self, self->offset + 1);
+            if (next == self->size) return false;
+            self->corrupted_nb++;
+            self->offset = next;
+            continue;
+        }
+        const char * payload = self->map + self->offset + sizeof(header);
+        size_t payload_len = header.payload_len;
+        if (header.crc32 != bxilog_binfile_crc32(0, payload, payload_len) ||
+            (0 != header.flags &&
+             (BXILOG_BINFILE_ZLIB != header.flags ||
+              !_inflate(self, &payload, &payload_len)))) {
+            self->corrupted_nb++;
+            self->offset = _find_block(self, self->offset + 1);
+            continue;
+        }
+
+        self->offset += sizeof(header) + header.payload_len;
+        self->payload = payload;
+        self->payload_len = payload_len;
+        if (0 < self->strings_size) {
+            memset(self->strings, 0, self->strings_size * sizeof(*self->strings));
+        }
+        return true;
+    }
+
+    return false;
+}
+
+size_t _find_block(bxilog_binfile_p self, size_t from) {
+    if (from >= self->size) return self->size;
+
+    const uint32_t magic = BXILOG_BINFILE_BLOCK_MAGIC;
+    const char * first = (const char *) &magic;
+    const char * p = self->map + from;
+    const char * const end = self->map + self->size;
+    while (end - p >= (ssize_t) sizeof(magic)) {
+        p = memchr(p, *first, (size_t) (end - p) - sizeof(magic) + 1);
+        if (NULL == p) break;
+        if (0 == memcmp(p, &magic, sizeof(magic))) return (size_t) (p - self->map);
+        p++;
+    }
+
+    return self->size;
+}
+
+void _get_string(bxilog_binfile_p self, uint32_t id, const char ** str, size_t * len) {
+    if (id < self->strings_size && NULL != self->strings[id].str) {
+        *str = self->strings[id].str;
+        *len = self->strings[id].len;
+    } else {
+        *str = "";
+        *len = 0;
+    }
+}
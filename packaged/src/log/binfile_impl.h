@@ -0,0 +1,111 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_BINFILE_IMPL_H
+#define BXILOG_BINFILE_IMPL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "bxi/base/log.h"
+#include "bxi/base/log/binfile.h"
+
+#include "zblock_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// A block is closed when its payload reaches this size
+#define BXILOG__BINFILE_BLOCK_SIZE (64 * 1024)
+
+// Number of distinct strings a block can define (power of 2)
+#define BXILOG__BINFILE_DICT_SIZE 256
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef struct {
+    uint32_t hash;
+    uint32_t id;                        // 0 for an empty slot
+    uint32_t offset;                    // Where the string is in the block
+    uint32_t len;
+} bxilog__binfile_string_s;
+
+typedef struct bxilog__binfile_writer_s bxilog__binfile_writer_s;
+typedef bxilog__binfile_writer_s * bxilog__binfile_writer_p;
+
+/*
+ * Build blocks of the binary log file format (see bxi/base/log/binfile.h).
+ *
+ * Closed blocks are handed over to the caller which writes them as is.
+ */
+struct bxilog__binfile_writer_s {
+    char * progname;
+    size_t progname_len;                // Without the NULL terminating byte
+    char * block;                       // Current block (header included)
+    size_t block_size;                  // Allocated size
+    size_t block_used;
+    uint32_t records_nb;
+    uint32_t strings_nb;
+    bxilog__binfile_string_s dict[BXILOG__BINFILE_DICT_SIZE];
+    bxilog__zblock_p zblock;            // NULL if blocks are not compressed
+};
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/* Fill the given file header */
+void bxilog__binfile_header(bxilog_binfile_header_s * header);
+
+/*
+ * Create a new writer for the given program name.
+ *
+ * Blocks are compressed with the given zlib level (1 to 9), unless it is 0.
+ */
+bxilog__binfile_writer_p bxilog__binfile_writer_new(const char * progname, int level);
+
+/* Destroy the given writer, the current block is lost */
+void bxilog__binfile_writer_destroy(bxilog__binfile_writer_p * writer_p);
+
+/*
+ * Append the given record to the current block.
+ *
+ * If the current block had to be closed to make room for it, the closed block is
+ * returned in *block (the caller must free it with BXIFREE()) and its length in
+ * *block_len. Otherwise, *block is NULL.
+ */
+void bxilog__binfile_writer_add(bxilog__binfile_writer_p writer,
+                                const bxilog_record_p record,
+                                const char * filename,
+                                const char * funcname,
+                                const char * loggername,
+                                const char * logmsg,
+                                char ** block, size_t * block_len);
+
+/*
+ * Close the current block and return it as bxilog__binfile_writer_add() does.
+ *
+ * *block is NULL if the current block is empty.
+ */
+void bxilog__binfile_writer_close(bxilog__binfile_writer_p writer,
+                                  char ** block, size_t * block_len);
+
+#endif
@@ -0,0 +1,244 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <unistd.h>
+#include <syscall.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <zlib.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+#include "bxi/base/str.h"
+
+#include "compressor_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Compressing logs is a background task: leave the CPU to everything else
+#define HELPER_NICE 19
+
+#define READ_SIZE (64 * 1024)
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void * _helper_thread(bxilog__compressor_p self);
+static bxierr_p _compress(const char * filename);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxierr_p bxilog__compressor_new(bxilog__compressor_p * result) {
+    bxiassert(NULL != result);
+
+    bxilog__compressor_p self = bximem_calloc(sizeof(*self));
+    int rc = pthread_mutex_init(&self->mutex, NULL);
+    bxiassert(0 == rc);
+    rc = pthread_cond_init(&self->cond, NULL);
+    bxiassert(0 == rc);
+    self->err = BXIERR_OK;
+
+    // Signals are blocked in the handler thread: the helper inherits the mask
+    rc = pthread_create(&self->thread, NULL,
+                        (void * (*) (void *)) _helper_thread, self);
+    if (0 != rc) {
+        pthread_cond_destroy(&self->cond);
+        pthread_mutex_destroy(&self->mutex);
+        BXIFREE(self);
+        *result = NULL;
+        return bxierr_fromidx(rc, NULL, "Calling pthread_create() failed");
+    }
+
+    *result = self;
+    return BXIERR_OK;
+}
+
+bxierr_p bxilog__compressor_destroy(bxilog__compressor_p * self_p) {
+    bxilog__compressor_p self = *self_p;
+    if (NULL == self) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    int rc = pthread_mutex_lock(&self->mutex);
+    bxiassert(0 == rc);
+    self->exit = true;
+    rc = pthread_cond_broadcast(&self->cond);
+    bxiassert(0 == rc);
+    rc = pthread_mutex_unlock(&self->mutex);
+    bxiassert(0 == rc);
+
+    // Pending jobs are done before the helper exits
+    rc = pthread_join(self->thread, NULL);
+    if (0 != rc) {
+        err2 = bxierr_fromidx(rc, NULL, "Calling pthread_join() failed");
+        BXIERR_CHAIN(err, err2);
+    }
+    pthread_cond_destroy(&self->cond);
+    pthread_mutex_destroy(&self->mutex);
+
+    BXIERR_CHAIN(err, self->err);
+    bximem_destroy((char**) self_p);
+
+    return err;
+}
+
+void bxilog__compressor_submit(bxilog__compressor_p self, char * filename) {
+    bxilog__compressor_job_p job = bximem_calloc(sizeof(*job));
+    job->filename = filename;
+
+    int rc = pthread_mutex_lock(&self->mutex);
+    bxiassert(0 == rc);
+    if (NULL == self->tail) {
+        self->head = job;
+    } else {
+        self->tail->next = job;
+    }
+    self->tail = job;
+    rc = pthread_cond_broadcast(&self->cond);
+    bxiassert(0 == rc);
+    rc = pthread_mutex_unlock(&self->mutex);
+    bxiassert(0 == rc);
+}
+
+bxierr_p bxilog__compressor_collect(bxilog__compressor_p self) {
+    int rc = pthread_mutex_lock(&self->mutex);
+    bxiassert(0 == rc);
+    bxierr_p err = self->err;
+    self->err = BXIERR_OK;
+    rc = pthread_mutex_unlock(&self->mutex);
+    bxiassert(0 == rc);
+
+    return err;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void * _helper_thread(bxilog__compressor_p self) {
+    // On Linux, the nice value is per thread: only the helper is affected
+    pid_t tid = (pid_t) syscall(SYS_gettid);
+    int rc = setpriority(PRIO_PROCESS, (id_t) tid, HELPER_NICE);
+    // We just tune, so we don't care on error
+    UNUSED(rc);
+
+    rc = pthread_mutex_lock(&self->mutex);
+    bxiassert(0 == rc);
+    while (true) {
+        while (NULL == self->head && !self->exit) {
+            rc = pthread_cond_wait(&self->cond, &self->mutex);
+            bxiassert(0 == rc);
+        }
+        if (NULL == self->head) break;
+
+        bxilog__compressor_job_p job = self->head;
+        self->head = job->next;
+        if (NULL == self->head) self->tail = NULL;
+        rc = pthread_mutex_unlock(&self->mutex);
+        bxiassert(0 == rc);
+
+        bxierr_p err = _compress(job->filename);
+        BXIFREE(job->filename);
+        BXIFREE(job);
+
+        rc = pthread_mutex_lock(&self->mutex);
+        bxiassert(0 == rc);
+        BXIERR_CHAIN(self->err, err);
+    }
+    rc = pthread_mutex_unlock(&self->mutex);
+    bxiassert(0 == rc);
+
+    return NULL;
+}
+
+bxierr_p _compress(const char * filename) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    errno = 0;
+    int in = open(filename, O_RDONLY);
+    if (-1 == in) return bxierr_errno("Can't open %s", filename);
+
+    char * gzname = bxistr_new("%s%s", filename, BXILOG__COMPRESSOR_SUFFIX);
+    errno = 0;
+    int out = open(gzname, O_WRONLY | O_CREAT | O_TRUNC,
+                   S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (-1 == out) {
+        err = bxierr_errno("Can't open %s", gzname);
+        close(in);
+        BXIFREE(gzname);
+        return err;
+    }
+    gzFile gz = gzdopen(out, "wb");
+    bxiassert(NULL != gz);
+
+    char * buf = bximem_calloc(READ_SIZE);
+    while (true) {
+        errno = 0;
+        ssize_t n = read(in, buf, READ_SIZE);
+        if (0 == n) break;
+        if (0 > n) {
+            if (EINTR == errno) continue;
+            err2 = bxierr_errno("Calling read(%s) failed", filename);
+            BXIERR_CHAIN(err, err2);
+            break;
+        }
+        if (n != gzwrite(gz, buf, (unsigned) n)) {
+            int errnum;
+            const char * msg = gzerror(gz, &errnum);
+            err2 = bxierr_gen("Calling gzwrite(%s) failed: %s", gzname, msg);
+            BXIERR_CHAIN(err, err2);
+            break;
+        }
+    }
+    BXIFREE(buf);
+
+    // Closes out too
+    int rc = gzclose(gz);
+    if (Z_OK != rc && bxierr_isok(err)) {
+        err = bxierr_gen("Calling gzclose(%s) failed (rc=%d)", gzname, rc);
+    }
+    // The source file is not needed anymore in the page cache
+    rc = posix_fadvise(in, 0, 0, POSIX_FADV_DONTNEED);
+    UNUSED(rc);
+    close(in);
+
+    // Keep the uncompressed file on failure
+    errno = 0;
+    rc = unlink(bxierr_isok(err) ? filename : gzname);
+    if (0 != rc) {
+        err2 = bxierr_errno("Calling unlink(%s) failed",
+                            bxierr_isok(err) ? filename : gzname);
+        BXIERR_CHAIN(err, err2);
+    }
+    BXIFREE(gzname);
+
+    return err;
+}
@@ -0,0 +1,84 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_COMPRESSOR_IMPL_H
+#define BXILOG_COMPRESSOR_IMPL_H
+
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "bxi/base/err.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Suffix of compressed files
+#define BXILOG__COMPRESSOR_SUFFIX ".gz"
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef struct bxilog__compressor_job_s bxilog__compressor_job_s;
+typedef bxilog__compressor_job_s * bxilog__compressor_job_p;
+
+struct bxilog__compressor_job_s {
+    char * filename;
+    bxilog__compressor_job_p next;
+};
+
+typedef struct bxilog__compressor_s bxilog__compressor_s;
+typedef bxilog__compressor_s * bxilog__compressor_p;
+
+/*
+ * Compress files (gzip format) on a low priority helper thread.
+ *
+ * Once compressed, a file is replaced by its BXILOG__COMPRESSOR_SUFFIX counterpart.
+ * Errors are kept until they are collected by the submitter.
+ */
+struct bxilog__compressor_s {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bxilog__compressor_job_p head;      // Pending jobs (mutex protected)
+    bxilog__compressor_job_p tail;
+    bxierr_p err;                       // Not collected yet (mutex protected)
+    bool exit;                          // Helper thread must exit (mutex protected)
+};
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/* Create a new compressor and start its helper thread */
+bxierr_p bxilog__compressor_new(bxilog__compressor_p * result);
+
+/*
+ * Compress all pending files, stop the helper thread and release the compressor.
+ *
+ * Errors not collected yet are returned.
+ */
+bxierr_p bxilog__compressor_destroy(bxilog__compressor_p * self_p);
+
+/* Queue the given file for compression, the compressor takes ownership of filename */
+void bxilog__compressor_submit(bxilog__compressor_p self, char * filename);
+
+/* Return the errors encountered since the last call */
+bxierr_p bxilog__compressor_collect(bxilog__compressor_p self);
+
+#endif
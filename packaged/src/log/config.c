@@ -137,9 +137,13 @@ bxilog_config_p bxilog_config_new(const char * const progname) {
     bxilog_config_p config = bximem_calloc(sizeof(*config));
     config->progname = strdup(progname);
     config->tsd_log_buf_size = 128;
+    config->deferred_formatting = false;
+    config->timestamp_source = BXITIME_SOURCE_REALTIME;
     config->handlers_nb = 0;
     config->ctrl_hwm = 1000;
     config->data_hwm = 1000;
+    config->transport = BXILOG_TRANSPORT_ZMQ;
+    config->ring_size = 1024;
 
     return config;
 }
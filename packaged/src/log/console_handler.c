@@ -44,6 +44,9 @@
 
 #define INTERNAL_LOGGER_NAME BXILOG_LIB_PREFIX "bxilog.handler.console"
 
+// Size of the private buffer of each output (stdout, stderr)
+#define OUTPUT_BUF_SIZE (64 * 1024)
+
 #define _ilog(level, data, ...) _internal_log_func(level, data, __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
 //*********************************************************************************
 //********************************** Types ****************************************
@@ -51,6 +54,21 @@
 typedef struct bxilog_console_handler_param_s_f * bxilog_console_handler_param_p;
 typedef struct log_single_line_param_s_f * log_single_line_param_p;
 
+/*
+ * Lines are formatted in buf and written with a single write() when the handler
+ * is done with a batch of logs, or when the other output is used (to keep the
+ * order of lines on a terminal shared by both outputs).
+ */
+typedef struct {
+    int fd;
+    char * buf;                         // OUTPUT_BUF_SIZE bytes
+    size_t used;
+    size_t lines_nb;                    // Number of complete lines in buf
+    bool line_lost;                     // The current line is already counted as lost
+} output_s;
+
+typedef output_s * output_p;
+
 typedef struct bxilog_console_handler_param_s_f {
     bxilog_handler_param_s generic;
 
@@ -63,6 +81,9 @@ typedef struct bxilog_console_handler_param_s_f {
     size_t lost_logs;
     int loggername_width;
     char ** colors;
+    output_s out;
+    output_s err;
+    output_p last;                      // Output of the last line
     bxierr_p (*display_out) (char * line,
                              size_t line_len,
                              bool last,
@@ -80,7 +101,7 @@ typedef struct log_single_line_param_s_f {
     const char *funcname;
     const char * loggername;
     const char *logmsg;
-    FILE* out;
+    output_p out;
 } log_single_line_param_s;
 
 
@@ -105,6 +126,9 @@ static bxierr_p _display_nocolor(char * line,
                                  size_t line_len,
                                  bool last,
                                  log_single_line_param_p param);
+static bxierr_p _process_log_batch(bxilog_batch_record_s * records,
+                                   size_t n,
+                                   bxilog_console_handler_param_p data);
 static bxierr_p _process_ierr(bxierr_p * err, bxilog_console_handler_param_p data);
 static bxierr_p _process_implicit_flush(bxilog_console_handler_param_p data);
 static bxierr_p _process_explicit_flush(bxilog_console_handler_param_p data);
@@ -113,6 +137,17 @@ static bxierr_p _process_cfg(bxilog_console_handler_param_p data);
 static bxierr_p _param_destroy(bxilog_console_handler_param_p *data_p);
 
 static bxierr_p _sync(bxilog_console_handler_param_p data);
+static void _prefix(output_p out,
+                    bxilog_console_handler_param_p data,
+                    bxilog_record_p record,
+                    const char * loggername);
+static void _append(output_p out,
+                    bxilog_console_handler_param_p data,
+                    const char * str,
+                    size_t len);
+static void _output_flush(output_p out, bxilog_console_handler_param_p data);
+static int _write(int fd, const char * buf, size_t len);
+static void _end_line(output_p out);
 
 static bxierr_p _internal_log_func(bxilog_level_e level,
                                    bxilog_console_handler_param_p data,
@@ -140,6 +175,9 @@ static const bxilog_handler_s BXILOG_CONSOLE_HANDLER_S = {
                   .process_exit = (bxierr_p (*) (bxilog_handler_param_p)) _process_exit,
                   .process_cfg = (bxierr_p (*) (bxilog_handler_param_p)) _process_cfg,
                   .param_destroy = (bxierr_p (*) (bxilog_handler_param_p*)) _param_destroy,
+                  .process_log_batch = (bxierr_p (*) (bxilog_batch_record_s *,
+                                                      size_t,
+                                                      bxilog_handler_param_p)) _process_log_batch,
 };
 
 const bxilog_handler_p BXILOG_CONSOLE_HANDLER = (bxilog_handler_p) &BXILOG_CONSOLE_HANDLER_S;
@@ -306,6 +344,12 @@ bxierr_p _init(bxilog_console_handler_param_p data) {
     data->errset = bxierr_set_new();
     data->max_err = 10;
     data->lost_logs = 0;
+    // Written without stdio: neither its locking nor its buffering are needed
+    data->out.fd = STDOUT_FILENO;
+    data->out.buf = bximem_calloc(OUTPUT_BUF_SIZE);
+    data->err.fd = STDERR_FILENO;
+    data->err.buf = bximem_calloc(OUTPUT_BUF_SIZE);
+    data->last = &data->out;
 
     return err;
 }
@@ -315,6 +359,8 @@ bxierr_p _process_exit(bxilog_console_handler_param_p data) {
 
     err2 = _sync(data);
     BXIERR_CHAIN(err, err2);
+    BXIFREE(data->out.buf);
+    BXIFREE(data->err.buf);
 
     if (data->lost_logs > 0) {
         char * str = bxistr_new("%s summary:\n"
@@ -367,14 +413,19 @@ inline bxierr_p _process_log(bxilog_record_p record,
     };
 
     bxierr_p err;
+    output_p out = (record->level > data->stderr_level) ? &data->out : &data->err;
+    if (out != data->last) {
+        // Lines written before must appear before
+        _output_flush(data->last, data);
+        data->last = out;
+    }
+    param.out = out;
     if (record->level > data->stderr_level) {
-        param.out = stdout;
         err = bxistr_apply_lines(logmsg,
                                  record->logmsg_len - 1, // Exclude the NULL terminating byte
                                  (bxierr_p (*)(char*, size_t, bool, void*)) data->display_out,
                                  &param);
     } else {
-        param.out = stderr;
         err = bxistr_apply_lines(logmsg,
                                  record->logmsg_len - 1,
                                  (bxierr_p (*)(char*, size_t, bool, void*)) data->display_err,
@@ -384,6 +435,23 @@ inline bxierr_p _process_log(bxilog_record_p record,
     return err;
 }
 
+bxierr_p _process_log_batch(bxilog_batch_record_s * records,
+                            size_t n,
+                            bxilog_console_handler_param_p data) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    for (size_t i = 0; i < n; i++) {
+        bxilog_batch_record_s * log = &records[i];
+        err2 = _process_log(log->record, log->filename, log->funcname,
+                            log->loggername, log->logmsg, data);
+        BXIERR_CHAIN(err, err2);
+    }
+    // The whole batch at once
+    _output_flush(data->last, data);
+
+    return err;
+}
+
 bxierr_p _process_ierr(bxierr_p *err, bxilog_console_handler_param_p data) {
     bxierr_p result = BXIERR_OK;
 
@@ -423,7 +491,7 @@ bxierr_p _process_ierr(bxierr_p *err, bxilog_console_handler_param_p data) {
 
 bxierr_p _process_cfg(bxilog_console_handler_param_p data) {
     UNUSED(data);
-    bxiunreachable_statement;
+    // Filters are applied before records reach us: nothing to do
     return BXIERR_OK;
 }
 
@@ -439,30 +507,83 @@ inline bxierr_p _param_destroy(bxilog_console_handler_param_p * data_p) {
 
 
 bxierr_p _sync(bxilog_console_handler_param_p data) {
-    UNUSED(data);
+    // Only the last output may have pending lines
+    _output_flush(data->last, data);
 
-    bxierr_p err = BXIERR_OK;
+    return BXIERR_OK;
+}
 
-    errno = 0;
-    int rc = fflush(stderr);
-    // We just don't care!
-//    if (0 != rc) {
-//        err2 = bxierr_errno("Calling fflush(stderr) failed");
-//        BXIERR_CHAIN(err, err2);
-//    }
+void _prefix(output_p out,
+             bxilog_console_handler_param_p data,
+             bxilog_record_p record,
+             const char * loggername) {
+    if (BXILOG_OUTPUT == record->level) return;
+
+    const char level[] = {'[', LOG_LEVEL_STR[record->level], ']', ' '};
+    _append(out, data, level, ARRAYLEN(level));
+
+    // Equivalent to "%-*.*s ": truncated or padded to the logger name width
+    const size_t width = (size_t) data->loggername_width;
+    const char * end = memchr(loggername, '\0', width);
+    const size_t len = (NULL == end) ? width : (size_t) (end - loggername);
+    _append(out, data, loggername, len);
+    for (size_t i = len; i <= width; i++) _append(out, data, " ", 1);
+}
 
-    errno = 0;
-    rc = fflush(stdout);
-    // We just don't care!
-//    if (0 != rc) {
-//        err2 = bxierr_errno("Calling fflush(stdout) failed");
-//        BXIERR_CHAIN(err, err2);
-//    }
+void _append(output_p out,
+             bxilog_console_handler_param_p data,
+             const char * str,
+             size_t len) {
+    if (OUTPUT_BUF_SIZE - out->used < len) {
+        _output_flush(out, data);
+        if (OUTPUT_BUF_SIZE < len) {
+            // Not worth a copy
+            int error = _write(out->fd, str, len);
+            // We just don't care but for the summary, once per line
+            if (0 != error && !out->line_lost) {
+                data->lost_logs++;
+                out->line_lost = true;
+            }
+            return;
+        }
+    }
+    memcpy(out->buf + out->used, str, len);
+    out->used += len;
+}
 
-    UNUSED(rc);
-    //UNUSED(err2);
+void _output_flush(output_p out, bxilog_console_handler_param_p data) {
+    if (0 == out->used) return;
 
-    return err;
+    int error = _write(out->fd, out->buf, out->used);
+    // We just don't care but for the summary
+    if (0 != error) data->lost_logs += out->lines_nb;
+
+    out->used = 0;
+    out->lines_nb = 0;
+}
+
+void _end_line(output_p out) {
+    // A line already counted as lost is not counted again if buf is lost too
+    if (out->line_lost) {
+        out->line_lost = false;
+    } else {
+        out->lines_nb++;
+    }
+}
+
+int _write(int fd, const char * buf, size_t len) {
+    while (0 < len) {
+        errno = 0;
+        ssize_t n = write(fd, buf, len);
+        if (0 > n) {
+            if (EINTR == errno) continue;
+            return errno;
+        }
+        if (0 == n) return EIO;
+        buf += n;
+        len -= (size_t) n;
+    }
+    return 0;
 }
 
 
@@ -511,6 +632,8 @@ bxierr_p _internal_log_func(bxilog_level_e level,
                         msg,
                         data);
     BXIERR_CHAIN(err, err2);
+    // Internal logs are rare and important
+    _output_flush(data->last, data);
 
     BXIFREE(msg);
 
@@ -524,27 +647,13 @@ inline bxierr_p _display_nocolor(char * line,
                                  log_single_line_param_p param) {
 
     UNUSED(last);
-    bxilog_record_p record = param->record;
-
-    int rc;
-    if (BXILOG_OUTPUT != record->level) {
-        rc = fprintf(param->out, "[%c] %-*.*s ",
-                     LOG_LEVEL_STR[record->level],
-                     param->data->loggername_width,
-                     param->data->loggername_width,
-                     param->loggername);
-    }
-
-    for (size_t i = 0; i < line_len; i++) {
-        fputc(line[i], param->out);
-    }
-    fputc('\n', param->out);
+    bxilog_console_handler_param_p data = param->data;
+    output_p out = param->out;
 
-    UNUSED(rc);
-    // We just don't care!
-//    if (rc < 0) {
-//        return bxierr_errno("Calling fprintf() failed");
-//    }
+    _prefix(out, data, param->record, param->loggername);
+    _append(out, data, line, line_len);
+    _append(out, data, "\n", 1);
+    _end_line(out);
 
     return BXIERR_OK;
 }
@@ -556,32 +665,14 @@ inline bxierr_p _display_color(char * line,
     UNUSED(last);
     bxilog_console_handler_param_p data = param->data;
     bxilog_record_p record = param->record;
-
-    errno = 0;
-    int rc;
-    if (BXILOG_OUTPUT != record->level) {
-        rc = fprintf(param->out, "%s[%c] %-*.*s ",
-                     data->colors[record->level],
-                     LOG_LEVEL_STR[record->level],
-                     data->loggername_width,
-                     data->loggername_width,
-                     param->loggername);
-    } else {
-        rc = fprintf(param->out, "%s",
-                     data->colors[record->level]);
-    }
-
-    for (size_t i = 0; i < line_len; i++) {
-        fputc(line[i], param->out);
-    }
-    fputs(RESET_COLORS, param->out);
-    fputc('\n', param->out);
-
-    UNUSED(rc);
-    // We just don't care!
-//    if (rc < 0) {
-//        return bxierr_errno("Calling fprintf() failed");
-//    }
+    output_p out = param->out;
+
+    const char * color = data->colors[record->level];
+    _append(out, data, color, strlen(color));
+    _prefix(out, data, record, param->loggername);
+    _append(out, data, line, line_len);
+    _append(out, data, RESET_COLORS "\n", ARRAYLEN(RESET_COLORS "\n") - 1);
+    _end_line(out);
 
     return BXIERR_OK;
 }
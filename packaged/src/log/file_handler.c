@@ -33,6 +33,10 @@
 
 #include "handler_impl.h"
 #include "log_impl.h"
+#include "io_impl.h"
+#include "binfile_impl.h"
+#include "compressor_impl.h"
+#include "filter_impl.h"
 
 #include "bxi/base/log/file_handler.h"
 
@@ -44,6 +48,8 @@
 
 #define INTERNAL_LOGGER_NAME BXILOG_LIB_PREFIX "bxilog.handler.file"
 #define DEFAULT_BLOCKS_NB 4
+// Size of a mapped segment in mmap mode, in number of buffers
+#define MMAP_SEGMENT_BUFS 64
 
 // WARNING: highly dependent on the log format
 #define YEAR_SIZE 4
@@ -56,6 +62,8 @@
 #define PID_SIZE 5
 #define TID_SIZE 5
 #define THREAD_RANK_SIZE 5
+#define DATE_SIZE (YEAR_SIZE + MONTH_SIZE + DAY_SIZE +\
+                   1 + HOUR_SIZE + MINUTE_SIZE + SECOND_SIZE)
 
 // WARNING: highly dependent on the log format
 #ifdef __linux__
@@ -93,14 +101,36 @@ typedef struct bxilog_file_handler_param_s_f {
     pid_t tid;
 #endif
     uintptr_t thread_rank;
+    time_t date_sec;                // second of the cached date
+    size_t date_len;
+    char date[DATE_SIZE + 8];       // cached "YYYYMMDDTHHMMSS" (years may be longer)
     bxierr_set_p errset;
     size_t err_max;
-    bool dirty;
+    bxilog__io_p io;                // where formatted lines are written
+    bool binary;                    // true for BXILOG_FILE_HANDLER_BINARY
+    bxilog__binfile_writer_p writer;// builds binary blocks (binary mode only)
+    bxilog_file_handler_io_e io_mode;
+    bxilog_file_handler_msync_e msync;
+    size_t file_size;               // current file size (as far as we know)
+    size_t bytes_written;           // by the I/O engines of rotated files
     size_t bytes_lost;
-    size_t bytes_written;
-    size_t next_char;
-    size_t buf_size;
-    char * buf;
+    size_t rotate_size;             // 0 for no size based rotation
+    time_t rotate_interval;         // 0 for no time based rotation
+    time_t rotate_next;             // when the next time based rotation occurs
+    bool rotate_compress;
+    bxilog__compressor_p compressor;// compresses rotated files (if requested)
+    int compression;                // zlib level of the stream, 0 for none
+    bxilog_file_handler_durability_e durability;
+    long sync_period_ms;            // durability period (periodic policy only)
+    bxilog_level_e sync_level;      // records made durable once written
+    size_t synced_size;             // file_size at the last sync request
+    bool sync_unconfirmed;          // a sync request has not been waited for
+    bool sync_deferred;             // a sync is due once the previous one is done
+    struct timespec last_sync;      // when the last sync was requested
+    bxilog_file_handler_param_p * routes;   // other files written by this handler
+    size_t routes_nb;
+    bxilog_filters_p main_filters;          // the main file filters, NULL for all
+    bxilog__filters_trie_p route_filters;   // the file filters, compiled (NULL for all)
 } bxilog_file_handler_param_s;
 
 typedef struct {
@@ -127,6 +157,19 @@ static bxierr_p _process_log(bxilog_record_p record,
                              char * loggername,
                              char * logmsg,
                              bxilog_file_handler_param_p data);
+static bxierr_p _process_log_binary(bxilog_record_p record,
+                                    char * filename,
+                                    char * funcname,
+                                    char * loggername,
+                                    char * logmsg,
+                                    bxilog_file_handler_param_p data);
+static bxierr_p _process_log_batch(bxilog_batch_record_s * records,
+                                   size_t n,
+                                   bxilog_file_handler_param_p data);
+static bxierr_p _write_records(bxilog_file_handler_param_p data,
+                               bxilog_batch_record_s * records,
+                               size_t n,
+                               bxilog__filters_trie_p filters);
 static bxierr_p _process_ierr(bxierr_p * err, bxilog_file_handler_param_p data);
 static bxierr_p _process_implicit_flush(bxilog_file_handler_param_p data);
 static bxierr_p _process_explicit_flush(bxilog_file_handler_param_p data);
@@ -135,31 +178,34 @@ static bxierr_p _process_cfg(bxilog_file_handler_param_p data);
 static bxierr_p _param_destroy(bxilog_file_handler_param_p *data_p);
 
 static bxierr_p _get_file_fd(bxilog_file_handler_param_p data);
+static bxierr_p _init_route(bxilog_file_handler_param_p route,
+                            bxilog_file_handler_param_p data);
+static bxierr_p _open_io(bxilog_file_handler_param_p data);
+static bxierr_p _close_io(bxilog_file_handler_param_p data);
+static void _check_rotation(bxilog_file_handler_param_p data, time_t now);
+static bxierr_p _rotate(bxilog_file_handler_param_p data, time_t now);
+static char * _rotated_name(bxilog_file_handler_param_p data, time_t now);
 
 static bxierr_p _log_single_line(char * line,
                              size_t line_len,
                              bool last,
                              log_single_line_param_p param);
 
-static size_t _mkmsg(const size_t n, char buf[n],
-                     const char level,
-                     const struct timespec * const detail_time,
-                     const pid_t pid,
-#ifdef __linux__
-                     const pid_t tid,
-#endif
-                     const uintptr_t thread_rank,
-                     const char * const progname,
-                     const char * const filename,
-                     const int line_nb,
-                     const char * const funcname,
-                     const char * const loggername,
-                     const char * const logmsg,
-                     size_t line_len);
-
-static bxierr_p _flush(bxilog_file_handler_param_p data);
-static bxierr_p _write(bxilog_file_handler_param_p data, const void * buf, size_t count);
-static bxierr_p _sync(bxilog_file_handler_param_p data);
+static size_t _prefix_size(log_single_line_param_p param);
+static void _mkmsg(log_single_line_param_p param,
+                   const char * line, size_t line_len,
+                   char * buf);
+static void _update_date(bxilog_file_handler_param_p data, time_t sec);
+static size_t _dec_width(uint64_t value, size_t width);
+static size_t _hex_width(uint64_t value, size_t width);
+static char * _write_dec(char * p, uint64_t value, size_t width);
+static char * _write_hex(char * p, uint64_t value, size_t width);
+
+static bxierr_p _flush(bxilog_file_handler_param_p data, bool wait);
+static bxierr_p _check_io(bxilog_file_handler_param_p data, bxierr_p err);
+static bxierr_p _write_block(bxilog_file_handler_param_p data, char * block, size_t len);
+static bxierr_p _sync(bxilog_file_handler_param_p data, bool wait);
+static bool _sync_required(bxilog_file_handler_param_p data);
 static void _tune_io(bxilog_file_handler_param_p data);
 static bxierr_p _internal_log_func(bxilog_level_e level,
                                    bxilog_file_handler_param_p data,
@@ -175,14 +221,15 @@ static void _record_new_error(bxilog_file_handler_param_p data, bxierr_p * err);
 // The various log levels specific characters
 const char BXILOG_FILE_HANDLER_LOG_LEVEL_STR[] = { '-', 'P', 'A', 'C', 'E', 'W', 'N', 'O',
                                                    'I', 'D', 'F', 'T', 'L'};
-// The log format used by the IHT when writing
+// The log format used by the IHT when writing is hand-rolled by _mkmsg(), it is
+// equivalent to the following printf() format:
+// "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u=%0*" PRIxPTR ":%s|%s:%d@%s|%s|%s\n"
 // WARNING: If you change this format, change also different #define above
-// along with FIXED_LOG_SIZE
-#ifdef __linux__
-static const char LOG_FMT[] = "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u=%0*" PRIxPTR ":%s|%s:%d@%s|%s|";
-#else
-static const char LOG_FMT[] = "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u:%s|%s:%d@%s|%s|";
-#endif
+// along with FIXED_LOG_SIZE, and bxilog-parser
+
+// Two ASCII digits for each number from 0 to 99
+static const char DIGITS_PAIRS[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+static const char HEX_DIGITS[] = "0123456789abcdef";
 
 static const bxilog_handler_s BXILOG_FILE_HANDLER_S = {
                   .name = "BXI Logging File Handler",
@@ -200,9 +247,34 @@ static const bxilog_handler_s BXILOG_FILE_HANDLER_S = {
                   .process_exit = (bxierr_p (*) (bxilog_handler_param_p)) _process_exit,
                   .process_cfg = (bxierr_p (*) (bxilog_handler_param_p)) _process_cfg,
                   .param_destroy = (bxierr_p (*) (bxilog_handler_param_p*)) _param_destroy,
+                  .process_log_batch = (bxierr_p (*) (bxilog_batch_record_s *,
+                                                      size_t,
+                                                      bxilog_handler_param_p)) _process_log_batch,
 };
 const bxilog_handler_p BXILOG_FILE_HANDLER = (bxilog_handler_p) &BXILOG_FILE_HANDLER_S;
 
+static const bxilog_handler_s BXILOG_FILE_HANDLER_BINARY_S = {
+                  .name = "BXI Logging Binary File Handler",
+                  .param_new = _param_new,
+                  .init = (bxierr_p (*) (bxilog_handler_param_p)) _init,
+                  .process_log = (bxierr_p (*)(bxilog_record_p record,
+                                               char * filename,
+                                               char * funcname,
+                                               char * loggername,
+                                               char * logmsg,
+                                               bxilog_handler_param_p param)) _process_log_binary,
+                  .process_ierr = (bxierr_p (*) (bxierr_p*, bxilog_handler_param_p)) _process_ierr,
+                  .process_implicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_implicit_flush,
+                  .process_explicit_flush = (bxierr_p (*) (bxilog_handler_param_p)) _process_explicit_flush,
+                  .process_exit = (bxierr_p (*) (bxilog_handler_param_p)) _process_exit,
+                  .process_cfg = (bxierr_p (*) (bxilog_handler_param_p)) _process_cfg,
+                  .param_destroy = (bxierr_p (*) (bxilog_handler_param_p*)) _param_destroy,
+                  .process_log_batch = (bxierr_p (*) (bxilog_batch_record_s *,
+                                                      size_t,
+                                                      bxilog_handler_param_p)) _process_log_batch,
+};
+const bxilog_handler_p BXILOG_FILE_HANDLER_BINARY = (bxilog_handler_p) &BXILOG_FILE_HANDLER_BINARY_S;
+
 //*********************************************************************************
 //********************************** Implementation    ****************************
 //*********************************************************************************
@@ -211,7 +283,7 @@ bxilog_handler_param_p _param_new(bxilog_handler_p self,
                                   bxilog_filters_p filters,
                                   va_list ap) {
 
-    bxiassert(BXILOG_FILE_HANDLER == self);
+    bxiassert(BXILOG_FILE_HANDLER == self || BXILOG_FILE_HANDLER_BINARY == self);
 
     char * progname = va_arg(ap, char *);
     char * filename = va_arg(ap, char *);
@@ -225,10 +297,95 @@ bxilog_handler_param_p _param_new(bxilog_handler_p self,
     result->open_flags = open_flags;
     result->progname = strdup(progname);
     result->progname_len = strlen(progname) + 1; // Include the NULL terminal byte
+    result->binary = BXILOG_FILE_HANDLER_BINARY == self;
+    result->io_mode = BXILOG_FILE_HANDLER_IO_WRITE;
+    result->msync = BXILOG_FILE_HANDLER_MSYNC_ASYNC;
+    result->durability = BXILOG_FILE_HANDLER_DURABILITY_NONE;
+    result->sync_level = BXILOG_OFF;
 
     return (bxilog_handler_param_p) result;
 }
 
+void bxilog_file_handler_set_io(bxilog_handler_param_p param,
+                                bxilog_file_handler_io_e io,
+                                bxilog_file_handler_msync_e msync) {
+    bxiassert(NULL != param);
+
+    bxilog_file_handler_param_p data = (bxilog_file_handler_param_p) param;
+    data->io_mode = io;
+    data->msync = msync;
+}
+
+void bxilog_file_handler_set_rotation(bxilog_handler_param_p param,
+                                      size_t max_size,
+                                      size_t interval,
+                                      bool compress) {
+    bxiassert(NULL != param);
+
+    bxilog_file_handler_param_p data = (bxilog_file_handler_param_p) param;
+    data->rotate_size = max_size;
+    data->rotate_interval = (time_t) interval;
+    data->rotate_compress = compress;
+}
+
+void bxilog_file_handler_set_compression(bxilog_handler_param_p param, int level) {
+    bxiassert(NULL != param);
+    bxiassert(0 <= level && 9 >= level);
+
+    bxilog_file_handler_param_p data = (bxilog_file_handler_param_p) param;
+    data->compression = level;
+}
+
+void bxilog_file_handler_set_durability(bxilog_handler_param_p param,
+                                        bxilog_file_handler_durability_e durability,
+                                        long period_ms,
+                                        bxilog_level_e sync_level) {
+    bxiassert(NULL != param);
+    bxiassert(0 <= period_ms);
+    bxiassert(BXILOG_LOWEST >= sync_level);
+
+    bxilog_file_handler_param_p data = (bxilog_file_handler_param_p) param;
+    data->durability = durability;
+    data->sync_period_ms = period_ms;
+    data->sync_level = sync_level;
+}
+
+void bxilog_file_handler_add_route(bxilog_handler_param_p param,
+                                   bxilog_filters_p filters,
+                                   const char * filename) {
+    bxiassert(NULL != param);
+    bxiassert(NULL != filters);
+    bxiassert(NULL != filename);
+
+    bxilog_file_handler_param_p data = (bxilog_file_handler_param_p) param;
+
+    // A route is written by the handler thread as the main file: only the filters
+    // and the file differ, other settings are taken from the main file at init
+    bxilog_file_handler_param_p route = bximem_calloc(sizeof(*route));
+    route->generic.filters = filters;
+    route->filename = strdup(filename);
+    route->progname = strdup(data->progname);
+    route->progname_len = data->progname_len;
+    route->open_flags = data->open_flags;
+    route->binary = data->binary;
+
+    data->routes = bximem_realloc(data->routes,
+                                  data->routes_nb * sizeof(*data->routes),
+                                  (data->routes_nb + 1) * sizeof(*data->routes));
+    data->routes[data->routes_nb] = route;
+    data->routes_nb++;
+}
+
+void bxilog_file_handler_set_main_filters(bxilog_handler_param_p param,
+                                          bxilog_filters_p filters) {
+    bxiassert(NULL != param);
+    bxiassert(NULL != filters);
+
+    bxilog_file_handler_param_p data = (bxilog_file_handler_param_p) param;
+    bxilog_filters_destroy(&data->main_filters);
+    data->main_filters = filters;
+}
+
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
@@ -244,37 +401,54 @@ bxierr_p _init(bxilog_file_handler_param_p data) {
     // Maybe, define already the related string instead of
     // a rank number?
     data->thread_rank = (uintptr_t) pthread_self();
+    data->date_sec = -1;
+    data->date_len = 0;
     data->errset = bxierr_set_new();
     data->err_max = 10;
-    data->bytes_lost = 0;
-    data->bytes_written = 0;
-    data->dirty = false;
+    err2 = bxitime_get(CLOCK_MONOTONIC, &data->last_sync);
+    BXIERR_CHAIN(err, err2);
 
     err2 = _get_file_fd(data);
     BXIERR_CHAIN(err, err2);
 
-    errno = 0;
-    struct stat st;
-    int rc = fstat(data->fd, &st);
-    if (0 != rc) {
-        err2 = bxierr_errno("Calling fstat(%s) failed", data->filename);
-        BXIERR_CHAIN(err, err2);
-        data->buf_size = 4 * 1024  * sizeof(*data->buf) * DEFAULT_BLOCKS_NB;
-    } else {
-        data->buf_size = ((size_t) st.st_blksize) * sizeof(*data->buf) * DEFAULT_BLOCKS_NB;
+    if (data->binary) {
+        data->writer = bxilog__binfile_writer_new(data->progname, data->compression);
     }
-//    data->buf_size = 241 * sizeof(*data->buf) * DEFAULT_BLOCKS_NB;
-    size_t align = (size_t) sysconf(_SC_PAGESIZE);
 
-    errno = 0;
-    rc = posix_memalign((void**) &data->buf, align, data->buf_size);
-    if (0 != rc) {
-        err2 = bxierr_errno("Calling posix_memalign(%ld, %zu) failed",
-                            align, data->buf_size);
-        BXIERR_CHAIN(err, err2);
+    err2 = _open_io(data);
+    BXIERR_CHAIN(err, err2);
+
+    if (0 < data->rotate_size || 0 < data->rotate_interval) {
+        struct stat st;
+        int rc = fstat(data->fd, &st);
+        if (0 != rc || !S_ISREG(st.st_mode) ||
+            STDOUT_FILENO == data->fd || STDERR_FILENO == data->fd) {
+            // Only named regular files can be rotated
+            data->rotate_size = 0;
+            data->rotate_interval = 0;
+        } else if (0 < data->rotate_interval) {
+            struct timespec now;
+            err2 = bxitime_get(CLOCK_REALTIME, &now);
+            BXIERR_CHAIN(err, err2);
+            data->rotate_next = (now.tv_sec / data->rotate_interval + 1) *
+                                data->rotate_interval;
+        }
+        const bool rotate = 0 < data->rotate_size || 0 < data->rotate_interval;
+        // Compressing an already compressed stream is useless
+        if (rotate && data->rotate_compress && 0 == data->compression) {
+            err2 = bxilog__compressor_new(&data->compressor);
+            BXIERR_CHAIN(err, err2);
+        }
     }
 
-    _tune_io(data);
+    // Routes have no main filters: theirs are compiled by _init_route()
+    if (NULL != data->main_filters) {
+        data->route_filters = bxilog__filters_trie_new(data->main_filters);
+    }
+    for (size_t i = 0; i < data->routes_nb; i++) {
+        err2 = _init_route(data->routes[i], data);
+        BXIERR_CHAIN(err, err2);
+    }
 
 //    fprintf(stderr, "%d.%d: Initialization: ok\n", data->pid, data->tid);
     return err;
@@ -283,38 +457,30 @@ bxierr_p _init(bxilog_file_handler_param_p data) {
 bxierr_p _process_exit(bxilog_file_handler_param_p data) {
     bxierr_p err = BXIERR_OK, err2;
 
-    if (0 < data->fd) {
-//        err2 = _ilog(BXILOG_TRACE, data,
-//                     "Total of %zu bytes written (excluding this message)",
-//                     data->bytes_written);
-//        BXIERR_CHAIN(err, err2);
-
-//        if (bxierr_isko(err)) {
-//            char * err_msg = bxierr_str(err);
-//            bxilog_rawprint(err_msg, STDERR_FILENO);
-//            BXIFREE(err_msg);
-//            bxierr_destroy(&err);
-//        }
-
-        err2 = _sync(data);
+    for (size_t i = 0; i < data->routes_nb; i++) {
+        err2 = _process_exit(data->routes[i]);
         BXIERR_CHAIN(err, err2);
-        errno = 0;
-        if (STDOUT_FILENO != data->fd && STDERR_FILENO != data->fd) {
-            int rc = close(data->fd);
-            if (-1 == rc) {
-                err2 = bxierr_errno("Closing logging file '%s' failed", data->filename);
-                BXIERR_CHAIN(err, err2);
-            }
-        }
     }
+    bxilog__filters_trie_destroy(&data->route_filters);
+
+    // Everything must be on disk before the summary and the close
+    err2 = _close_io(data);
+    BXIERR_CHAIN(err, err2);
+    bxilog__binfile_writer_destroy(&data->writer);
+    const size_t bytes_written = data->bytes_written;
+    const size_t bytes_lost = data->bytes_lost;
+
+    // Files rotated so far are compressed before exiting
+    err2 = bxilog__compressor_destroy(&data->compressor);
+    BXIERR_CHAIN(err, err2);
 
-    if (data->bytes_lost > 0) {
+    if (bytes_lost > 0) {
         char * str = bxistr_new("BXI Log File Handler Error Summary:\n"
                                 "\tNumber of bytes written: %zu\n"
                                 "\tNumber of bytes lost: %zu\n"
                                 "\tNumber of reported distinct errors: %zu\n",
-                                data->bytes_written,
-                                data->bytes_lost,
+                                bytes_written,
+                                bytes_lost,
                                 data->errset->distinct_err.errors_nb);
         bxilog_rawprint(str, STDERR_FILENO);
         BXIFREE(str);
@@ -328,7 +494,6 @@ bxierr_p _process_exit(bxilog_file_handler_param_p data) {
     } else {
         bxierr_set_destroy(&data->errset);
     }
-    BXIFREE(data->buf);
 
 //    fprintf(stderr, "%d.%d: process_exit: ok\n", data->pid, data->tid);
     return err;
@@ -337,11 +502,32 @@ bxierr_p _process_exit(bxilog_file_handler_param_p data) {
 inline bxierr_p _process_implicit_flush(bxilog_file_handler_param_p data) {
     bxierr_p err = BXIERR_OK, err2;
 
-    err2 = _flush(data);
+    // Nobody waits for it: let the I/O complete in the background
+    err2 = _flush(data, false);
     BXIERR_CHAIN(err, err2);
 
-    err2 = _sync(data);
-    BXIERR_CHAIN(err, err2);
+    if (0 < data->rotate_interval) {
+        // No log may come for a while
+        struct timespec now;
+        err2 = bxitime_get(CLOCK_REALTIME, &now);
+        BXIERR_CHAIN(err, err2);
+        _check_rotation(data, now.tv_sec);
+    }
+    if (NULL != data->compressor) {
+        err2 = bxilog__compressor_collect(data->compressor);
+        if (bxierr_isko(err2)) _record_new_error(data, &err2);
+    }
+
+    if (data->sync_deferred || _sync_required(data)) {
+        // Nobody waits for it either
+        err2 = _sync(data, false);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    for (size_t i = 0; i < data->routes_nb; i++) {
+        err2 = _process_implicit_flush(data->routes[i]);
+        BXIERR_CHAIN(err, err2);
+    }
 
     return err;
 
@@ -353,12 +539,23 @@ inline bxierr_p _process_explicit_flush(bxilog_file_handler_param_p data) {
 //    err2 = _ilog(BXILOG_TRACE, data, "Flushing requested");
 //    BXIERR_CHAIN(err, err2);
 //    fprintf(stderr, "Flushing\n");
-    err2 = _flush(data);
+    err2 = _flush(data, true);
 //    fprintf(stderr, "Flushed\n");
     BXIERR_CHAIN(err, err2);
 
-    err2 = _sync(data);
-    BXIERR_CHAIN(err, err2);
+    // The caller of bxilog_flush() is notified once the reply is sent: wait for
+    // syncs still in progress as well, whatever requested them
+    if (BXILOG_FILE_HANDLER_DURABILITY_NONE != data->durability ||
+        BXILOG_OFF != data->sync_level ||
+        data->sync_deferred || data->sync_unconfirmed) {
+        err2 = _sync(data, true);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    for (size_t i = 0; i < data->routes_nb; i++) {
+        err2 = _process_explicit_flush(data->routes[i]);
+        BXIERR_CHAIN(err, err2);
+    }
 
 //    err2 = _ilog(BXILOG_TRACE, data, "Flushed");
 //    BXIERR_CHAIN(err, err2);
@@ -381,6 +578,8 @@ inline bxierr_p _process_log(bxilog_record_p record,
                                      .loggername = loggername,
                                      .logmsg = logmsg,
     };
+    // A record is never split over two files
+    _check_rotation(data, record->detail_time.tv_sec);
 //    fprintf(stderr, "Processing log\n");
     bxierr_p err = bxistr_apply_lines(logmsg,
                                       record->logmsg_len - 1,
@@ -393,6 +592,82 @@ inline bxierr_p _process_log(bxilog_record_p record,
 }
 
 
+inline bxierr_p _process_log_binary(bxilog_record_p record,
+                                    char * filename,
+                                    char * funcname,
+                                    char * loggername,
+                                    char * logmsg,
+                                    bxilog_file_handler_param_p data) {
+
+    _check_rotation(data, record->detail_time.tv_sec);
+
+    char * block;
+    size_t block_len;
+    // Multi-line messages are kept as is, readers split them when rendering
+    bxilog__binfile_writer_add(data->writer, record,
+                               filename, funcname, loggername, logmsg,
+                               &block, &block_len);
+    if (NULL == block) return BXIERR_OK;
+
+    return _write_block(data, block, block_len);
+}
+
+
+bxierr_p _process_log_batch(bxilog_batch_record_s * records,
+                            size_t n,
+                            bxilog_file_handler_param_p data) {
+    // Records are shared by all files: they are received only once by the handler
+    bxierr_p err = _write_records(data, records, n, data->route_filters);
+    for (size_t i = 0; i < data->routes_nb && bxierr_isok(err); i++) {
+        bxilog_file_handler_param_p route = data->routes[i];
+        err = _write_records(route, records, n, route->route_filters);
+    }
+
+    return err;
+}
+
+bxierr_p _write_records(bxilog_file_handler_param_p data,
+                        bxilog_batch_record_s * records,
+                        size_t n,
+                        bxilog__filters_trie_p filters) {
+    bxierr_p err = BXIERR_OK, err2;
+    bool sync = false;
+
+    for (size_t i = 0; i < n && bxierr_isok(err); i++) {
+        bxilog_batch_record_s * log = &records[i];
+        if (NULL != filters &&
+            log->record->level > bxilog__filters_trie_level(filters, NULL,
+                                                            log->loggername,
+                                                            log->record->logname_len)) {
+            continue;
+        }
+        if (data->binary) {
+            err = _process_log_binary(log->record, log->filename, log->funcname,
+                                      log->loggername, log->logmsg, data);
+        } else {
+            err = _process_log(log->record, log->filename, log->funcname,
+                               log->loggername, log->logmsg, data);
+        }
+        sync |= log->record->level <= data->sync_level;
+    }
+    if (bxierr_isko(err)) return err;
+    if (!sync && !data->sync_deferred) return err;
+
+    // Group commit: important records of the batch share a single sync. While the
+    // previous one is in progress, records are accumulated for the next one, done
+    // at the end of a following batch or at the next flush at the latest.
+    if (bxilog__io_sync_busy(data->io)) {
+        data->sync_deferred = true;
+        return err;
+    }
+    err2 = _flush(data, false);
+    BXIERR_CHAIN(err, err2);
+    err2 = _sync(data, false);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
 bxierr_p _process_ierr(bxierr_p *err, bxilog_file_handler_param_p data) {
     bxierr_p result = BXIERR_OK;
 
@@ -434,7 +709,7 @@ bxierr_p _process_ierr(bxierr_p *err, bxilog_file_handler_param_p data) {
 
 bxierr_p _process_cfg(bxilog_file_handler_param_p data) {
     UNUSED(data);
-    bxiunreachable_statement;
+    // Filters are applied before records reach us: nothing to do
     return BXIERR_OK;
 }
 
@@ -443,6 +718,11 @@ inline bxierr_p _param_destroy(bxilog_file_handler_param_p * data_p) {
 
     bxilog_handler_clean_param(&data->generic);
 
+    for (size_t i = 0; i < data->routes_nb; i++) {
+        _param_destroy(&data->routes[i]);
+    }
+    BXIFREE(data->routes);
+    bxilog_filters_destroy(&data->main_filters);
     BXIFREE(data->progname);
     BXIFREE(data->filename);
     bximem_destroy((char**) data_p);
@@ -458,113 +738,185 @@ bxierr_p _log_single_line(char * line,
     bxilog_file_handler_param_p data = param->data;
     bxilog_record_p record = param->record;
 
-    const size_t prefix_size = FIXED_LOG_SIZE + \
-            // Exclude NULL terminating byte from preprocessed length
-            data->progname_len - 1 + \
-            record->filename_len -1 + \
-            record->funcname_len - 1 + \
-            record->logname_len - 1 + \
-            bxistr_digits_nb(record->line_nb);
-
-    size_t size = prefix_size + line_len;
-
-    if (data->buf_size - data->next_char <= size) {
-        bxierr_p err = _flush(data);
-        bxierr_abort_ifko(err);
+    // Several records are usually produced within the same second: localtime_r()
+    // is only called once per second
+    if (data->date_sec != record->detail_time.tv_sec) {
+        _update_date(data, record->detail_time.tv_sec);
     }
 
+    const size_t size = _prefix_size(param) + line_len;
+
+    bxierr_p err = BXIERR_OK;
     char * buf;
-    if (size > data->buf_size) {
-        buf = bximem_calloc(size + 1); // Include the NULL terminating byte since we
-                                       // use a specific buffer.
+    const bool large = size > data->io->reserve_max;
+    if (large) {
+        // Given as is to the I/O engine which gathers it with the buffered lines
+        buf = bximem_calloc(size);
     } else {
-        buf = data->buf + data->next_char;
+        err = bxilog__io_reserve(data->io, size, &buf);
     }
 
-    // Include the NULL terminating byte in the size given to
-    // underlying snprintf() call, it is required.
-    _mkmsg(prefix_size + 1, buf,
-           BXILOG_FILE_HANDLER_LOG_LEVEL_STR[record->level],
-           &record->detail_time,
-           record->pid,
-#ifdef __linux__
-           record->tid,
-#endif
-           record->thread_rank,
-           data->progname,
-           param->filename,
-           record->line_nb,
-           param->funcname,
-           param->loggername,
-           line, line_len);
-
-    if (size > data->buf_size) {
-        bxierr_p err = _write(data, buf, size);
-        BXIFREE(buf);
-        return err;
+    _mkmsg(param, line, line_len, buf);
+    data->file_size += size;
+
+    if (large) {
+        err = bxilog__io_add(data->io, buf, size);
+    } else {
+        bxilog__io_commit(data->io, size);
     }
 
-    data->next_char += (size_t) size;
-    data->dirty = true;
-    bxiassert(data->next_char <= data->buf_size);
+    return _check_io(data, err);
+}
+
 
-    return BXIERR_OK;
+size_t _prefix_size(log_single_line_param_p param) {
+    bxilog_file_handler_param_p data = param->data;
+    bxilog_record_p record = param->record;
+
+    // Numbers larger than their width are not truncated
+    const size_t line_nb_size = (0 > record->line_nb ? 1 : 0) +
+                                bxistr_digits_nb(record->line_nb);
+
+    return FIXED_LOG_SIZE - PID_SIZE - THREAD_RANK_SIZE +
+#ifdef __linux__
+            _dec_width((uint64_t) (unsigned) record->tid, TID_SIZE) - TID_SIZE +
+#endif
+            _dec_width((uint64_t) (unsigned) record->pid, PID_SIZE) +
+            _hex_width(record->thread_rank, THREAD_RANK_SIZE) +
+            data->date_len - DATE_SIZE +
+            // Exclude NULL terminating byte from preprocessed length
+            data->progname_len - 1 +
+            record->filename_len - 1 +
+            record->funcname_len - 1 +
+            record->logname_len - 1 +
+            line_nb_size;
 }
 
+void _mkmsg(log_single_line_param_p param,
+            const char * line, size_t line_len,
+            char * buf) {
 
-size_t _mkmsg(const size_t n, char buf[n],
-               const char level,
-               const struct timespec * const detail_time,
-               const pid_t pid,
+    bxilog_file_handler_param_p data = param->data;
+    bxilog_record_p record = param->record;
+
+    // The cached date is up to date: see _log_single_line()
+    char * p = buf;
+    *p++ = BXILOG_FILE_HANDLER_LOG_LEVEL_STR[record->level];
+    *p++ = '|';
+    memcpy(p, data->date, data->date_len);
+    p += data->date_len;
+    *p++ = '.';
+    p = _write_dec(p, (uint64_t) record->detail_time.tv_nsec, SUBSECOND_SIZE);
+    *p++ = '|';
+    p = _write_dec(p, (uint64_t) (unsigned) record->pid, PID_SIZE);
+    *p++ = '.';
 #ifdef __linux__
-               const pid_t tid,
+    p = _write_dec(p, (uint64_t) (unsigned) record->tid, TID_SIZE);
+    *p++ = '=';
 #endif
-               const uintptr_t thread_rank,
-               const char * const progname,
-               const char * const filename,
-               const int line_nb,
-               const char * const funcname,
-               const char * const loggername,
-               const char * const logmsg,
-               size_t logmsg_len) {
+    p = _write_hex(p, record->thread_rank, THREAD_RANK_SIZE);
+    *p++ = ':';
+    memcpy(p, data->progname, data->progname_len - 1);
+    p += data->progname_len - 1;
+    *p++ = '|';
+    memcpy(p, param->filename, record->filename_len - 1);
+    p += record->filename_len - 1;
+    *p++ = ':';
+    if (0 > record->line_nb) {
+        *p++ = '-';
+        p = _write_dec(p, (uint64_t) -(int64_t) record->line_nb, 0);
+    } else {
+        p = _write_dec(p, (uint64_t) record->line_nb, 0);
+    }
+    *p++ = '@';
+    memcpy(p, param->funcname, record->funcname_len - 1);
+    p += record->funcname_len - 1;
+    *p++ = '|';
+    memcpy(p, param->loggername, record->logname_len - 1);
+    p += record->logname_len - 1;
+    *p++ = '|';
+    memcpy(p, line, line_len);
+    p += line_len;
+    *p++ = '\n';
+}
 
+void _update_date(bxilog_file_handler_param_p data, time_t sec) {
     errno = 0;
     struct tm dummy, *now;
-    now = localtime_r(&detail_time->tv_sec, &dummy);
+    now = localtime_r(&sec, &dummy);
     bxiassert(NULL != now);
 
-    int written = snprintf(buf, n, LOG_FMT,
-                           level,
-                           YEAR_SIZE, now->tm_year + 1900,
-                           MONTH_SIZE, now->tm_mon + 1,
-                           DAY_SIZE, now->tm_mday,
-                           HOUR_SIZE, now->tm_hour,
-                           MINUTE_SIZE, now->tm_min,
-                           SECOND_SIZE, now->tm_sec,
-                           SUBSECOND_SIZE, detail_time->tv_nsec,
-                           PID_SIZE, pid,
-#ifdef __linux__
-                           TID_SIZE, tid,
-#endif
-                           THREAD_RANK_SIZE, thread_rank,
-                           progname,
-                           filename,
-                           line_nb,
-                           funcname,
-                           loggername);
-    memcpy(buf + written, logmsg, logmsg_len);
-    buf[(size_t) written + logmsg_len] = '\n';
+    char * p = data->date;
+    p = _write_dec(p, (uint64_t) (now->tm_year + 1900), YEAR_SIZE);
+    p = _write_dec(p, (uint64_t) (now->tm_mon + 1), MONTH_SIZE);
+    p = _write_dec(p, (uint64_t) now->tm_mday, DAY_SIZE);
+    *p++ = 'T';
+    p = _write_dec(p, (uint64_t) now->tm_hour, HOUR_SIZE);
+    p = _write_dec(p, (uint64_t) now->tm_min, MINUTE_SIZE);
+    p = _write_dec(p, (uint64_t) now->tm_sec, SECOND_SIZE);
+
+    data->date_len = (size_t) (p - data->date);
+    data->date_sec = sec;
+}
 
+inline size_t _dec_width(uint64_t value, size_t width) {
+    size_t n = 1;
+    while (value >= 10) {
+        value /= 10;
+        n++;
+    }
+    return n > width ? n : width;
+}
+
+inline size_t _hex_width(uint64_t value, size_t width) {
+    size_t n = 1;
+    while (value >= 16) {
+        value >>= 4;
+        n++;
+    }
+    return n > width ? n : width;
+}
 
-    // WARNING: Truncation can happen if the logmsg is part of a larger string.
-    // Therefore the assertion below might not be true.
-    // If we want to guarantee that no truncation can happen, the logmsg in the
-    // original record string must be copied, and each '\n' might then be replaced by
-    // an '\0'. For speed reason, we don't do that: no copy -> faster.
-    //    bxiassert(written < (int)n);
+char * _write_dec(char * p, uint64_t value, size_t width) {
+    char tmp[20];
+    char * const end = tmp + sizeof(tmp);
+    char * q = end;
+
+    while (value >= 100) {
+        const size_t i = (size_t) (value % 100) * 2;
+        value /= 100;
+        q -= 2;
+        q[0] = DIGITS_PAIRS[i];
+        q[1] = DIGITS_PAIRS[i + 1];
+    }
+    if (value >= 10) {
+        q -= 2;
+        q[0] = DIGITS_PAIRS[value * 2];
+        q[1] = DIGITS_PAIRS[value * 2 + 1];
+    } else {
+        *--q = (char) ('0' + value);
+    }
 
-    bxiassert(written >= 0);
-    return (size_t) written + logmsg_len;
+    const size_t n = (size_t) (end - q);
+    for (size_t i = n; i < width; i++) *p++ = '0';
+    memcpy(p, q, n);
+    return p + n;
+}
+
+char * _write_hex(char * p, uint64_t value, size_t width) {
+    char tmp[16];
+    char * const end = tmp + sizeof(tmp);
+    char * q = end;
+
+    do {
+        *--q = HEX_DIGITS[value & 0xf];
+        value >>= 4;
+    } while (0 != value);
+
+    const size_t n = (size_t) (end - q);
+    for (size_t i = n; i < width; i++) *p++ = '0';
+    memcpy(p, q, n);
+    return p + n;
 }
 
 bxierr_p _get_file_fd(bxilog_file_handler_param_p data) {
@@ -574,9 +926,12 @@ bxierr_p _get_file_fd(bxilog_file_handler_param_p data) {
     } else if (0 == strncmp("+", data->filename, ARRAYLEN("+"))) {
         data->fd = STDERR_FILENO;
     } else {
+        // Shared writable mappings require the file to be opened for reading too
+        const int mode = (BXILOG_FILE_HANDLER_IO_MMAP == data->io_mode) ? O_RDWR
+                                                                         : O_WRONLY;
         errno = 0;
         data->fd = open(data->filename,
-                        O_WRONLY | data->open_flags,
+                        mode | data->open_flags,
                         S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
         if (-1 == data->fd) return bxierr_errno("Can't open %s", data->filename);
     }
@@ -584,61 +939,270 @@ bxierr_p _get_file_fd(bxilog_file_handler_param_p data) {
     return BXIERR_OK;
 }
 
+bxierr_p _init_route(bxilog_file_handler_param_p route,
+                     bxilog_file_handler_param_p data) {
+    route->io_mode = data->io_mode;
+    route->msync = data->msync;
+    route->rotate_size = data->rotate_size;
+    route->rotate_interval = data->rotate_interval;
+    route->rotate_compress = data->rotate_compress;
+    route->compression = data->compression;
+    route->durability = data->durability;
+    route->sync_period_ms = data->sync_period_ms;
+    route->sync_level = data->sync_level;
+    route->route_filters = bxilog__filters_trie_new(route->generic.filters);
+
+    return _init(route);
+}
+
+bxierr_p _open_io(bxilog_file_handler_param_p data) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    errno = 0;
+    struct stat st;
+    size_t buf_size;
+    bool async = false;
+    int rc = fstat(data->fd, &st);
+    if (0 != rc) {
+        err2 = bxierr_errno("Calling fstat(%s) failed", data->filename);
+        BXIERR_CHAIN(err, err2);
+        buf_size = 4 * 1024 * DEFAULT_BLOCKS_NB;
+        data->file_size = 0;
+    } else {
+        buf_size = ((size_t) st.st_blksize) * DEFAULT_BLOCKS_NB;
+        // Writes to pipes and terminals are kept synchronous: they are cheap and
+        // their ordering with other outputs of the process is expected
+        async = S_ISREG(st.st_mode);
+        data->file_size = (size_t) st.st_size;
+    }
+
+    // Compressed batches are written as a whole: the text stream can't be mapped
+    const bool compress = !data->binary && 0 < data->compression;
+    if (BXILOG_FILE_HANDLER_IO_MMAP == data->io_mode && async && !compress) {
+        // The buffer size is the granularity of segments
+        err2 = bxilog__io_new_mmap(data->fd, buf_size, buf_size * MMAP_SEGMENT_BUFS,
+                                   data->msync, &data->io);
+    } else {
+        err2 = bxilog__io_new(data->fd, buf_size, async, &data->io);
+    }
+    bxiassert(NULL != data->io);
+    // The io fell back to a degraded mode but logs are still written
+    bxierr_p fallback = err2;
+    if (compress) bxilog__io_set_compression(data->io, data->compression);
+
+    // Blocks are self-contained: appending to an existing file only requires
+    // the file header to be there already
+    if (data->binary && (0 != rc || !S_ISREG(st.st_mode) || 0 == st.st_size)) {
+        bxilog_binfile_header_s header;
+        bxilog__binfile_header(&header);
+        char * buf;
+        err2 = bxilog__io_reserve(data->io, sizeof(header), &buf);
+        BXIERR_CHAIN(err, err2);
+        memcpy(buf, &header, sizeof(header));
+        bxilog__io_commit(data->io, sizeof(header));
+        data->file_size += sizeof(header);
+    }
+
+    data->synced_size = data->file_size;
+    data->sync_unconfirmed = false;
+    _tune_io(data);
+
+    if (bxierr_isko(fallback)) {
+        char * str = bxierr_str(fallback);
+        bxierr_destroy(&fallback);
+        err2 = _ilog(BXILOG_WARNING, data, "%s", str);
+        BXIERR_CHAIN(err, err2);
+        BXIFREE(str);
+    }
+
+    return err;
+}
+
+bxierr_p _close_io(bxilog_file_handler_param_p data) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    // Everything must be on disk before the close
+    err2 = _flush(data, true);
+    BXIERR_CHAIN(err, err2);
+    if (BXILOG_FILE_HANDLER_DURABILITY_NONE != data->durability ||
+        BXILOG_OFF != data->sync_level) {
+        err2 = _sync(data, true);
+        BXIERR_CHAIN(err, err2);
+    }
+    data->bytes_written += data->io->bytes_written;
+    data->bytes_lost += data->io->bytes_lost;
+    err2 = bxilog__io_destroy(&data->io);
+    BXIERR_CHAIN(err, err2);
+
+    if (0 < data->fd) {
+        errno = 0;
+        if (STDOUT_FILENO != data->fd && STDERR_FILENO != data->fd) {
+            int rc = close(data->fd);
+            if (-1 == rc) {
+                err2 = bxierr_errno("Closing logging file '%s' failed", data->filename);
+                BXIERR_CHAIN(err, err2);
+            }
+        }
+    }
+
+    return err;
+}
+
+inline void _check_rotation(bxilog_file_handler_param_p data, time_t now) {
+    if ((0 < data->rotate_size && data->file_size >= data->rotate_size) ||
+        (0 < data->rotate_interval && now >= data->rotate_next)) {
+        bxierr_p err = _rotate(data, now);
+        if (bxierr_isko(err)) _record_new_error(data, &err);
+    }
+}
+
+bxierr_p _rotate(bxilog_file_handler_param_p data, time_t now) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    if (0 < data->rotate_interval) {
+        data->rotate_next = (now / data->rotate_interval + 1) * data->rotate_interval;
+    }
+
+    err2 = _close_io(data);
+    BXIERR_CHAIN(err, err2);
+
+    // Only the handler thread writes to the file: nothing can be logged between
+    // the rename and the open
+    char * rotated = _rotated_name(data, now);
+    errno = 0;
+    int rc = rename(data->filename, rotated);
+    if (0 != rc) {
+        err2 = bxierr_errno("Calling rename(%s, %s) failed", data->filename, rotated);
+        BXIERR_CHAIN(err, err2);
+        BXIFREE(rotated);
+    }
+
+    err2 = _get_file_fd(data);
+    BXIERR_CHAIN(err, err2);
+    err2 = _open_io(data);
+    BXIERR_CHAIN(err, err2);
+
+    if (NULL != rotated && NULL != data->compressor) {
+        bxilog__compressor_submit(data->compressor, rotated);
+    } else {
+        BXIFREE(rotated);
+    }
+
+    return err;
+}
+
+char * _rotated_name(bxilog_file_handler_param_p data, time_t now) {
+    struct tm dummy;
+    struct tm * const tm = localtime_r(&now, &dummy);
+    bxiassert(NULL != tm);
+
+    char date[DATE_SIZE + 8];
+    size_t n = strftime(date, sizeof(date), "%Y%m%dT%H%M%S", tm);
+    bxiassert(0 < n);
+
+    // Several rotations may occur within the same second, previous ones may
+    // already be compressed
+    char * result = bxistr_new("%s.%s", data->filename, date);
+    char * gzname = bxistr_new("%s%s", result, BXILOG__COMPRESSOR_SUFFIX);
+    struct stat st;
+    for (size_t i = 1; 0 == stat(result, &st) || 0 == stat(gzname, &st); i++) {
+        BXIFREE(result);
+        BXIFREE(gzname);
+        result = bxistr_new("%s.%s.%zu", data->filename, date, i);
+        gzname = bxistr_new("%s%s", result, BXILOG__COMPRESSOR_SUFFIX);
+    }
+    BXIFREE(gzname);
+
+    return result;
+}
+
 void _tune_io(bxilog_file_handler_param_p data) {
     int rc;
     // We just tune, so we don't care on error
     rc = posix_fadvise(data->fd, 0, 0, POSIX_FADV_DONTNEED);
-    rc = posix_madvise(data->buf, data->buf_size, POSIX_MADV_SEQUENTIAL);
     UNUSED(rc);
 }
 
-inline bxierr_p _flush(bxilog_file_handler_param_p data) {
-    if (!data->dirty) return BXIERR_OK;
+inline bxierr_p _flush(bxilog_file_handler_param_p data, bool wait) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    if (NULL != data->writer) {
+        char * block;
+        size_t block_len;
+        bxilog__binfile_writer_close(data->writer, &block, &block_len);
+        if (NULL != block) {
+            err2 = _write_block(data, block, block_len);
+            BXIERR_CHAIN(err, err2);
+        }
+    }
+
+    err2 = _check_io(data, bxilog__io_flush(data->io, wait));
+    BXIERR_CHAIN(err, err2);
 
-    bxierr_p err = _write(data, data->buf, data->next_char);
-    data->next_char = 0;
-    data->dirty = false;
     return err;
 }
 
-bxierr_p _write(bxilog_file_handler_param_p data, const void * buf, size_t count) {
-    // Do not write more bytes than expected.
-    ssize_t written = write(data->fd, buf, count);
+bxierr_p _write_block(bxilog_file_handler_param_p data, char * block, size_t len) {
+    data->file_size += len;
 
-    if (0 >= written) {
-        if (EPIPE == errno) {
-            return bxierr_errno("Can't write to pipe (fd=%d, name=%s). "
-                    "Exiting. Some messages will be lost.",
-                    data->fd, data->filename);
-        }
+    // Small blocks (flushes) are copied, large ones are given as is
+    if (len > data->io->reserve_max / 2) {
+        return _check_io(data, bxilog__io_add(data->io, block, len));
+    }
 
-        bxierr_p bxierr = bxierr_errno("Calling write(fd=%d, name=%s) "
-                "failed (written=%d)",
-                data->fd, data->filename, written);
-        data->bytes_lost += count;
-        _record_new_error(data, &bxierr);
-    } else {
-        data->bytes_written += (size_t) written;
+    char * buf;
+    bxierr_p err = bxilog__io_reserve(data->io, len, &buf);
+    memcpy(buf, block, len);
+    bxilog__io_commit(data->io, len);
+    BXIFREE(block);
+
+    return _check_io(data, err);
+}
+
+bxierr_p _check_io(bxilog_file_handler_param_p data, bxierr_p err) {
+    if (bxierr_isok(err)) return err;
+
+    if (EPIPE == err->code) {
+        return bxierr_new(EPIPE, NULL, NULL, NULL, err,
+                          "Can't write to pipe (fd=%d, name=%s). "
+                          "Exiting. Some messages will be lost.",
+                          data->fd, data->filename);
     }
+
+    _record_new_error(data, &err);
     return BXIERR_OK;
 }
 
-bxierr_p _sync(bxilog_file_handler_param_p data) {
-    errno = 0;
+bxierr_p _sync(bxilog_file_handler_param_p data, bool wait) {
+    data->sync_deferred = false;
+    // A previous request may still be in progress
+    if (data->synced_size == data->file_size && !(wait && data->sync_unconfirmed)) {
+        return BXIERR_OK;
+    }
 
-    UNUSED(data);
-//    int rc = fdatasync(data->fd);
-//    if (rc != 0) {
-//        if (EROFS != errno && EINVAL != errno) {
-//            return bxierr_errno("Call to fdatasync() failed");
-//        }
-//        // OK otherwise, it just means the given FD does not support synchronization
-//        // this is the case for example with stdout, stderr...
-//    }
+    bxierr_p err = BXIERR_OK, err2;
+
+    data->synced_size = data->file_size;
+    data->sync_unconfirmed = !wait;
+    err2 = bxitime_get(CLOCK_MONOTONIC, &data->last_sync);
+    BXIERR_CHAIN(err, err2);
+    err2 = _check_io(data, bxilog__io_sync(data->io, wait));
+    BXIERR_CHAIN(err, err2);
 
-//    fprintf(stderr, "%d.%d: Sync: ok\n", data->pid, data->tid);
+    return err;
+}
 
-    return BXIERR_OK;
+bool _sync_required(bxilog_file_handler_param_p data) {
+    if (BXILOG_FILE_HANDLER_DURABILITY_FLUSH == data->durability) return true;
+    if (BXILOG_FILE_HANDLER_DURABILITY_PERIODIC != data->durability) return false;
+
+    double elapsed;
+    bxierr_p err = bxitime_duration(CLOCK_MONOTONIC, data->last_sync, &elapsed);
+    if (bxierr_isko(err)) {
+        _record_new_error(data, &err);
+        return true;
+    }
+    return elapsed * 1e3 >= (double) data->sync_period_ms;
 }
 
 
@@ -680,12 +1244,21 @@ bxierr_p _internal_log_func(bxilog_level_e level,
     record.logname_len = ARRAYLEN(INTERNAL_LOGGER_NAME);
     record.logmsg_len = msg_len;
 
-    err2 = _process_log(&record,
-                        (char *) filename,
-                        (char*) funcname,
-                        INTERNAL_LOGGER_NAME,
-                        msg,
-                        data);
+    if (data->binary) {
+        err2 = _process_log_binary(&record,
+                                   (char *) filename,
+                                   (char*) funcname,
+                                   INTERNAL_LOGGER_NAME,
+                                   msg,
+                                   data);
+    } else {
+        err2 = _process_log(&record,
+                            (char *) filename,
+                            (char*) funcname,
+                            INTERNAL_LOGGER_NAME,
+                            msg,
+                            data);
+    }
     BXIERR_CHAIN(err, err2);
 
     BXIFREE(msg);
@@ -24,10 +24,17 @@
 #include "bxi/base/log/level.h"
 #include "bxi/base/log/filter.h"
 
+#include "log_impl.h"
+#include "filter_impl.h"
+#include "registry_impl.h"
+
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
 
+#define TRIE_NODES_DEFAULT_SIZE 64
+#define TRIE_CACHE_DEFAULT_SIZE 64
+
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
@@ -35,6 +42,12 @@
 //*********************************************************************************
 //********************************** Static Functions  ****************************
 //*********************************************************************************
+static uint32_t _trie_child(bxilog__filters_trie_p self, uint32_t node, unsigned char c);
+static uint32_t _trie_add_child(bxilog__filters_trie_p self, uint32_t node, unsigned char c);
+static bxilog_level_e _trie_walk(bxilog__filters_trie_p self, const char * loggername);
+static size_t _cache_slot(bxilog__filters_trie_p self, bxilog_logger_p logger);
+static void _cache_clear(bxilog__filters_trie_p self);
+static void _cache_grow(bxilog__filters_trie_p self);
 //static int _filter_compar(const void * filter1, const void* filter2);
 //static void _merge_filter_visitor(const void *nodep, const VISIT which, const int depth);
 
@@ -142,6 +155,98 @@ bxilog_filters_p  bxilog_filters_dup(bxilog_filters_p filters) {
     return result;
 }
 
+bxilog_level_e bxilog__filters_level(bxilog_filters_p filters, const char * loggername) {
+    bxilog_level_e result = BXILOG_OFF;
+
+    for (size_t i = 0; i < filters->nb; i++) {
+        bxilog_filter_p filter = filters->list[i];
+        if (NULL == filter) break;
+
+        if (0 == strncmp(filter->prefix, loggername, strlen(filter->prefix))) {
+            result = filter->level;
+        }
+    }
+
+    return result;
+}
+
+bxilog__filters_trie_p bxilog__filters_trie_new(bxilog_filters_p filters) {
+    bxiassert(NULL != filters);
+
+    bxilog__filters_trie_p self = bximem_calloc(sizeof(*self));
+    self->nodes_size = TRIE_NODES_DEFAULT_SIZE;
+    self->nodes = bximem_calloc(self->nodes_size * sizeof(*self->nodes));
+    self->nodes_nb = 1;
+    self->nodes[0].rank = -1;
+
+    for (size_t i = 0; i < filters->nb; i++) {
+        bxilog_filter_p filter = filters->list[i];
+        if (NULL == filter) break;
+
+        uint32_t node = 0;
+        for (const unsigned char * c = (const unsigned char *) filter->prefix;
+             '\0' != *c; c++) {
+            uint32_t child = _trie_child(self, node, *c);
+            node = (0 == child) ? _trie_add_child(self, node, *c) : child;
+        }
+        // The last matching filter wins
+        self->nodes[node].rank = (int32_t) i;
+        self->nodes[node].level = filter->level;
+    }
+
+    self->cache_size = TRIE_CACHE_DEFAULT_SIZE;
+    self->cache = bximem_calloc(self->cache_size * sizeof(*self->cache));
+    self->generation = __atomic_load_n(&BXILOG__REGISTRY_GENERATION, __ATOMIC_ACQUIRE);
+
+    return self;
+}
+
+void bxilog__filters_trie_destroy(bxilog__filters_trie_p * self_p) {
+    bxiassert(NULL != self_p);
+
+    bxilog__filters_trie_p self = *self_p;
+    if (NULL == self) return;
+
+    BXIFREE(self->nodes);
+    BXIFREE(self->cache);
+    bximem_destroy((char **) self_p);
+}
+
+bxilog_level_e bxilog__filters_trie_level(bxilog__filters_trie_p self,
+                                          bxilog_logger_p logger,
+                                          const char * loggername,
+                                          size_t logname_len) {
+
+    if (NULL == logger) return _trie_walk(self, loggername);
+
+    const size_t generation = __atomic_load_n(&BXILOG__REGISTRY_GENERATION,
+                                              __ATOMIC_ACQUIRE);
+    if (generation != self->generation) {
+        _cache_clear(self);
+        self->generation = generation;
+    }
+
+    size_t slot = _cache_slot(self, logger);
+    bxilog__trie_cache_entry_s * entry = &self->cache[slot];
+    if (logger == entry->logger && logname_len == entry->logname_len) {
+        return entry->level;
+    }
+
+    bxilog_level_e level = _trie_walk(self, loggername);
+    if (NULL == entry->logger) {
+        if (2 * (self->cache_nb + 1) > self->cache_size) {
+            _cache_grow(self);
+            entry = &self->cache[_cache_slot(self, logger)];
+        }
+        self->cache_nb++;
+    }
+    entry->logger = logger;
+    entry->logname_len = logname_len;
+    entry->level = level;
+
+    return level;
+}
+
 bxierr_p bxilog_filters_parse(char * str, bxilog_filters_p * result) {
     bxiassert(NULL != str);
     bxiassert(NULL != result);
@@ -340,6 +445,79 @@ bxilog_filters_p bxilog_filters_merge(bxilog_filters_p * filters_array, size_t n
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
+
+uint32_t _trie_child(bxilog__filters_trie_p self, uint32_t node, unsigned char c) {
+    uint32_t child = self->nodes[node].child;
+    while (0 != child && c != self->nodes[child].c) child = self->nodes[child].sibling;
+
+    return child;
+}
+
+uint32_t _trie_add_child(bxilog__filters_trie_p self, uint32_t node, unsigned char c) {
+    if (self->nodes_nb == self->nodes_size) {
+        size_t old = self->nodes_size;
+        self->nodes_size *= 2;
+        self->nodes = bximem_realloc(self->nodes,
+                                     old * sizeof(*self->nodes),
+                                     self->nodes_size * sizeof(*self->nodes));
+    }
+    uint32_t child = (uint32_t) self->nodes_nb++;
+    self->nodes[child].c = c;
+    self->nodes[child].rank = -1;
+    self->nodes[child].child = 0;
+    self->nodes[child].sibling = self->nodes[node].child;
+    self->nodes[node].child = child;
+
+    return child;
+}
+
+bxilog_level_e _trie_walk(bxilog__filters_trie_p self, const char * loggername) {
+    // Each node on the path of the logger name is a matching prefix
+    const bxilog__trie_node_s * node = &self->nodes[0];
+    int32_t rank = node->rank;
+    bxilog_level_e level = node->level;
+
+    for (const unsigned char * c = (const unsigned char *) loggername; '\0' != *c; c++) {
+        uint32_t child = _trie_child(self, (uint32_t) (node - self->nodes), *c);
+        if (0 == child) break;
+        node = &self->nodes[child];
+        if (node->rank > rank) {
+            rank = node->rank;
+            level = node->level;
+        }
+    }
+
+    return (0 > rank) ? BXILOG_OFF : level;
+}
+
+size_t _cache_slot(bxilog__filters_trie_p self, bxilog_logger_p logger) {
+    // Fibonacci hashing of the logger address
+    size_t hash = (size_t) (((uintptr_t) logger >> 4) * 11400714819323198485ULL);
+    size_t slot = hash & (self->cache_size - 1);
+    while (NULL != self->cache[slot].logger && logger != self->cache[slot].logger) {
+        slot = (slot + 1) & (self->cache_size - 1);
+    }
+
+    return slot;
+}
+
+void _cache_clear(bxilog__filters_trie_p self) {
+    memset(self->cache, 0, self->cache_size * sizeof(*self->cache));
+    self->cache_nb = 0;
+}
+
+void _cache_grow(bxilog__filters_trie_p self) {
+    bxilog__trie_cache_entry_s * old = self->cache;
+    size_t old_size = self->cache_size;
+
+    self->cache_size *= 2;
+    self->cache = bximem_calloc(self->cache_size * sizeof(*self->cache));
+    for (size_t i = 0; i < old_size; i++) {
+        if (NULL == old[i].logger) continue;
+        self->cache[_cache_slot(self, old[i].logger)] = old[i];
+    }
+    BXIFREE(old);
+}
 //int _filter_compar(const void * filter1, const void * filter2) {
 //    bxiassert(NULL != filter1);
 //    bxiassert(NULL != filter2);
@@ -0,0 +1,103 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_FILTER_IMPL_H
+#define BXILOG_FILTER_IMPL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bxi/base/log/level.h"
+#include "bxi/base/log/filter.h"
+#include "bxi/base/log/logger.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * A node of the prefix trie: one per distinct prefix character.
+ * Node 0 is the root, for the empty prefix.
+ */
+typedef struct {
+    uint32_t child;                     // First child, 0 if none
+    uint32_t sibling;                   // Next sibling, 0 if none
+    int32_t rank;                       // Index of the last filter with this exact
+                                        // prefix, -1 if none
+    bxilog_level_e level;               // Its level
+    unsigned char c;                    // Last character of the prefix
+} bxilog__trie_node_s;
+
+/* The level of a logger, found once in the trie */
+typedef struct {
+    bxilog_logger_p logger;             // NULL when the entry is free
+    size_t logname_len;
+    bxilog_level_e level;
+} bxilog__trie_cache_entry_s;
+
+typedef struct bxilog__filters_trie_s bxilog__filters_trie_s;
+typedef bxilog__filters_trie_s * bxilog__filters_trie_p;
+
+/*
+ * A set of filters compiled into a prefix trie.
+ *
+ * Finding the level of a logger costs its name length, whatever the number of
+ * filters, and results are cached by logger. The cache is cleared when a logger is
+ * unregistered since another one may be allocated at the same address.
+ *
+ * A trie is used by a single thread.
+ */
+struct bxilog__filters_trie_s {
+    bxilog__trie_node_s * nodes;
+    size_t nodes_nb;
+    size_t nodes_size;
+    bxilog__trie_cache_entry_s * cache; // Open addressing, linear probing
+    size_t cache_size;                  // A power of 2
+    size_t cache_nb;
+    size_t generation;                  // Registry generation the cache relates to
+};
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Return the level of the given filters for the given logger name: the level of
+ * the last filter whose prefix matches, BXILOG_OFF if none does.
+ */
+bxilog_level_e bxilog__filters_level(bxilog_filters_p filters, const char * loggername);
+
+/* Compile the given filters, they are not referenced by the result */
+bxilog__filters_trie_p bxilog__filters_trie_new(bxilog_filters_p filters);
+
+/* Release the given trie */
+void bxilog__filters_trie_destroy(bxilog__filters_trie_p * self_p);
+
+/*
+ * Return the level of the compiled filters for the given logger: the same as
+ * bxilog__filters_level(). The logger is only used as a cache key, it can be NULL.
+ */
+bxilog_level_e bxilog__filters_trie_level(bxilog__filters_trie_p self,
+                                          bxilog_logger_p logger,
+                                          const char * loggername,
+                                          size_t logname_len);
+
+#endif
@@ -0,0 +1,376 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "fmt_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Longest conversion specification we accept, such as "%-#+08.12llx"
+#define SPEC_MAX_LEN 32
+
+// Initial room for the formatted message
+#define MSG_MIN_LEN 128
+
+// Stored instead of the length of a NULL string argument
+#define NULL_STR_LEN SIZE_MAX
+
+/*
+ * Append the conversion specification spec applied to value (and its optional
+ * '*' width/precision arguments) to the given output.
+ */
+#define APPEND(out, spec, stars, star_args, value) do {                         \
+    while (true) {                                                              \
+        char * const _dst = (out)->buf + (out)->len;                            \
+        const size_t _room = (out)->size - (out)->len;                          \
+        int _n;                                                                 \
+        switch (stars) {                                                        \
+            case 0: _n = snprintf(_dst, _room, spec, value); break;             \
+            case 1: _n = snprintf(_dst, _room, spec, star_args[0], value); break;\
+            default: _n = snprintf(_dst, _room, spec,                           \
+                                   star_args[0], star_args[1], value); break;   \
+        }                                                                       \
+        bxiassert(0 <= _n);                                                     \
+        if ((size_t) _n < _room) {                                              \
+            (out)->len += (size_t) _n;                                          \
+            break;                                                              \
+        }                                                                       \
+        _reserve((out), (size_t) _n + 1);                                       \
+    }                                                                           \
+} while (false)
+
+#define ENCODE_ARG(type, ap, buf, size, pos) do {                               \
+    type _value = va_arg(ap, type);                                             \
+    _put((buf), (size), (pos), &_value, sizeof(_value));                        \
+} while (false)
+
+#define DECODE_ARG(type, out, spec, stars, star_args, data, pos) do {           \
+    type _value;                                                                \
+    _get((data), (pos), &_value, sizeof(_value));                               \
+    APPEND((out), (spec), (stars), (star_args), _value);                        \
+} while (false)
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+// The C type of an argument as fetched by va_arg()
+typedef enum {
+    ARG_NONE,           // "%%": no argument
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_WINT,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_PTR,
+    ARG_STR,
+    ARG_UNSUPPORTED,
+} arg_kind_e;
+
+typedef struct {
+    size_t len;         // Number of chars of the specification (including '%')
+    arg_kind_e kind;
+    int stars;          // Number of '*' (width and/or precision)
+    bool star_prec;     // True if the precision is given by a '*'
+    int prec;           // Literal precision, -1 if none
+} spec_s;
+
+typedef struct {
+    char * buf;
+    size_t size;
+    size_t len;
+} out_s;
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void _parse_spec(const char * p, spec_s * spec);
+static arg_kind_e _int_kind(const char * length);
+static void _put(char * buf, size_t size, size_t * pos, const void * src, size_t len);
+static void _get(const char * data, size_t * pos, void * dst, size_t len);
+static void _reserve(out_s * out, size_t len);
+static void _append_str(out_s * out, const char * str, size_t len);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bool bxilog__fmt_encode(const char * const fmt, va_list ap,
+                        char * const buf, const size_t size, size_t * const needed) {
+    size_t pos = 0;
+    _put(buf, size, &pos, &fmt, sizeof(fmt));
+
+    const char * p = fmt;
+    while ('\0' != *p) {
+        if ('%' != *p) {
+            p++;
+            continue;
+        }
+        spec_s spec;
+        _parse_spec(p, &spec);
+        if (ARG_UNSUPPORTED == spec.kind) return false;
+        p += spec.len;
+
+        int prec = spec.prec;
+        for (int i = 0; i < spec.stars; i++) {
+            int star = va_arg(ap, int);
+            _put(buf, size, &pos, &star, sizeof(star));
+            if (spec.star_prec && i == spec.stars - 1) prec = star;
+        }
+        switch (spec.kind) {
+            case ARG_NONE: break;
+            case ARG_INT: ENCODE_ARG(int, ap, buf, size, &pos); break;
+            case ARG_LONG: ENCODE_ARG(long, ap, buf, size, &pos); break;
+            case ARG_LLONG: ENCODE_ARG(long long, ap, buf, size, &pos); break;
+            case ARG_INTMAX: ENCODE_ARG(intmax_t, ap, buf, size, &pos); break;
+            case ARG_SIZE: ENCODE_ARG(size_t, ap, buf, size, &pos); break;
+            case ARG_PTRDIFF: ENCODE_ARG(ptrdiff_t, ap, buf, size, &pos); break;
+            case ARG_WINT: ENCODE_ARG(wint_t, ap, buf, size, &pos); break;
+            case ARG_DOUBLE: ENCODE_ARG(double, ap, buf, size, &pos); break;
+            case ARG_LDOUBLE: ENCODE_ARG(long double, ap, buf, size, &pos); break;
+            case ARG_PTR: ENCODE_ARG(void *, ap, buf, size, &pos); break;
+            case ARG_STR: {
+                const char * str = va_arg(ap, const char *);
+                if (NULL == str) {
+                    const size_t len = NULL_STR_LEN;
+                    _put(buf, size, &pos, &len, sizeof(len));
+                    break;
+                }
+                // With a precision, the string is not required to be NUL terminated
+                const size_t len = (0 <= prec) ? strnlen(str, (size_t) prec) : strlen(str);
+                _put(buf, size, &pos, &len, sizeof(len));
+                _put(buf, size, &pos, str, len);
+                _put(buf, size, &pos, "", 1);
+                break;
+            }
+            default: bxiunreachable_statement;
+        }
+    }
+    *needed = pos;
+    return true;
+}
+
+size_t bxilog__fmt_decode(const char * const data, const size_t data_len,
+                          char ** const buf, size_t * const buf_size, const size_t offset) {
+    out_s out = { .buf = *buf, .size = *buf_size, .len = offset };
+    _reserve(&out, MSG_MIN_LEN);
+
+    size_t pos = 0;
+    const char * fmt;
+    _get(data, &pos, &fmt, sizeof(fmt));
+
+    const char * p = fmt;
+    while ('\0' != *p) {
+        const char * percent = p + strcspn(p, "%");
+        _append_str(&out, p, (size_t) (percent - p));
+        p = percent;
+        if ('\0' == *p) break;
+
+        spec_s spec;
+        _parse_spec(p, &spec);
+        // Already checked by bxilog__fmt_encode()
+        bxiassert(ARG_UNSUPPORTED != spec.kind);
+        char specstr[SPEC_MAX_LEN + 1];
+        memcpy(specstr, p, spec.len);
+        specstr[spec.len] = '\0';
+        p += spec.len;
+
+        int stars[2] = {0, 0};
+        for (int i = 0; i < spec.stars; i++) _get(data, &pos, &stars[i], sizeof(*stars));
+
+        switch (spec.kind) {
+            case ARG_NONE: _append_str(&out, "%", 1); break;
+            case ARG_INT: DECODE_ARG(int, &out, specstr, spec.stars, stars, data, &pos);
+                          break;
+            case ARG_LONG: DECODE_ARG(long, &out, specstr, spec.stars, stars, data, &pos);
+                           break;
+            case ARG_LLONG: DECODE_ARG(long long, &out, specstr,
+                                       spec.stars, stars, data, &pos);
+                            break;
+            case ARG_INTMAX: DECODE_ARG(intmax_t, &out, specstr,
+                                        spec.stars, stars, data, &pos);
+                             break;
+            case ARG_SIZE: DECODE_ARG(size_t, &out, specstr, spec.stars, stars, data, &pos);
+                           break;
+            case ARG_PTRDIFF: DECODE_ARG(ptrdiff_t, &out, specstr,
+                                         spec.stars, stars, data, &pos);
+                              break;
+            case ARG_WINT: DECODE_ARG(wint_t, &out, specstr, spec.stars, stars, data, &pos);
+                           break;
+            case ARG_DOUBLE: DECODE_ARG(double, &out, specstr,
+                                        spec.stars, stars, data, &pos);
+                             break;
+            case ARG_LDOUBLE: DECODE_ARG(long double, &out, specstr,
+                                         spec.stars, stars, data, &pos);
+                              break;
+            case ARG_PTR: DECODE_ARG(void *, &out, specstr, spec.stars, stars, data, &pos);
+                          break;
+            case ARG_STR: {
+                size_t len;
+                _get(data, &pos, &len, sizeof(len));
+                const char * str = NULL;
+                if (NULL_STR_LEN != len) {
+                    // The string is stored NUL terminated: use it in place
+                    str = data + pos;
+                    pos += len + 1;
+                }
+                APPEND(&out, specstr, spec.stars, stars, str);
+                break;
+            }
+            default: bxiunreachable_statement;
+        }
+    }
+    bxiassert(pos == data_len);
+
+    _reserve(&out, 1);
+    out.buf[out.len] = '\0';
+
+    *buf = out.buf;
+    *buf_size = out.size;
+    return out.len - offset + 1;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void _parse_spec(const char * const p, spec_s * const spec) {
+    bxiassert('%' == *p);
+    const char * s = p + 1;
+
+    spec->kind = ARG_UNSUPPORTED;
+    spec->stars = 0;
+    spec->star_prec = false;
+    spec->prec = -1;
+    spec->len = 0;
+
+    if ('%' == *s) {
+        spec->kind = ARG_NONE;
+        spec->len = 2;
+        return;
+    }
+    // Positional arguments ("%2$s") would require the whole list to be fetched
+    // in order: not supported.
+    const char * d = s;
+    while ('0' <= *d && '9' >= *d) d++;
+    if ('$' == *d) return;
+
+    // Flags
+    while ('\0' != *s && NULL != strchr("-+ #0'I", *s)) s++;
+    // Width
+    if ('*' == *s) {
+        spec->stars++;
+        s++;
+    } else {
+        while ('0' <= *s && '9' >= *s) s++;
+    }
+    // Precision
+    if ('.' == *s) {
+        s++;
+        if ('*' == *s) {
+            spec->stars++;
+            spec->star_prec = true;
+            s++;
+        } else {
+            spec->prec = 0;
+            while ('0' <= *s && '9' >= *s) spec->prec = spec->prec * 10 + (*s++ - '0');
+        }
+    }
+    // Length modifier
+    const char * length = s;
+    while ('\0' != *s && NULL != strchr("hlLqjzZt", *s)) s++;
+    const size_t length_len = (size_t) (s - length);
+    if (2 < length_len) return;
+
+    switch (*s) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            spec->kind = _int_kind(length);
+            break;
+        case 'c':
+            spec->kind = ('l' == *length) ? ARG_WINT : ARG_INT;
+            break;
+        case 'e': case 'E': case 'f': case 'F':
+        case 'g': case 'G': case 'a': case 'A':
+            spec->kind = ('L' == *length) ? ARG_LDOUBLE : ARG_DOUBLE;
+            break;
+        case 's':
+            // Wide strings are not supported
+            if (0 == length_len) spec->kind = ARG_STR;
+            break;
+        case 'p':
+            spec->kind = ARG_PTR;
+            break;
+        default:
+            // %n, %m (errno is not captured), %S, %C, and malformed specifications
+            return;
+    }
+    spec->len = (size_t) (s + 1 - p);
+    if (SPEC_MAX_LEN < spec->len) spec->kind = ARG_UNSUPPORTED;
+}
+
+arg_kind_e _int_kind(const char * const length) {
+    switch (length[0]) {
+        case 'h': return ARG_INT;
+        case 'l': return ('l' == length[1]) ? ARG_LLONG : ARG_LONG;
+        case 'L': case 'q': return ARG_LLONG;
+        case 'j': return ARG_INTMAX;
+        case 'z': case 'Z': return ARG_SIZE;
+        case 't': return ARG_PTRDIFF;
+        default: return ARG_INT;
+    }
+}
+
+void _put(char * const buf, const size_t size, size_t * const pos,
+          const void * const src, const size_t len) {
+    // Data are not aligned in the record: always use memcpy()
+    if (*pos + len <= size) memcpy(buf + *pos, src, len);
+    *pos += len;
+}
+
+void _get(const char * const data, size_t * const pos, void * const dst, const size_t len) {
+    memcpy(dst, data + *pos, len);
+    *pos += len;
+}
+
+void _reserve(out_s * const out, const size_t len) {
+    if (out->len + len <= out->size) return;
+    size_t new_size = 2 * out->size;
+    if (new_size < out->len + len) new_size = out->len + len;
+    out->buf = bximem_realloc(out->buf, out->size, new_size);
+    bxiassert(NULL != out->buf);
+    out->size = new_size;
+}
+
+void _append_str(out_s * const out, const char * const str, const size_t len) {
+    _reserve(out, len);
+    memcpy(out->buf + out->len, str, len);
+    out->len += len;
+}
@@ -0,0 +1,62 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_FMT_IMPL_H
+#define BXILOG_FMT_IMPL_H
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Encode the given format and its arguments in binary form into buf.
+ *
+ * The format pointer itself is stored, not its content: it must remain valid
+ * until the message is formatted by bxilog__fmt_decode() (string literals).
+ * Scalar arguments are stored raw, strings are copied.
+ *
+ * Return false if the format cannot be deferred (positional arguments, %n, %m,
+ * wide strings, ...): the caller must then format the message itself.
+ * Otherwise, *needed is the number of bytes required: if it is greater than size,
+ * buf content is undefined and the caller must try again with a larger buffer.
+ */
+bool bxilog__fmt_encode(const char * fmt, va_list ap,
+                        char * buf, size_t size, size_t * needed);
+
+/*
+ * Format the message encoded by bxilog__fmt_encode() in data.
+ *
+ * The message is written at offset in *buf, which is reallocated as needed
+ * (*buf_size is updated accordingly).
+ * Return the message length, including the NUL terminating byte.
+ */
+size_t bxilog__fmt_decode(const char * data, size_t data_len,
+                          char ** buf, size_t * buf_size, size_t offset);
+
+#endif
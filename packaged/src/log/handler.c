@@ -17,6 +17,8 @@
 #include <pthread.h>
 #include <sysexits.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sched.h>
 
 #include "bxi/base/err.h"
 #include "bxi/base/mem.h"
@@ -29,20 +31,46 @@
 
 #include "handler_impl.h"
 #include "log_impl.h"
+#include "record_impl.h"
+#include "fmt_impl.h"
+#include "filter_impl.h"
 
 
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
 
+// The logger name of the periodic overflow report
+#define OVERFLOW_LOGGER_NAME BXILOG_LIB_PREFIX "bxilog.overflow"
 
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
 
+// Storage of a log waiting in the batch
+typedef struct {
+    bxilog_record_p shared;                 // The shared record we hold a reference on
+    bxilog_record_s local_record;           // Used when the shared record cannot be
+                                            // given as is
+    char * fmt_buf;                         // Used to format deferred records
+    size_t fmt_buf_size;
+} batch_slot_s;
+
+typedef batch_slot_s * batch_slot_p;
+
 typedef struct {
     void * ctrl_zocket;
     void * data_zocket;
+    bxilog__ring_registry_p rings;          // NULL unless BXILOG_TRANSPORT_RING
+    bxilog__filters_trie_p filters;         // The handler filters, compiled
+    bxilog_filters_p filters_src;           // The filters compiled above
+    char * fmt_buf;                         // Used to format deferred records
+    size_t fmt_buf_size;
+    bxilog_batch_record_s * batch;          // Logs waiting for process_log_batch()
+    batch_slot_p slots;                     // Their storage
+    size_t batch_nb;
+    size_t dropped_reported;                // Overflow counters at the last report
+    size_t spilled_reported;
 
 #ifdef __linux__
     pid_t tid;                              // the thread pid
@@ -51,6 +79,14 @@ typedef struct {
 
 typedef handler_data_s * handler_data_p;
 
+typedef struct {
+    bxilog_handler_p handler;
+    bxilog_handler_param_p param;
+    handler_data_p data;
+} ring_drain_param_s;
+
+typedef ring_drain_param_s * ring_drain_param_p;
+
 //*********************************************************************************
 //********************************** Static Functions  ****************************
 //*********************************************************************************
@@ -58,6 +94,11 @@ static bxierr_p _mask_signals(bxilog_handler_p);
 static bxierr_p _create_zockets(bxilog_handler_p,
                                 bxilog_handler_param_p,
                                 handler_data_p);
+static bxierr_p _open_overflow_file(bxilog_handler_p,
+                                    bxilog_handler_param_p);
+static bxierr_p _report_overflow(bxilog_handler_p,
+                                 bxilog_handler_param_p,
+                                 handler_data_p);
 static bxierr_p _bind_ctrl_zocket(bxilog_handler_p,
                                   bxilog_handler_param_p,
                                   handler_data_p);
@@ -88,6 +129,29 @@ static bxierr_p _process_log_record(bxilog_handler_p,
 static bxierr_p _process_log_zmsg(bxilog_handler_p handler,
                                   bxilog_handler_param_p param,
                                   handler_data_p data, zmq_msg_t zmsg);
+static bxierr_p _process_log_data(bxilog_handler_p handler,
+                                  bxilog_handler_param_p param,
+                                  handler_data_p data,
+                                  bxilog_record_p record);
+static bxierr_p _process_batch(bxilog_handler_p handler,
+                               bxilog_handler_param_p param,
+                               handler_data_p data);
+static bool _resolve_record(handler_data_p data,
+                            bxilog_record_p record,
+                            bxilog_record_s * local_record,
+                            char ** fmt_buf, size_t * fmt_buf_size,
+                            bxilog_batch_record_s * result);
+static bxilog_record_p _format_deferred(char ** buf, size_t * buf_size,
+                                        bxilog_record_p record,
+                                        const char * filename,
+                                        const char * funcname,
+                                        const char * loggername,
+                                        const char * encoded);
+static bxierr_p _process_ring_records(bxilog_handler_p handler,
+                                      bxilog_handler_param_p param,
+                                      handler_data_p data,
+                                      size_t * processed);
+static bxierr_p _process_ring_record(void * item, ring_drain_param_p drain);
 static bxierr_p _process_ctrl_cmd(bxilog_handler_p,
                                   bxilog_handler_param_p,
                                   handler_data_p);
@@ -100,6 +164,9 @@ static bxierr_p _process_explicit_flush(bxilog_handler_p,
 static bxierr_p _process_exit(bxilog_handler_p,
                               bxilog_handler_param_p,
                               handler_data_p);
+static bxierr_p _process_filters(bxilog_handler_p,
+                                 bxilog_handler_param_p,
+                                 handler_data_p);
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
@@ -119,6 +186,11 @@ void bxilog_handler_init_param(bxilog_handler_p handler,
     param->flush_freq_ms = 1000;
     param->ierr_max = 10;
     param->filters = filters;
+    param->overflow_policy = BXILOG_OVERFLOW_BLOCK;
+    param->overflow_level = BXILOG_NOTICE;
+    param->overflow_file = NULL;
+    param->overflow_fd = -1;
+    param->overflow_writers_nb = 0;
 
     // Use the param pointer to guarantee a unique URL name for different instances of
     // the same handler
@@ -129,6 +201,7 @@ void bxilog_handler_init_param(bxilog_handler_p handler,
 void bxilog_handler_clean_param(bxilog_handler_param_p param) {
     BXIFREE(param->ctrl_url);
     BXIFREE(param->data_url);
+    BXIFREE(param->overflow_file);
     bxilog_filters_destroy(&param->filters);
     // Do not free param since it has not been allocated by init()
     // BXIFREE(param);
@@ -144,11 +217,18 @@ bxierr_p bxilog__handler_start(bxilog__handler_thread_bundle_p bundle) {
     bxierr_p ierr = BXIERR_OK;        // Internal errors
     handler_data_s data;
     memset(&data, 0, sizeof(data));
+    if (NULL != handler->process_log_batch) {
+        data.batch = bximem_calloc(BXILOG_HANDLER_BATCH_MAX * sizeof(*data.batch));
+        data.slots = bximem_calloc(BXILOG_HANDLER_BATCH_MAX * sizeof(*data.slots));
+    }
 
     // Constants for the IHT
 #ifdef __linux__
     data.tid = (pid_t) syscall(SYS_gettid);
 #endif
+    // Filters are matched for each record: compile them once
+    data.filters_src = param->filters;
+    data.filters = bxilog__filters_trie_new(data.filters_src);
 
     eerr2 = _init_handler(handler, param, &data);
     BXIERR_CHAIN(eerr, eerr2);
@@ -158,6 +238,10 @@ bxierr_p bxilog__handler_start(bxilog__handler_thread_bundle_p bundle) {
     eerr2 = _process_ierr(handler, param, ierr);
     BXIERR_CHAIN(eerr, eerr2);
 
+    ierr = _open_overflow_file(handler, param);
+    eerr2 = _process_ierr(handler, param, ierr);
+    BXIERR_CHAIN(eerr, eerr2);
+
     ierr = _mask_signals(handler);
     eerr2 = _process_ierr(handler, param, ierr);
     BXIERR_CHAIN(eerr, eerr2);
@@ -216,6 +300,27 @@ bxierr_p _mask_signals(bxilog_handler_p handler) {
     return err;
 }
 
+bxierr_p _open_overflow_file(bxilog_handler_p handler,
+                             bxilog_handler_param_p param) {
+
+    if (BXILOG_OVERFLOW_SPILL != param->overflow_policy) return BXIERR_OK;
+    if (NULL == param->overflow_file) {
+        return bxierr_gen("%s: no overflow file given for spilling logs", handler->name);
+    }
+
+    errno = 0;
+    const int fd = open(param->overflow_file,
+                        O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                        S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (-1 == fd) {
+        return bxierr_errno("%s: calling open('%s') failed",
+                            handler->name, param->overflow_file);
+    }
+    __atomic_store_n(&param->overflow_fd, fd, __ATOMIC_RELEASE);
+
+    return BXIERR_OK;
+}
+
 bxierr_p _create_zockets(bxilog_handler_p handler,
                          bxilog_handler_param_p param,
                          handler_data_p data) {
@@ -225,6 +330,12 @@ bxierr_p _create_zockets(bxilog_handler_p handler,
     err2 = _bind_ctrl_zocket(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
+    if (NULL != BXILOG__GLOBALS->rings) {
+        // Logs are received through the rings registry, no data zocket required
+        data->rings = BXILOG__GLOBALS->rings[param->rank];
+        return err;
+    }
+
     err2 = _bind_data_zocket(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
@@ -353,6 +464,11 @@ bxierr_p _loop(bxilog_handler_p handler,
     items[0].events = ZMQ_POLLIN;
     items[1].socket = data->data_zocket;
     items[1].events = ZMQ_POLLIN;
+    if (NULL != data->rings) {
+        // Producers wake us up through the eventfd when we are sleeping
+        items[1].socket = NULL;
+        items[1].fd = data->rings->wakeup_fd;
+    }
     for (size_t i = 0; i < param->private_items_nb; i++) {
         memcpy(items + 2 + i, param->private_items + i, sizeof(items[2+i]));
     }
@@ -364,8 +480,12 @@ bxierr_p _loop(bxilog_handler_p handler,
     if (bxierr_isko(err2)) bxierr_report(&err2, STDERR_FILENO);
 
     while (true) {
+        // With rings, records might be available without any notification
+        // (producers notify only a sleeping handler)
+        const bool pending = (NULL != data->rings) &&
+                             !bxilog__ring_registry_idle(data->rings);
         errno = 0;
-        int rc = zmq_poll(items, (int) items_nb, actual_timeout);
+        int rc = zmq_poll(items, (int) items_nb, pending ? 0 : actual_timeout);
 
         if (-1 == rc) {
             if (EINTR == errno) continue; // One interruption happened
@@ -392,7 +512,7 @@ bxierr_p _loop(bxilog_handler_p handler,
 //                "Duration: %ld, Actual Timeout:  %ld\n",
 //                duration_since_last_flush, actual_timeout);
 
-        if (0 == rc || 0 >= actual_timeout) {
+        if ((0 == rc && !pending) || 0 >= actual_timeout) {
             // 0 == rc: nothing to poll -> do a flush() and start again
             // 0 >= actual_timeout:
             // we might have received billions of logs that were filtered out
@@ -426,7 +546,7 @@ bxierr_p _loop(bxilog_handler_p handler,
             err = _process_ierr(handler, param, err);
             if (bxierr_isko(err)) goto QUIT;
         }
-        if (items[1].revents & ZMQ_POLLIN) {
+        if (pending || (items[1].revents & ZMQ_POLLIN)) {
             // Process data, this is the normal case
             err2 = _process_log_record(handler, param, data);
 
@@ -458,16 +578,40 @@ bxierr_p _cleanup(bxilog_handler_p handler,
                   bxilog_handler_param_p param,
                   handler_data_p data) {
     UNUSED(handler);
-    UNUSED(param);
 
     bxierr_p err = BXIERR_OK, err2;
 
+    // Logging threads check the descriptor before spilling: once they cannot see it
+    // anymore, wait for those still writing to it before closing it (see _spill())
+    const int fd = __atomic_exchange_n(&param->overflow_fd, -1, __ATOMIC_SEQ_CST);
+    while (0 != __atomic_load_n(&param->overflow_writers_nb, __ATOMIC_SEQ_CST)) {
+        sched_yield();
+    }
+    if (0 <= fd && 0 != close(fd)) {
+        err2 = bxierr_errno("%s: calling close(%d) on '%s' failed",
+                            handler->name, fd, param->overflow_file);
+        BXIERR_CHAIN(err, err2);
+    }
+
     err2 =  bxizmq_zocket_destroy(&data->data_zocket);
     BXIERR_CHAIN(err, err2);
 
     err2 = bxizmq_zocket_destroy(&data->ctrl_zocket);
     BXIERR_CHAIN(err, err2);
 
+    BXIFREE(data->fmt_buf);
+    data->fmt_buf_size = 0;
+
+    if (NULL != data->slots) {
+        bxiassert(0 == data->batch_nb);
+        for (size_t i = 0; i < BXILOG_HANDLER_BATCH_MAX; i++) {
+            BXIFREE(data->slots[i].fmt_buf);
+        }
+    }
+    BXIFREE(data->slots);
+    BXIFREE(data->batch);
+    bxilog__filters_trie_destroy(&data->filters);
+
     return err;
 }
 
@@ -477,6 +621,13 @@ bxierr_p _internal_flush(bxilog_handler_p handler,
 
 
     bxierr_p err = BXIERR_OK;
+    if (NULL != data->rings) {
+        size_t processed;
+        do {
+            err = _process_ring_records(handler, param, data, &processed);
+        } while (bxierr_isok(err) && 0 < processed);
+        return err;
+    }
     while(true) {
         err = _process_log_record(handler, param, data);
         if (bxierr_isko(err)) break;
@@ -492,26 +643,40 @@ bxierr_p _internal_flush(bxilog_handler_p handler,
 bxierr_p _process_log_record(bxilog_handler_p handler,
                              bxilog_handler_param_p param,
                              handler_data_p data) {
-    zmq_msg_t zmsg;
-    errno = 0;
-    int rc = zmq_msg_init(&zmsg);
-    bxiassert(0 == rc);
+    if (NULL != data->rings) {
+        bxilog__ring_registry_awake(data->rings);
+        size_t processed;
+        return _process_ring_records(handler, param, data, &processed);
+    }
 
     bxierr_p err = BXIERR_OK, err2;
 
-    err2 = bxizmq_msg_rcv(data->data_zocket, &zmsg, ZMQ_DONTWAIT);
-    BXIERR_CHAIN(err, err2);
+    // Drain up to a batch of pending records per wakeup
+    for (size_t received = 0; received < BXILOG_HANDLER_BATCH_MAX; received++) {
+        zmq_msg_t zmsg;
+        errno = 0;
+        int rc = zmq_msg_init(&zmsg);
+        bxiassert(0 == rc);
 
-    if (bxierr_isko(err)) {
+        err2 = bxizmq_msg_rcv(data->data_zocket, &zmsg, ZMQ_DONTWAIT);
+        if (bxierr_isko(err2)) {
+            // Nothing more to receive: only an error if nothing was received at all
+            if (0 < received && EAGAIN == err2->code) bxierr_destroy(&err2);
+            BXIERR_CHAIN(err, err2);
+            err2 = bxizmq_msg_close(&zmsg);
+            BXIERR_CHAIN(err, err2);
+            break;
+        }
+
+        err2 = _process_log_zmsg(handler, param, data, zmsg);
+        BXIERR_CHAIN(err, err2);
+        /* Release */
         err2 = bxizmq_msg_close(&zmsg);
         BXIERR_CHAIN(err, err2);
-        return err;
+        if (bxierr_isko(err)) break;
     }
 
-    err2 = _process_log_zmsg(handler, param, data, zmsg);
-    BXIERR_CHAIN(err, err2);
-    /* Release */
-    err2 = bxizmq_msg_close(&zmsg);
+    err2 = _process_batch(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
     return err;
@@ -529,39 +694,175 @@ bxierr_p _process_log_zmsg(bxilog_handler_p handler,
 
     bxilog_record_s * record = zmq_msg_data(&zmsg);
 
+    return _process_log_data(handler, param, data, record);
+}
+
+bxierr_p _process_ring_records(bxilog_handler_p handler,
+                               bxilog_handler_param_p param,
+                               handler_data_p data,
+                               size_t * processed) {
+    ring_drain_param_s drain = {
+                                .handler = handler,
+                                .param = param,
+                                .data = data,
+    };
+    bxierr_p err = BXIERR_OK, err2;
+    err2 = bxilog__ring_registry_drain(data->rings,
+                                       (bxierr_p (*)(void *, void *)) _process_ring_record,
+                                       &drain, processed);
+    BXIERR_CHAIN(err, err2);
+
+    err2 = _process_batch(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
+bxierr_p _process_ring_record(void * item, ring_drain_param_p drain) {
+    bxierr_p err = _process_log_data(drain->handler, drain->param, drain->data, item);
+    // The record is shared between handlers
+    bxilog__record_unref(item);
+
+    return err;
+}
+
+bxierr_p _process_log_data(bxilog_handler_p handler,
+                           bxilog_handler_param_p param,
+                           handler_data_p data,
+                           bxilog_record_p record) {
+
+    if (NULL == handler->process_log_batch) {
+        if (NULL == handler->process_log) return BXIERR_OK;
+
+        bxilog_record_s local_record;
+        bxilog_batch_record_s log;
+        if (!_resolve_record(data, record, &local_record,
+                             &data->fmt_buf, &data->fmt_buf_size, &log)) {
+            return BXIERR_OK;
+        }
+        return handler->process_log(log.record,
+                                    log.filename, log.funcname, log.loggername,
+                                    log.logmsg,
+                                    param);
+    }
+
+    batch_slot_p slot = &data->slots[data->batch_nb];
+    if (!_resolve_record(data, record, &slot->local_record,
+                         &slot->fmt_buf, &slot->fmt_buf_size,
+                         &data->batch[data->batch_nb])) {
+        return BXIERR_OK;
+    }
+    // Keep the shared record alive until the batch is processed
+    bxilog__record_ref(record);
+    slot->shared = record;
+    data->batch_nb++;
+
+    if (BXILOG_HANDLER_BATCH_MAX > data->batch_nb) return BXIERR_OK;
+
+    return _process_batch(handler, param, data);
+}
+
+bxierr_p _process_batch(bxilog_handler_p handler,
+                        bxilog_handler_param_p param,
+                        handler_data_p data) {
+
+    if (0 == data->batch_nb) return BXIERR_OK;
+
+    bxierr_p err = handler->process_log_batch(data->batch, data->batch_nb, param);
+    for (size_t i = 0; i < data->batch_nb; i++) {
+        bxilog__record_unref(data->slots[i].shared);
+        data->slots[i].shared = NULL;
+    }
+    data->batch_nb = 0;
+
+    return err;
+}
+
+bool _resolve_record(handler_data_p data,
+                     bxilog_record_p record,
+                     bxilog_record_s * local_record,
+                     char ** fmt_buf, size_t * fmt_buf_size,
+                     bxilog_batch_record_s * result) {
+
     // Fetch other strings: filename, funcname, loggername, logmsg
     char * filename = (char *) record + sizeof(*record);
     char * funcname = filename + record->filename_len;
     char * loggername = funcname + record->funcname_len;
     char * logmsg = loggername + record->logname_len;
 
-    bxilog_level_e filter_level = BXILOG_OFF;
-
-    for (size_t i = 0; i < param->filters->nb; i++) {
-        bxilog_filter_p filter = param->filters->list[i];
-        if (NULL == filter) break;
-
-        if (0 == strncmp(filter->prefix, loggername, strlen(filter->prefix))) {
-            filter_level = filter->level;
-//            fprintf(stderr, "%d.%d: %s MATCH [%zu] %s:%d\n",
-//                                    record->pid, record->tid, loggername,
-//                                    i, filter->prefix, filter->level);
-        } else {
-//            fprintf(stderr, "%d.%d: %s MISMATCH [%zu] %s:%d\n",
-//                                                record->pid, record->tid, loggername,
-//                                                i, filter->prefix, filter->level);
-        }
+    const bxilog__record_header_p header = bxilog__record_header(record);
+    const bxilog_level_e level = bxilog__filters_trie_level(data->filters,
+                                                            header->logger,
+                                                            loggername,
+                                                            record->logname_len);
+    if (record->level > level) return false;
+
+    // The shared record must not be modified: other handlers read it concurrently
+    if (NULL != header->site || (BXILOG__RECORD_TSC & header->flags)) {
+        *local_record = *record;
+        record = local_record;
     }
-    bxierr_p err = BXIERR_OK;
-    if ((record->level <= filter_level) && (NULL != handler->process_log)) {
-            err = handler->process_log(record,
-                                       filename, funcname, loggername, logmsg,
-                                       param);
-    } else {
-        UNUSED(data);
+    if (NULL != header->site) {
+        // The source location lives in the static call site descriptor
+        const bxilog_site_p site = bxilog__site_resolve(header->site);
+        local_record->filename_len = site->filename_len;
+        local_record->funcname_len = site->funcname_len;
+        filename = (char *) site->filename;
+        funcname = (char *) site->funcname;
+    }
+    if (BXILOG__RECORD_TSC & header->flags) {
+        bxitime_tsc_to_timespec(&BXILOG__GLOBALS->tsc_calib,
+                                header->ticks,
+                                &local_record->detail_time);
+    }
+    if (BXILOG__RECORD_DEFERRED & header->flags) {
+        record = _format_deferred(fmt_buf, fmt_buf_size,
+                                  record, filename, funcname, loggername, logmsg);
+        filename = (char *) record + sizeof(*record);
+        funcname = filename + record->filename_len;
+        loggername = funcname + record->funcname_len;
+        logmsg = loggername + record->logname_len;
     }
+    result->record = record;
+    result->filename = filename;
+    result->funcname = funcname;
+    result->loggername = loggername;
+    result->logmsg = logmsg;
 
-    return err;
+    return true;
+}
+
+bxilog_record_p _format_deferred(char ** buf, size_t * buf_size,
+                                 bxilog_record_p record,
+                                 const char * filename,
+                                 const char * funcname,
+                                 const char * loggername,
+                                 const char * encoded) {
+    // Build a contiguous formatted copy in the given private buffer. The shared
+    // record is left untouched since other handlers read it concurrently.
+    const size_t prefix_len = sizeof(*record) +
+                              record->filename_len +
+                              record->funcname_len +
+                              record->logname_len;
+    if (*buf_size < prefix_len) {
+        *buf = bximem_realloc(*buf, *buf_size, prefix_len);
+        *buf_size = prefix_len;
+    }
+    char * p = *buf;
+    memcpy(p, record, sizeof(*record));
+    p += sizeof(*record);
+    memcpy(p, filename, record->filename_len);
+    p += record->filename_len;
+    memcpy(p, funcname, record->funcname_len);
+    p += record->funcname_len;
+    memcpy(p, loggername, record->logname_len);
+
+    const size_t logmsg_len = bxilog__fmt_decode(encoded, record->logmsg_len,
+                                                 buf, buf_size, prefix_len);
+    bxilog_record_p result = (bxilog_record_p) *buf;
+    result->logmsg_len = logmsg_len;
+
+    return result;
 }
 
 bxierr_p _process_ctrl_cmd(bxilog_handler_p handler,
@@ -616,6 +917,15 @@ bxierr_p _process_ctrl_cmd(bxilog_handler_p handler,
         return bxierr_new(BXILOG_HANDLER_EXIT_CODE, err, NULL, NULL, NULL,
                           "Exit requested");
     }
+    if (0 == strncmp(FILTERS_CTRL_MSG_REQ, cmd, ARRAYLEN(FILTERS_CTRL_MSG_REQ))) {
+        BXIFREE(cmd);
+        err2 = _process_filters(handler, param, data);
+        BXIERR_CHAIN(err, err2);
+        // The previous filters can be released once the reply is received
+        err2 = bxizmq_str_snd(FILTERS_CTRL_MSG_REP, data->ctrl_zocket, 0, 0, 0);
+        BXIERR_CHAIN(err, err2);
+        return err;
+    }
     err2 = bxierr_gen("%s: unknown control command: %s", handler->name, cmd);
     BXIERR_CHAIN(err, err2);
     BXIFREE(cmd);
@@ -631,6 +941,9 @@ bxierr_p _process_implicit_flush(bxilog_handler_p handler,
     err2 = _internal_flush(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
+    err2 = _report_overflow(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
     err2 = (NULL == handler->process_implicit_flush) ? BXIERR_OK :
             handler->process_implicit_flush(param);
 
@@ -639,6 +952,70 @@ bxierr_p _process_implicit_flush(bxilog_handler_p handler,
     return err;
 }
 
+bxierr_p _report_overflow(bxilog_handler_p handler,
+                          bxilog_handler_param_p param,
+                          handler_data_p data) {
+
+    const size_t dropped = __atomic_load_n(&param->dropped_nb, __ATOMIC_RELAXED);
+    const size_t spilled = __atomic_load_n(&param->spilled_nb, __ATOMIC_RELAXED);
+    if (dropped == data->dropped_reported && spilled == data->spilled_reported) {
+        return BXIERR_OK;
+    }
+
+    char * msg = bxistr_new("%s: %zu logs dropped and %zu spilled since last report "
+                            "because of a full queue (%zu and %zu in total)",
+                            handler->name,
+                            dropped - data->dropped_reported,
+                            spilled - data->spilled_reported,
+                            dropped, spilled);
+    data->dropped_reported = dropped;
+    data->spilled_reported = spilled;
+
+    const char * filename;
+    const size_t filename_len = bxistr_rsub(__FILE__, ARRAYLEN(__FILE__) - 1,
+                                            '/', &filename) + 1;
+    const size_t funcname_len = ARRAYLEN(__func__);
+    const size_t logname_len = ARRAYLEN(OVERFLOW_LOGGER_NAME);
+    const size_t logmsg_len = strlen(msg) + 1;
+
+    // Given to the handler as any other log, filters included
+    bxilog_record_p record = bxilog__record_new(NULL,
+                                                sizeof(*record) +
+                                                filename_len + funcname_len +
+                                                logname_len + logmsg_len,
+                                                1);
+    record->level = BXILOG_WARNING;
+    bxierr_p err = bxitime_get(CLOCK_REALTIME, &record->detail_time), err2;
+    record->pid = BXILOG__GLOBALS->pid;
+#ifdef __linux__
+    record->tid = data->tid;
+#endif
+    record->thread_rank = (uint16_t) (uintptr_t) pthread_self();
+    record->line_nb = __LINE__;
+    record->filename_len = filename_len;
+    record->funcname_len = funcname_len;
+    record->logname_len = logname_len;
+    record->logmsg_len = logmsg_len;
+
+    char * p = (char *) record + sizeof(*record);
+    memcpy(p, filename, filename_len);
+    p += filename_len;
+    memcpy(p, __func__, funcname_len);
+    p += funcname_len;
+    memcpy(p, OVERFLOW_LOGGER_NAME, logname_len);
+    p += logname_len;
+    memcpy(p, msg, logmsg_len);
+    BXIFREE(msg);
+
+    err2 = _process_log_data(handler, param, data, record);
+    BXIERR_CHAIN(err, err2);
+    err2 = _process_batch(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+    bxilog__record_unref(record);
+
+    return err;
+}
+
 bxierr_p _process_explicit_flush(bxilog_handler_p handler,
                                  bxilog_handler_param_p param,
                                  handler_data_p data) {
@@ -648,6 +1025,9 @@ bxierr_p _process_explicit_flush(bxilog_handler_p handler,
     err2 = _internal_flush(handler, param, data);
     BXIERR_CHAIN(err, err2);
 
+    err2 = _report_overflow(handler, param, data);
+    BXIERR_CHAIN(err, err2);
+
     err2 = (NULL == handler->process_explicit_flush) ? BXIERR_OK :
             handler->process_explicit_flush(param);
 
@@ -668,6 +1048,24 @@ bxierr_p _process_exit(bxilog_handler_p handler,
             handler->process_exit(param);
 }
 
+bxierr_p _process_filters(bxilog_handler_p handler,
+                          bxilog_handler_param_p param,
+                          handler_data_p data) {
+
+    // Requests are sent to all handlers: only the one with new filters is concerned
+    bxilog_filters_p filters = __atomic_load_n(&param->filters, __ATOMIC_ACQUIRE);
+    if (filters == data->filters_src) return BXIERR_OK;
+
+    // Records not processed yet are matched against the new filters
+    bxilog__filters_trie_destroy(&data->filters);
+    data->filters_src = filters;
+    data->filters = bxilog__filters_trie_new(filters);
+
+    return (NULL == handler->process_cfg) ?
+            BXIERR_OK :
+            handler->process_cfg(param);
+}
+
 bxierr_p _process_ierr(bxilog_handler_p handler,
                        bxilog_handler_param_p param,
                        bxierr_p err) {
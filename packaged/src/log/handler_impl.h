@@ -26,6 +26,8 @@
 #define FLUSH_CTRL_MSG_REP "H->BC: flushed!"
 #define EXIT_CTRL_MSG_REQ "BC->H: exit?"
 #define EXIT_CTRL_MSG_REP "H->BC: exited!"
+#define FILTERS_CTRL_MSG_REQ "BC->H: filters?"
+#define FILTERS_CTRL_MSG_REP "H->BC: filters!"
 
 
 //*********************************************************************************
@@ -0,0 +1,666 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "io_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void _close_segment(bxilog__io_batch_p batch);
+static void _writev(int fd, struct iovec * iov, int iov_nb, bxilog__io_batch_p batch);
+static void _write_batch(bxilog__io_p io, bxilog__io_batch_p batch);
+static bxierr_p _submit(bxilog__io_p io);
+static bxierr_p _wait(bxilog__io_p io);
+static bxierr_p _collect(bxilog__io_p io, bxilog__io_batch_p batch);
+static void * _helper_thread(bxilog__io_p io);
+static int _fdatasync(bxilog__io_p io);
+static bxierr_p _sync_err(bxilog__io_p io, int error);
+static bxierr_p _map(bxilog__io_p io, off_t start);
+static bxierr_p _unmap(bxilog__io_p io, bool truncate);
+static bxierr_p _remap(bxilog__io_p io);
+static bxierr_p _msync(bxilog__io_p io, bool wait);
+static bxierr_p _fallback(bxilog__io_p io, bxierr_p cause, bool truncate);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxierr_p bxilog__io_new(int fd, size_t buf_size, bool async, bxilog__io_p * result) {
+    bxiassert(NULL != result);
+
+    bxilog__io_p io = bximem_calloc(sizeof(*io));
+    io->fd = fd;
+    io->buf_size = buf_size;
+    io->reserve_max = buf_size;
+
+    const size_t align = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t batches_nb = async ? 2 : 1;
+    for (size_t i = 0; i < batches_nb; i++) {
+        errno = 0;
+        int rc = posix_memalign((void**) &io->batches[i].buf, align, buf_size);
+        if (0 != rc) {
+            bxierr_p err = bxierr_fromidx(rc, NULL,
+                                          "Calling posix_memalign(%zu, %zu) failed",
+                                          align, buf_size);
+            for (size_t j = 0; j < i; j++) BXIFREE(io->batches[j].buf);
+            BXIFREE(io);
+            *result = NULL;
+            return err;
+        }
+        // We just tune, so we don't care on error
+        rc = posix_madvise(io->batches[i].buf, buf_size, POSIX_MADV_SEQUENTIAL);
+        UNUSED(rc);
+    }
+    io->current = &io->batches[0];
+
+    if (async) {
+        int rc = pthread_mutex_init(&io->mutex, NULL);
+        bxiassert(0 == rc);
+        rc = pthread_cond_init(&io->cond, NULL);
+        bxiassert(0 == rc);
+        // Signals are blocked in the handler thread: the helper inherits the mask
+        rc = pthread_create(&io->thread, NULL,
+                            (void * (*) (void *)) _helper_thread, io);
+        if (0 != rc) {
+            // Not fatal: fall back to synchronous writes
+            pthread_cond_destroy(&io->cond);
+            pthread_mutex_destroy(&io->mutex);
+            BXIFREE(io->batches[1].buf);
+            *result = io;
+            return bxierr_fromidx(rc, NULL,
+                                  "Calling pthread_create() failed, "
+                                  "falling back to synchronous writes");
+        }
+        io->async = true;
+    }
+
+    *result = io;
+    return BXIERR_OK;
+}
+
+bxierr_p bxilog__io_new_mmap(int fd, size_t buf_size, size_t seg_size,
+                             bxilog_file_handler_msync_e msync,
+                             bxilog__io_p * result) {
+    bxiassert(NULL != result);
+    bxiassert(0 == seg_size % buf_size);
+
+    bxilog__io_p io = bximem_calloc(sizeof(*io));
+    io->fd = fd;
+    io->buf_size = buf_size;
+    io->reserve_max = seg_size;
+    io->mmap = true;
+    io->msync = msync;
+    io->seg_size = seg_size;
+    io->current = &io->batches[0];
+
+    errno = 0;
+    struct stat st;
+    int rc = fstat(fd, &st);
+    if (0 != rc) {
+        *result = io;
+        return _fallback(io, bxierr_errno("Calling fstat(%d) failed", fd), false);
+    }
+
+    // Mappings must start on a page boundary: the last partial page is mapped again
+    const off_t page_size = (off_t) sysconf(_SC_PAGESIZE);
+    const off_t start = st.st_size - st.st_size % page_size;
+    io->current->used = (size_t) (st.st_size - start);
+    io->synced = io->current->used;
+
+    bxierr_p err = _map(io, start);
+    *result = io;
+    if (bxierr_isko(err)) return _fallback(io, err, true);
+
+    return BXIERR_OK;
+}
+
+void bxilog__io_set_compression(bxilog__io_p io, int level) {
+    bxiassert(!io->mmap);
+    bxiassert(0 == io->current->used && NULL == io->submitted);
+
+    // Each batch becomes a gzip member
+    io->zblock = bxilog__zblock_new(level, true);
+}
+
+bxierr_p bxilog__io_destroy(bxilog__io_p * io_p) {
+    bxilog__io_p io = *io_p;
+    if (NULL == io) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    err2 = bxilog__io_flush(io, true);
+    BXIERR_CHAIN(err, err2);
+
+    if (io->mmap) {
+        err2 = _unmap(io, true);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    if (io->async) {
+        int rc = pthread_mutex_lock(&io->mutex);
+        bxiassert(0 == rc);
+        io->exit = true;
+        rc = pthread_cond_broadcast(&io->cond);
+        bxiassert(0 == rc);
+        rc = pthread_mutex_unlock(&io->mutex);
+        bxiassert(0 == rc);
+
+        rc = pthread_join(io->thread, NULL);
+        if (0 != rc) {
+            err2 = bxierr_fromidx(rc, NULL, "Calling pthread_join() failed");
+            BXIERR_CHAIN(err, err2);
+        }
+        pthread_cond_destroy(&io->cond);
+        pthread_mutex_destroy(&io->mutex);
+    }
+
+    if (!io->mmap) {
+        for (size_t i = 0; i < ARRAYLEN(io->batches); i++) {
+            BXIFREE(io->batches[i].buf);
+        }
+    }
+    bxilog__zblock_destroy(&io->zblock);
+    bximem_destroy((char**) io_p);
+
+    return err;
+}
+
+bxierr_p bxilog__io_reserve(bxilog__io_p io, size_t size, char ** result) {
+    bxiassert(size <= io->reserve_max);
+
+    bxierr_p err = BXIERR_OK;
+    if (io->mmap) {
+        if (io->seg_size - io->current->used < size) err = _remap(io);
+        // On failure, the engine falls back to a buffer of reserve_max bytes
+        if (io->mmap) {
+            *result = io->current->buf + io->current->used;
+            return err;
+        }
+    }
+    if (io->buf_size - io->current->used < size) {
+        bxierr_p err2 = _submit(io);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    *result = io->current->buf + io->current->used;
+    return err;
+}
+
+void bxilog__io_commit(bxilog__io_p io, size_t size) {
+    bxilog__io_batch_p batch = io->current;
+    batch->used += size;
+    if (io->mmap) {
+        // Nothing to submit: the mapping is the file
+        io->bytes_written += size;
+        bxiassert(batch->used <= io->seg_size);
+        return;
+    }
+    batch->bytes += size;
+    bxiassert(batch->used <= io->buf_size);
+}
+
+bxierr_p bxilog__io_add(bxilog__io_p io, char * line, size_t size) {
+    bxierr_p err = BXIERR_OK, err2;
+    size_t done = 0;
+    while (io->mmap && done < size) {
+        if (io->seg_size == io->current->used) {
+            err2 = _remap(io);
+            BXIERR_CHAIN(err, err2);
+            if (!io->mmap) break;
+        }
+        const size_t room = io->seg_size - io->current->used;
+        const size_t n = (size - done < room) ? size - done : room;
+        memcpy(io->current->buf + io->current->used, line + done, n);
+        bxilog__io_commit(io, n);
+        done += n;
+    }
+    if (io->mmap) {
+        BXIFREE(line);
+        return err;
+    }
+    if (0 < done) {
+        // Fallen back in the middle of the line: write the remaining bytes
+        size -= done;
+        memmove(line, line + done, size);
+    }
+
+    bxilog__io_batch_p batch = io->current;
+
+    // Room for the pending buffer segment, the line and the next buffer segment
+    bxiassert(batch->iov_nb + 2 < BXILOG__IO_IOV_NB);
+
+    _close_segment(batch);
+    batch->iov[batch->iov_nb].iov_base = line;
+    batch->iov[batch->iov_nb].iov_len = size;
+    batch->owned[batch->iov_nb] = line;
+    batch->iov_nb++;
+    batch->bytes += size;
+
+    if (batch->iov_nb + 2 >= BXILOG__IO_IOV_NB ||
+        batch->bytes > BXILOG__IO_BATCH_BUFS_MAX * io->buf_size) {
+        err2 = _submit(io);
+        BXIERR_CHAIN(err, err2);
+    }
+    return err;
+}
+
+bxierr_p bxilog__io_flush(bxilog__io_p io, bool wait) {
+    if (io->mmap) return _msync(io, wait);
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    err2 = _submit(io);
+    BXIERR_CHAIN(err, err2);
+
+    if (wait) {
+        err2 = _wait(io);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    return err;
+}
+
+bxierr_p bxilog__io_sync(bxilog__io_p io, bool wait) {
+    // In mmap mode, fdatasync() also writes dirty pages of the mappings
+    if (!io->async) return _sync_err(io, _fdatasync(io));
+
+    int rc = pthread_mutex_lock(&io->mutex);
+    bxiassert(0 == rc);
+    const uint64_t ticket = ++io->sync_requested;
+    rc = pthread_cond_broadcast(&io->cond);
+    bxiassert(0 == rc);
+    while (wait && io->sync_done < ticket) {
+        rc = pthread_cond_wait(&io->cond, &io->mutex);
+        bxiassert(0 == rc);
+    }
+    const int error = io->sync_error;
+    io->sync_error = 0;
+    rc = pthread_mutex_unlock(&io->mutex);
+    bxiassert(0 == rc);
+
+    return _sync_err(io, error);
+}
+
+bool bxilog__io_sync_busy(bxilog__io_p io) {
+    if (!io->async) return false;
+
+    int rc = pthread_mutex_lock(&io->mutex);
+    bxiassert(0 == rc);
+    const bool result = io->sync_done != io->sync_requested;
+    rc = pthread_mutex_unlock(&io->mutex);
+    bxiassert(0 == rc);
+
+    return result;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void _close_segment(bxilog__io_batch_p batch) {
+    if (batch->used == batch->seg_start) return;
+
+    batch->iov[batch->iov_nb].iov_base = batch->buf + batch->seg_start;
+    batch->iov[batch->iov_nb].iov_len = batch->used - batch->seg_start;
+    batch->owned[batch->iov_nb] = NULL;
+    batch->iov_nb++;
+    batch->seg_start = batch->used;
+}
+
+void _writev(int fd, struct iovec * iov, int iov_nb, bxilog__io_batch_p batch) {
+    while (0 < iov_nb) {
+        errno = 0;
+        ssize_t n = writev(fd, iov, iov_nb);
+        if (0 > n) {
+            if (EINTR == errno) continue;
+            batch->error = errno;
+            return;
+        }
+        if (0 == n) {
+            // Nothing written while something was expected: do not loop forever
+            batch->error = EIO;
+            return;
+        }
+        batch->written += (size_t) n;
+        // Partial write: skip what has been written and try again with the remaining
+        while (0 < iov_nb && (size_t) n >= iov->iov_len) {
+            n -= (ssize_t) iov->iov_len;
+            iov++;
+            iov_nb--;
+        }
+        if (0 < iov_nb) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= (size_t) n;
+        }
+    }
+}
+
+void _write_batch(bxilog__io_p io, bxilog__io_batch_p batch) {
+    if (NULL == io->zblock) {
+        _writev(io->fd, batch->iov, batch->iov_nb, batch);
+        return;
+    }
+
+    const char * out;
+    size_t out_len;
+    bxierr_p err = bxilog__zblock_deflate(io->zblock, batch->iov, batch->iov_nb,
+                                          &out, &out_len);
+    if (bxierr_isko(err)) {
+        // Can't happen but with a zlib bug: the batch is lost
+        bxierr_destroy(&err);
+        batch->error = EIO;
+        return;
+    }
+    struct iovec iov = {.iov_base = (void *) out, .iov_len = out_len};
+    _writev(io->fd, &iov, 1, batch);
+    // Counters are about logs, not about their compressed form
+    batch->written = (0 == batch->error) ? batch->bytes : 0;
+}
+
+bxierr_p _submit(bxilog__io_p io) {
+    bxilog__io_batch_p batch = io->current;
+
+    _close_segment(batch);
+    if (0 == batch->iov_nb) return BXIERR_OK;
+
+    if (!io->async) {
+        _write_batch(io, batch);
+        return _collect(io, batch);
+    }
+
+    // Only one batch in flight: the other one is needed for formatting anyway
+    bxierr_p err = _wait(io);
+
+    int rc = pthread_mutex_lock(&io->mutex);
+    bxiassert(0 == rc);
+    io->inflight = batch;
+    rc = pthread_cond_broadcast(&io->cond);
+    bxiassert(0 == rc);
+    rc = pthread_mutex_unlock(&io->mutex);
+    bxiassert(0 == rc);
+
+    io->submitted = batch;
+    io->current = (batch == &io->batches[0]) ? &io->batches[1] : &io->batches[0];
+
+    return err;
+}
+
+bxierr_p _wait(bxilog__io_p io) {
+    bxilog__io_batch_p batch = io->submitted;
+    if (NULL == batch) return BXIERR_OK;
+
+    int rc = pthread_mutex_lock(&io->mutex);
+    bxiassert(0 == rc);
+    while (NULL != io->inflight) {
+        rc = pthread_cond_wait(&io->cond, &io->mutex);
+        bxiassert(0 == rc);
+    }
+    rc = pthread_mutex_unlock(&io->mutex);
+    bxiassert(0 == rc);
+
+    io->submitted = NULL;
+    return _collect(io, batch);
+}
+
+bxierr_p _collect(bxilog__io_p io, bxilog__io_batch_p batch) {
+    bxierr_p err = BXIERR_OK;
+
+    io->bytes_written += batch->written;
+    if (0 != batch->error) {
+        const size_t lost = batch->bytes - batch->written;
+        io->bytes_lost += lost;
+        err = bxierr_fromidx(batch->error, NULL,
+                             "Calling writev(fd=%d) failed (%zu bytes lost)",
+                             io->fd, lost);
+    }
+
+    for (int i = 0; i < batch->iov_nb; i++) BXIFREE(batch->owned[i]);
+    batch->used = 0;
+    batch->seg_start = 0;
+    batch->bytes = 0;
+    batch->iov_nb = 0;
+    batch->written = 0;
+    batch->error = 0;
+
+    return err;
+}
+
+void * _helper_thread(bxilog__io_p io) {
+    int rc = pthread_mutex_lock(&io->mutex);
+    bxiassert(0 == rc);
+    while (true) {
+        while (NULL == io->inflight &&
+               io->sync_done == io->sync_requested &&
+               !io->exit) {
+            rc = pthread_cond_wait(&io->cond, &io->mutex);
+            bxiassert(0 == rc);
+        }
+        // Sync requests cover what has been submitted before them
+        if (NULL != io->inflight) {
+            bxilog__io_batch_p batch = io->inflight;
+            rc = pthread_mutex_unlock(&io->mutex);
+            bxiassert(0 == rc);
+
+            _write_batch(io, batch);
+
+            rc = pthread_mutex_lock(&io->mutex);
+            bxiassert(0 == rc);
+            io->inflight = NULL;
+            rc = pthread_cond_broadcast(&io->cond);
+            bxiassert(0 == rc);
+            continue;
+        }
+        if (io->sync_done == io->sync_requested) break;
+
+        // All requests made so far are served by this single call
+        const uint64_t requested = io->sync_requested;
+        rc = pthread_mutex_unlock(&io->mutex);
+        bxiassert(0 == rc);
+
+        const int error = _fdatasync(io);
+
+        rc = pthread_mutex_lock(&io->mutex);
+        bxiassert(0 == rc);
+        io->sync_done = requested;
+        if (0 != error) io->sync_error = error;
+        rc = pthread_cond_broadcast(&io->cond);
+        bxiassert(0 == rc);
+    }
+    rc = pthread_mutex_unlock(&io->mutex);
+    bxiassert(0 == rc);
+
+    return NULL;
+}
+
+int _fdatasync(bxilog__io_p io) {
+    if (io->sync_unsupported) return 0;
+
+    while (true) {
+        errno = 0;
+        int rc = fdatasync(io->fd);
+        if (0 == rc) return 0;
+        if (EINTR == errno) continue;
+        if (EROFS == errno || EINVAL == errno) {
+            // The fd does not support synchronization (a pipe, a terminal...)
+            io->sync_unsupported = true;
+            return 0;
+        }
+        return errno;
+    }
+}
+
+bxierr_p _sync_err(bxilog__io_p io, int error) {
+    if (0 == error) return BXIERR_OK;
+
+    return bxierr_fromidx(error, NULL, "Calling fdatasync(fd=%d) failed", io->fd);
+}
+
+bxierr_p _map(bxilog__io_p io, off_t start) {
+    // Set first: on error, the fallback truncates and writes from there
+    io->map_start = start;
+
+    // Allocate the blocks now: a full file system gives an error here instead of
+    // a SIGBUS when the mapping is written
+    int rc = posix_fallocate(io->fd, start, (off_t) io->seg_size);
+    if (0 != rc) {
+        return bxierr_fromidx(rc, NULL,
+                              "Calling posix_fallocate(fd=%d, %jd, %zu) failed",
+                              io->fd, (intmax_t) start, io->seg_size);
+    }
+
+    errno = 0;
+    void * addr = mmap(NULL, io->seg_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                       io->fd, start);
+    if (MAP_FAILED == addr) {
+        return bxierr_errno("Calling mmap(fd=%d, %jd, %zu) failed",
+                            io->fd, (intmax_t) start, io->seg_size);
+    }
+    // We just tune, so we don't care on error
+    rc = posix_madvise(addr, io->seg_size, POSIX_MADV_SEQUENTIAL);
+    UNUSED(rc);
+
+    io->batches[0].buf = addr;
+
+    return BXIERR_OK;
+}
+
+bxierr_p _unmap(bxilog__io_p io, bool truncate) {
+    bxierr_p err = BXIERR_OK, err2;
+    bxilog__io_batch_p batch = io->current;
+
+    if (NULL != batch->buf) {
+        err2 = _msync(io, true);
+        BXIERR_CHAIN(err, err2);
+
+        errno = 0;
+        int rc = munmap(batch->buf, io->seg_size);
+        if (0 != rc) {
+            err2 = bxierr_errno("Calling munmap(%p, %zu) failed",
+                                batch->buf, io->seg_size);
+            BXIERR_CHAIN(err, err2);
+        }
+        batch->buf = NULL;
+    }
+
+    if (truncate) {
+        // Remove the preallocated tail
+        const off_t end = io->map_start + (off_t) batch->used;
+        errno = 0;
+        int rc = ftruncate(io->fd, end);
+        if (0 != rc) {
+            err2 = bxierr_errno("Calling ftruncate(fd=%d, %jd) failed",
+                                io->fd, (intmax_t) end);
+            BXIERR_CHAIN(err, err2);
+        }
+    }
+
+    return err;
+}
+
+bxierr_p _remap(bxilog__io_p io) {
+    bxilog__io_batch_p batch = io->current;
+    const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+
+    // The next mapping starts with the last partial page of the current one
+    const size_t kept = batch->used & (page_size - 1);
+    const off_t start = io->map_start + (off_t) (batch->used - kept);
+
+    bxierr_p err = _unmap(io, false);
+    io->map_start = start;
+    batch->used = kept;
+    io->synced = kept;
+
+    bxierr_p err2 = _map(io, start);
+    if (bxierr_isko(err2)) {
+        err2 = _fallback(io, err2, true);
+    }
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
+bxierr_p _msync(bxilog__io_p io, bool wait) {
+    bxilog__io_batch_p batch = io->current;
+
+    if (BXILOG_FILE_HANDLER_MSYNC_NONE == io->msync) return BXIERR_OK;
+    if (NULL == batch->buf || batch->used <= io->synced) return BXIERR_OK;
+
+    const bool sync = wait && BXILOG_FILE_HANDLER_MSYNC_SYNC == io->msync;
+    const size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    const size_t start = io->synced & ~(page_size - 1);
+
+    errno = 0;
+    int rc = msync(batch->buf + start, batch->used - start, sync ? MS_SYNC : MS_ASYNC);
+    if (0 != rc) {
+        return bxierr_errno("Calling msync(%p, %zu) failed",
+                            batch->buf + start, batch->used - start);
+    }
+    // With the synchronous policy, only MS_SYNC makes data durable
+    if (sync || BXILOG_FILE_HANDLER_MSYNC_ASYNC == io->msync) io->synced = batch->used;
+
+    return BXIERR_OK;
+}
+
+bxierr_p _fallback(bxilog__io_p io, bxierr_p cause, bool truncate) {
+    bxilog__io_batch_p batch = io->current;
+    bxierr_p err = bxierr_new(BXIERR_GENERIC_CODE, NULL, NULL, NULL, cause,
+                              "Mapping fd=%d failed, falling back to write mode",
+                              io->fd);
+
+    // Discard the preallocated tail and write from the end of what is there
+    if (truncate) {
+        bxierr_p err2 = _unmap(io, true);
+        BXIERR_CHAIN(err, err2);
+        const off_t end = io->map_start + (off_t) batch->used;
+        errno = 0;
+        off_t rc = lseek(io->fd, end, SEEK_SET);
+        if (0 > rc) {
+            err2 = bxierr_errno("Calling lseek(fd=%d, %jd) failed",
+                                io->fd, (intmax_t) end);
+            BXIERR_CHAIN(err, err2);
+        }
+    }
+
+    // Callers may already rely on reserve_max
+    io->mmap = false;
+    io->buf_size = io->reserve_max;
+    batch->buf = bximem_calloc(io->buf_size);
+    batch->used = 0;
+    batch->seg_start = 0;
+
+    return err;
+}
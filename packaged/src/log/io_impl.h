@@ -0,0 +1,203 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_IO_IMPL_H
+#define BXILOG_IO_IMPL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/log/file_handler.h"
+
+#include "zblock_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Maximum number of iovec entries of a single batch (well below IOV_MAX)
+#define BXILOG__IO_IOV_NB 64
+
+// A batch is submitted when it holds more than this number of buffer sizes
+// (because of large lines given with bxilog__io_add())
+#define BXILOG__IO_BATCH_BUFS_MAX 8
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef struct bxilog__io_batch_s bxilog__io_batch_s;
+typedef bxilog__io_batch_s * bxilog__io_batch_p;
+
+/*
+ * What is given to a single writev() call (more if it is partial).
+ *
+ * The iovec list refers to consecutive segments of the page aligned buffer
+ * interleaved with large lines that do not fit in it (owned by the batch).
+ */
+struct bxilog__io_batch_s {
+    char * buf;                         // Page aligned, io->buf_size bytes
+    size_t used;                        // Bytes used in buf
+    size_t seg_start;                   // Start of the buf segment not yet in iov
+    size_t bytes;                       // Total number of bytes in the batch
+    int iov_nb;
+    struct iovec iov[BXILOG__IO_IOV_NB];
+    char * owned[BXILOG__IO_IOV_NB];    // Large lines to free once written
+
+    // Set by the submitter
+    size_t written;
+    int error;                          // errno of the failure, 0 if none
+};
+
+typedef struct bxilog__io_s bxilog__io_s;
+typedef bxilog__io_s * bxilog__io_p;
+
+/*
+ * The file handler I/O engine.
+ *
+ * Lines are formatted directly in the current batch buffer. When it is full, the
+ * batch is submitted with writev().
+ *
+ * In asynchronous mode, two batches are used: the submission is done by a helper
+ * thread while the handler thread keeps on formatting in the other batch. The
+ * result of a submission is collected by the handler thread the next time it needs
+ * that batch (or on an explicit wait).
+ *
+ * In mmap mode, the file is extended by segments which are mapped in memory: lines
+ * are formatted directly in the mapping (the single batch buffer), so there is
+ * nothing to submit. Flushing only applies the msync policy. On destruction, the
+ * file is truncated to what has actually been written.
+ *
+ * In compressed mode, each batch is written as a gzip member: the file can be read
+ * back with the usual gzip tools, up to the last complete batch.
+ *
+ * Synchronizations (fdatasync()) are done by the helper thread in asynchronous mode,
+ * once the submitted batch has been written: requests made in the meantime are
+ * coalesced into a single call.
+ */
+struct bxilog__io_s {
+    int fd;
+    bool async;
+    size_t buf_size;
+    size_t reserve_max;                 // Maximum size given to bxilog__io_reserve()
+    size_t bytes_written;
+    size_t bytes_lost;
+    bxilog__io_batch_p current;         // Where lines are formatted
+    bxilog__io_batch_p submitted;       // Submitted, result not collected yet
+    bxilog__io_batch_s batches[2];
+
+    // Asynchronous mode only
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bxilog__io_batch_p inflight;        // Given to the helper thread (mutex protected)
+    bool exit;                          // Helper thread must exit (mutex protected)
+    uint64_t sync_requested;            // Number of sync requests (mutex protected)
+    uint64_t sync_done;                 // Number of requests served (mutex protected)
+    int sync_error;                     // errno of the last failed sync, 0 if none
+                                        // (mutex protected)
+    bool sync_unsupported;              // fdatasync() is meaningless on fd
+
+    // Mmap mode only
+    bool mmap;
+    bxilog_file_handler_msync_e msync;
+    size_t seg_size;                    // Size of a mapping (multiple of buf_size)
+    off_t map_start;                    // File offset of the current mapping
+    size_t synced;                      // Mapping offset up to which msync() was done
+
+    // Compressed mode only (used by the submitter)
+    bxilog__zblock_p zblock;
+};
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Create a new engine writing to fd with buffers of buf_size bytes.
+ *
+ * If async is true, a helper thread is started to submit batches. If it cannot be
+ * started, an error is returned but *result is a valid synchronous engine.
+ */
+bxierr_p bxilog__io_new(int fd, size_t buf_size, bool async, bxilog__io_p * result);
+
+/*
+ * Create a new engine writing fd through mappings of seg_size bytes.
+ *
+ * Writing starts at the current end of the file: fd must be a regular file opened
+ * for reading and writing. If the first mapping fails, an error is returned but
+ * *result is a valid (synchronous) engine using buffers of buf_size bytes.
+ */
+bxierr_p bxilog__io_new_mmap(int fd, size_t buf_size, size_t seg_size,
+                             bxilog_file_handler_msync_e msync,
+                             bxilog__io_p * result);
+
+/*
+ * Compress batches with the given zlib level (1 to 9) from now on.
+ *
+ * It must be called before anything is written, mmap mode is not supported.
+ */
+void bxilog__io_set_compression(bxilog__io_p io, int level);
+
+/* Submit everything, wait for completion and release the engine */
+bxierr_p bxilog__io_destroy(bxilog__io_p * io_p);
+
+/*
+ * Return in *result where size bytes can be written in the current buffer.
+ *
+ * The current batch is submitted first if there is not enough room left.
+ * size must not be greater than io->reserve_max. Written bytes are only taken into
+ * account by bxilog__io_commit().
+ *
+ * The returned error, if any, relates to a previous submission: *result is valid
+ * anyway.
+ */
+bxierr_p bxilog__io_reserve(bxilog__io_p io, size_t size, char ** result);
+
+/* Commit size bytes written at the address returned by bxilog__io_reserve() */
+void bxilog__io_commit(bxilog__io_p io, size_t size);
+
+/*
+ * Append a large line of size bytes to the current batch, after what has already
+ * been committed. The engine takes ownership of line (freed with BXIFREE()).
+ */
+bxierr_p bxilog__io_add(bxilog__io_p io, char * line, size_t size);
+
+/*
+ * Submit the current batch.
+ *
+ * If wait is true, return only once everything submitted so far has been written.
+ */
+bxierr_p bxilog__io_flush(bxilog__io_p io, bool wait);
+
+/*
+ * Make everything submitted so far durable.
+ *
+ * If wait is false in asynchronous mode, only a request is made to the helper
+ * thread: the returned error, if any, relates to a previous request.
+ */
+bxierr_p bxilog__io_sync(bxilog__io_p io, bool wait);
+
+/* Return true if a sync request is still being served by the helper thread */
+bool bxilog__io_sync_busy(bxilog__io_p io);
+
+#endif
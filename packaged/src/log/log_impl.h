@@ -17,8 +17,11 @@
 
 #include <pthread.h>
 
+#include "bxi/base/time.h"
 #include "bxi/base/log.h"
 
+#include "ring_impl.h"
+
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
@@ -41,6 +44,13 @@ typedef enum {
     UNSET, INITIALIZING, BROKEN, INITIALIZED, FINALIZING, FINALIZED, ILLEGAL, FORKED,
 } bxilog_state_e;
 
+/*
+ * Handlers whose bit is set in a bitmask of handlers (see bxilog_logger_s.handlers)
+ * receive the record. Handlers beyond the mask width always receive it.
+ */
+#define BXILOG__HANDLERS_MASK_BITS 64
+#define BXILOG__HANDLERS_ALL UINT64_MAX
+
 
 //*********************************************************************************
 //********************************** Types ****************************************
@@ -63,6 +73,12 @@ typedef struct {
 
     size_t internal_handlers_nb;
     pthread_t *handlers_threads;
+
+    /* Per handler rings registry (BXILOG_TRANSPORT_RING only) */
+    bxilog__ring_registry_p * rings;
+
+    /* Used to convert timestamps (BXITIME_SOURCE_TSC only) */
+    bxitime_tsc_calib_s tsc_calib;
 } bxilog__core_globals_s;
 
 typedef bxilog__core_globals_s * bxilog__core_globals_p;
@@ -81,4 +97,33 @@ void bxilog__wipeout();
 bxierr_p bxilog__finalize(void);
 bxierr_p bxilog__start_handlers(void);
 bxierr_p bxilog__stop_handlers(void);
+
+/*
+ * Send the given record to the given handlers using the configured transport.
+ *
+ * The record must have been allocated with bxilog__record_new() with one reference
+ * per handler given by bxilog__handlers_nb() plus one for the caller: that last one
+ * is released by this function.
+ */
+struct tsd_s;
+bxierr_p bxilog__send_record(struct tsd_s * tsd, bxilog_record_p record, size_t data_len,
+                             uint64_t handlers);
+
+/* Return the number of handlers in the given bitmask */
+size_t bxilog__handlers_nb(uint64_t handlers);
+
+/*
+ * Reconfigure the given logger after the filters of the given handler have been
+ * replaced: only its bit in the handlers masks is recomputed, and the level when
+ * the old filters were the most detailed ones.
+ */
+void bxilog__logger_reconfigure_handler(bxilog_logger_p logger,
+                                        size_t handler_rank,
+                                        bxilog_filters_p old);
+
+/*
+ * Resolve the given call site on first use: compute its basename and assign its id.
+ * Return the site itself. This can be called concurrently by several handlers.
+ */
+bxilog_site_p bxilog__site_resolve(bxilog_site_p site);
 #endif
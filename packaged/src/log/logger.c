@@ -49,13 +49,22 @@
 #include "log_impl.h"
 #include "tsd_impl.h"
 #include "fork_impl.h"
+#include "record_impl.h"
+#include "fmt_impl.h"
+#include "filter_impl.h"
 
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
-#define RETRIES_MAX 2u // We try once asynchronously, then back up to synchronous
+// Sleeping time between two attempts when blocking on a full ring
+#define BLOCK_DELAY 500000l
 
-#define RETRY_DELAY 500000l
+// Transient bxilog_site_s.id value while a handler resolves the site
+#define SITE_RESOLVING UINT32_MAX
+
+// bxilog_limit_s.state of BXILOG_LIMIT_PER_SECOND: the window second, then the count
+#define LIMIT_COUNT_BITS 32
+#define LIMIT_COUNT_MASK ((UINT64_C(1) << LIMIT_COUNT_BITS) - 1)
 
 //*********************************************************************************
 //********************************** Types ****************************************
@@ -67,19 +76,39 @@
 //********************************** Static Functions  ****************************
 //*********************************************************************************
 static bxierr_p _send2handlers(const bxilog_logger_p logger, const bxilog_level_e level,
-                               void ** log_channel,
-#ifdef __linux__
-                               pid_t tid,
-#endif
-                               uintptr_t thread_rank,
+                               tsd_p tsd, bxilog_site_p site,
                                const char * filename, size_t filename_len,
                                const char * funcname, size_t funcname_len,
                                int line,
-                               const char * rawstr, size_t rawstr_len);
+                               const char * rawstr, size_t rawstr_len,
+                               bool deferred);
+static void _format_msg(tsd_p tsd, const char * fmt, va_list arglist,
+                        char ** logmsg_p, size_t * logmsg_len_p,
+                        bool * allocated_p, bool * deferred_p);
+static char * _resize_log_buf(tsd_p tsd, char * logmsg, bool allocated, size_t size);
+static void _ring_snd(bxilog__ring_p ring,
+                      bxilog__ring_registry_p registry,
+                      bxilog_handler_param_p param,
+                      bxilog_record_p record);
+static bxierr_p _zmq_snd(void * zocket,
+                         bxilog_handler_param_p param,
+                         bxilog_record_p record, size_t data_len);
+static uint64_t _handlers(bxilog_logger_p logger, bxilog_level_e level);
+static bool _discarded(bxilog_logger_p logger, bxilog_level_e level);
+static bool _overflow(bxilog_handler_param_p param, bxilog_record_p record);
+static uint64_t _limit_now(void);
+static bool _limit_window(bxilog_limit_p limit);
+static bool _limit_bucket(bxilog_limit_p limit);
+static void _spill(bxilog_handler_param_p param, bxilog_record_p record);
+static bxilog_level_e _handler_level(bxilog_filters_p filters, bxilog_logger_p logger);
+static void _reconfigure_level(bxilog_logger_p logger);
 //*********************************************************************************
 //********************************** Global Variables  ****************************
 //*********************************************************************************
 
+// Number of call sites resolved so far, used to assign their id
+static uint32_t SITES_NB = 0;
+
 // The internal logger
 SET_LOGGER(LOGGER, BXILOG_LIB_PREFIX "bxilog.logger");
 
@@ -101,37 +130,58 @@ void bxilog_logger_set_level(const bxilog_logger_p logger, const bxilog_level_e
 
 void bxilog_logger_reconfigure(const bxilog_logger_p logger) {
     if (NULL == BXILOG__GLOBALS || NULL == BXILOG__GLOBALS->config) return;
-    bxilog_level_e minimum_level = BXILOG_OFF; // The minimum level required for the current logger
-                                               // across all handlers
-    for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
+    _reconfigure_level(logger);
+
+    // Producers only send a log to the handlers that would not discard it
+    uint64_t handlers[BXILOG_LOGGER_LEVELS_NB];
+    memset(handlers, 0, sizeof(handlers));
+    const size_t handlers_nb = BXILOG__GLOBALS->config->handlers_nb;
+    for (size_t i = 0; i < handlers_nb; i++) {
+        if (BXILOG__HANDLERS_MASK_BITS <= i) {
+            // Handlers beyond the mask width always receive logs
+            break;
+        }
         const bxilog_filters_p filters = BXILOG__GLOBALS->config->handlers_params[i]->filters;
-        size_t best_match_len = 0; // The length of the most precise matching filter
-                                   // inside each handler
-        bxilog_level_e best_match_level = BXILOG_LOWEST; // The best match level inside
-                                                         // each handler
-        // First, look after the most precise filter in the current handler
-        for (size_t f = 0; f < filters->nb; f++) {
-            const bxilog_filter_p filter = filters->list[f];
-            const size_t filter_pre_len = strlen(filter->prefix);
-            if (logger->name_length < filter_pre_len) continue;
-            if (0 != strncmp(filter->prefix, logger->name, filter_pre_len)) continue;
-            // This filter prefix matches the logger name
-            // Let see if it is the maximum match
-            if (best_match_len > filter_pre_len) continue;
-            // We found a new good match, make it the last best known
-            best_match_len = filter_pre_len;
-            best_match_level = filter->level;
+        const bxilog_level_e level = bxilog__filters_level(filters, logger->name);
+        for (size_t l = BXILOG_OFF; l <= level && l < BXILOG_LOGGER_LEVELS_NB; l++) {
+            handlers[l] |= UINT64_C(1) << i;
         }
-        // At that stage, we know the most precise filter's level
-        // However, other handlers might have other requirements
-        // If another handler specifies a more detailed level, it must be set in
-        // the logger, otherwise, it won't be seen by expected handlers.
-        // Therefore, the minimum level is the one with the greatest details across
-        // handlers
-        if (best_match_level < minimum_level) continue;
-        minimum_level = best_match_level;
     }
-    logger->level = minimum_level;
+    for (size_t l = 0; l < BXILOG_LOGGER_LEVELS_NB; l++) {
+        __atomic_store_n(&logger->handlers[l], handlers[l], __ATOMIC_RELAXED);
+    }
+}
+
+void bxilog__logger_reconfigure_handler(const bxilog_logger_p logger,
+                                        const size_t handler_rank,
+                                        const bxilog_filters_p old) {
+    bxiassert(NULL != BXILOG__GLOBALS && NULL != BXILOG__GLOBALS->config);
+    bxiassert(handler_rank < BXILOG__GLOBALS->config->handlers_nb);
+
+    const bxilog_filters_p filters =
+        BXILOG__GLOBALS->config->handlers_params[handler_rank]->filters;
+
+    // Only the levels between the previous and the new one change in the mask
+    if (BXILOG__HANDLERS_MASK_BITS > handler_rank) {
+        const uint64_t bit = UINT64_C(1) << handler_rank;
+        const bxilog_level_e level = bxilog__filters_level(filters, logger->name);
+        for (size_t l = 0; l < BXILOG_LOGGER_LEVELS_NB; l++) {
+            const bool set = 0 != (logger->handlers[l] & bit);
+            if (l <= level && !set) {
+                __atomic_or_fetch(&logger->handlers[l], bit, __ATOMIC_RELAXED);
+            } else if (l > level && set) {
+                __atomic_and_fetch(&logger->handlers[l], ~bit, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    // Other handlers only matter when this one was the most detailed
+    const bxilog_level_e level = _handler_level(filters, logger);
+    if (level >= logger->level) {
+        logger->level = level;
+    } else if (_handler_level(old, logger) >= logger->level) {
+        _reconfigure_level(logger);
+    }
 }
 
 
@@ -139,6 +189,39 @@ void bxilog_logger_reconfigure(const bxilog_logger_p logger) {
 extern bool bxilog_logger_is_enabled_for(const bxilog_logger_p logger,
                                          const bxilog_level_e level);
 
+bool bxilog_limit_allow(bxilog_limit_p limit, size_t * suppressed) {
+    bxiassert(NULL != limit);
+    bxiassert(NULL != suppressed);
+    bxiassert(0 < limit->rate);
+
+    bool allowed;
+    switch (limit->policy) {
+        case BXILOG_LIMIT_SAMPLE:
+            allowed = 0 == __atomic_fetch_add(&limit->state, 1, __ATOMIC_RELAXED) %
+                           limit->rate;
+            // The proportion of suppressed logs is known
+            *suppressed = 0;
+            return allowed;
+        case BXILOG_LIMIT_PER_SECOND:
+            allowed = _limit_window(limit);
+            break;
+        case BXILOG_LIMIT_BUCKET:
+            allowed = _limit_bucket(limit);
+            break;
+        default:
+            bxiunreachable_statement;
+            allowed = true;
+    }
+    if (!allowed) {
+        __atomic_add_fetch(&limit->suppressed, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    // Do not write the shared counter when there is nothing to report
+    *suppressed = (0 == __atomic_load_n(&limit->suppressed, __ATOMIC_RELAXED)) ? 0 :
+                  (size_t) __atomic_exchange_n(&limit->suppressed, 0, __ATOMIC_RELAXED);
+    return true;
+}
+
 
 void bxilog_logger_free(bxilog_logger_p self) {
     if (NULL == self) return;
@@ -163,15 +246,12 @@ bxierr_p bxilog_logger_log_rawstr(const bxilog_logger_p logger, const bxilog_lev
     tsd_p tsd;
     bxierr_p err = bxilog__tsd_get(&tsd);
     if (bxierr_isko(err)) return err;
-    err = _send2handlers(logger, level, tsd->data_channel,
-#ifdef __linux__
-                    tsd->tid,
-#endif
-                    tsd->thread_rank,
+    err = _send2handlers(logger, level, tsd, NULL,
                     filename, filename_len,
                     funcname, funcname_len,
                     line,
-                    rawstr, rawstr_len);
+                    rawstr, rawstr_len,
+                    false);
     return err;
 }
 
@@ -185,63 +265,27 @@ bxierr_p bxilog_logger_vlog_nolevelcheck(const bxilog_logger_p logger,
                                          const char * const fmt, va_list arglist) {
 
     if (INITIALIZED != BXILOG__GLOBALS->state) return BXIERR_OK;
+    // No handler wants it: do not even format it
+    if (_discarded(logger, level)) return BXIERR_OK;
 
     tsd_p tsd;
     bxierr_p err = bxilog__tsd_get(&tsd);
     if (bxierr_isko(err)) return err;
 
-    // Start creating the logmsg so the length can be computed
-    // We start in the thread local buffer
-
-    char * logmsg = tsd->log_buf;
-    size_t logmsg_len = BXILOG__GLOBALS->config->tsd_log_buf_size;
-    bool logmsg_allocated = false; // When true,  means that a new special buffer has been
-                                   // allocated -> it will have to be freed
-    while (true) {
-        va_list arglist_copy;
-        va_copy(arglist_copy, arglist);
-        // Does not include the null terminated byte
-        int n = vsnprintf(logmsg, logmsg_len, fmt, arglist_copy);
-        va_end(arglist_copy);
-
-        // Check error
-        bxiassert(n >= 0);
-
-        // Ok
-        if ((size_t) n < logmsg_len) {
-            logmsg_len = (size_t) n + 1; // Record the actual size of the message
-            break;
-        }
-
-        if (logmsg_allocated) BXIFREE(logmsg);
-        // Not enough space, mallocate a new special buffer of the precise size
-        logmsg_len = (size_t) (n + 1);
-        logmsg = malloc(logmsg_len); // Include the null terminated byte
-        bxiassert(NULL != logmsg);
-        logmsg_allocated = true;
-
-        tsd->rsz_log_nb++;
-    }
-
-    tsd->max_log_size = tsd->max_log_size > logmsg_len ? tsd->max_log_size : logmsg_len;
-    tsd->min_log_size = tsd->min_log_size < logmsg_len ? tsd->min_log_size : logmsg_len;
-    tsd->sum_log_size += logmsg_len;
-    tsd->log_nb++;
-
-    bxiassert(bxierr_isok(err));
+    char * logmsg;
+    size_t logmsg_len;
+    bool logmsg_allocated, deferred;
+    _format_msg(tsd, fmt, arglist, &logmsg, &logmsg_len, &logmsg_allocated, &deferred);
 
     const char * filename;
     size_t filename_len = bxistr_rsub(fullfilename, fullfilename_len, '/', &filename);
 
-    err = _send2handlers(logger, level, tsd->data_channel,
-#ifdef __linux__
-                         tsd->tid,
-#endif
-                         tsd->thread_rank,
+    err = _send2handlers(logger, level, tsd, NULL,
                          filename, filename_len,
                          funcname, funcname_len,
                          line,
-                         logmsg, logmsg_len);
+                         logmsg, logmsg_len,
+                         deferred);
 
     if (logmsg_allocated) BXIFREE(logmsg);
     // Either record comes from the stack
@@ -252,6 +296,47 @@ bxierr_p bxilog_logger_vlog_nolevelcheck(const bxilog_logger_p logger,
     return err;
 }
 
+bxierr_p bxilog_logger_vlog_site_nolevelcheck(const bxilog_logger_p logger,
+                                              const bxilog_site_p site,
+                                              const char * const fmt, va_list arglist) {
+
+    if (INITIALIZED != BXILOG__GLOBALS->state) return BXIERR_OK;
+    if (_discarded(logger, site->level)) return BXIERR_OK;
+
+    tsd_p tsd;
+    bxierr_p err = bxilog__tsd_get(&tsd);
+    if (bxierr_isko(err)) return err;
+
+    char * logmsg;
+    size_t logmsg_len;
+    bool logmsg_allocated, deferred;
+    _format_msg(tsd, fmt, arglist, &logmsg, &logmsg_len, &logmsg_allocated, &deferred);
+
+    // The source location is not copied: handlers fetch it from the site
+    err = _send2handlers(logger, site->level, tsd, site,
+                         NULL, 0,
+                         NULL, 0,
+                         site->line,
+                         logmsg, logmsg_len,
+                         deferred);
+
+    if (logmsg_allocated) BXIFREE(logmsg);
+    return err;
+}
+
+bxierr_p bxilog_logger_log_site_nolevelcheck(const bxilog_logger_p logger,
+                                             const bxilog_site_p site,
+                                             const char * fmt, ...) {
+    va_list ap;
+    bxierr_p err;
+
+    va_start(ap, fmt);
+    err = bxilog_logger_vlog_site_nolevelcheck(logger, site, fmt, ap);
+    va_end(ap);
+
+    return err;
+}
+
 bxierr_p bxilog_logger_log_nolevelcheck(const bxilog_logger_p logger,
                                         const bxilog_level_e level,
                                         char * filename, size_t filename_len,
@@ -272,21 +357,74 @@ bxierr_p bxilog_logger_log_nolevelcheck(const bxilog_logger_p logger,
     return err;
 }
 
+bxierr_p bxilog__send_record(const tsd_p tsd,
+                             const bxilog_record_p record,
+                             const size_t data_len,
+                             const uint64_t handlers) {
+    bxierr_p err = BXIERR_OK, err2;
+    const size_t handlers_nb = BXILOG__GLOBALS->internal_handlers_nb;
+
+    for (size_t i = 0; i < handlers_nb; i++) {
+        if (BXILOG__HANDLERS_MASK_BITS > i && 0 == (handlers & (UINT64_C(1) << i))) {
+            continue;
+        }
+        bxilog_handler_param_p param = BXILOG__GLOBALS->config->handlers_params[i];
+        if (NULL != tsd->rings) {
+            // The handler releases its reference once the record is processed
+            _ring_snd(tsd->rings[i], BXILOG__GLOBALS->rings[i], param, record);
+            continue;
+        }
+        err2 = _zmq_snd(tsd->data_channel[i], param, record, data_len);
+        BXIERR_CHAIN(err, err2);
+    }
+    // Release our own reference: the record is actually freed by the last handler
+    bxilog__record_unref(record);
+    return err;
+}
+
+size_t bxilog__handlers_nb(const uint64_t handlers) {
+    const size_t handlers_nb = BXILOG__GLOBALS->internal_handlers_nb;
+    if (BXILOG__HANDLERS_MASK_BITS >= handlers_nb) {
+        const uint64_t all = (BXILOG__HANDLERS_MASK_BITS == handlers_nb) ?
+                              BXILOG__HANDLERS_ALL : (UINT64_C(1) << handlers_nb) - 1;
+        return (size_t) __builtin_popcountll(handlers & all);
+    }
+    return (size_t) __builtin_popcountll(handlers) +
+           handlers_nb - BXILOG__HANDLERS_MASK_BITS;
+}
+
+bxilog_site_p bxilog__site_resolve(const bxilog_site_p site) {
+    uint32_t id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+    if (bxilikely(0 != id && SITE_RESOLVING != id)) return site;
+
+    id = 0;
+    if (__atomic_compare_exchange_n(&site->id, &id, SITE_RESOLVING, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        site->filename_len = bxistr_rsub(site->fullfilename, site->fullfilename_len,
+                                         '/', &site->filename);
+        id = __atomic_add_fetch(&SITES_NB, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+        return site;
+    }
+    // Another handler is resolving it, this is very short
+    while (SITE_RESOLVING == __atomic_load_n(&site->id, __ATOMIC_ACQUIRE));
+
+    return site;
+}
+
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
 
 bxierr_p _send2handlers(const bxilog_logger_p logger,
                         const bxilog_level_e level,
-                        void ** const log_channel,
-#ifdef __linux__
-                        const pid_t tid,
-#endif
-                        const uintptr_t thread_rank,
+                        const tsd_p tsd,
+                        const bxilog_site_p site,
                         const char * const filename, const size_t filename_len,
                         const char * const funcname, const size_t funcname_len,
                         const int line,
-                        const char * const rawstr, const size_t rawstr_len) {
+                        const char * const rawstr, const size_t rawstr_len,
+                        const bool deferred) {
 
     bxierr_p err = BXIERR_OK, err2;
     bxilog_record_p record;
@@ -295,31 +433,32 @@ bxierr_p _send2handlers(const bxilog_logger_p logger,
     size_t var_len = filename_len + funcname_len + logger->name_length;
     size_t data_len = sizeof(*record) + var_len + rawstr_len;
 
-    // We need a mallocated buffer to prevent ZMQ from making its own copy
-    // We use malloc() instead of calloc() for performance reason
-    // This has been profiled! There is a significant gain doing this!
-    // If you change this, you must know what you are doing!
-    record = malloc(data_len);
-    bxiassert(NULL != record);
+    // The record is allocated once and shared by reference between the handlers
+    // accepting it (no copy is made by ZMQ either): one reference per handler,
+    // plus our own one released by bxilog__send_record().
+    if (_discarded(logger, level)) return BXIERR_OK;
+    const uint64_t handlers = _handlers(logger, level);
+    record = bxilog__record_new(tsd->pool, data_len, bxilog__handlers_nb(handlers) + 1);
+    bxilog__record_header_p header = bxilog__record_header(record);
+    if (deferred) header->flags |= BXILOG__RECORD_DEFERRED;
+    header->site = site;
+    header->logger = logger;
     // Fill the buffer
     record->level = level;
 
-    err2 = bxitime_get(CLOCK_REALTIME, &record->detail_time);
-    BXIERR_CHAIN(err, err2);
-
-    if (bxierr_isko(err)) {
-        char * err_str = bxierr_str(err);
-        fprintf(stderr, "[W] Calling bxitime_get() failed: %s\n", err_str);
-        bxierr_destroy(&err);
-        BXIFREE(err_str);
-        record->detail_time.tv_sec = 0;
-        record->detail_time.tv_nsec = 0;
+    const bxitime_source_e source = BXILOG__GLOBALS->config->timestamp_source;
+    if (BXITIME_SOURCE_TSC == source) {
+        // Converted to wall clock time by the handlers
+        header->ticks = bxitime_tsc_read();
+        header->flags |= BXILOG__RECORD_TSC;
+    } else {
+        bxitime_fast_get(source, NULL, &record->detail_time);
     }
     record->pid = BXILOG__GLOBALS->pid;
 #ifdef __linux__
-    record->tid = tid;
+    record->tid = tsd->tid;
 #endif
-    record->thread_rank = thread_rank;
+    record->thread_rank = tsd->thread_rank;
     record->line_nb = line;
     record->filename_len = filename_len;
     record->funcname_len = funcname_len;
@@ -328,33 +467,349 @@ bxierr_p _send2handlers(const bxilog_logger_p logger,
 
     // Now copy the rest after the record
     data = (char *) record + sizeof(*record);
-    memcpy(data, filename, filename_len);
-    data += filename_len;
-    memcpy(data, funcname, funcname_len);
-    data += funcname_len;
+    if (NULL == site) {
+        memcpy(data, filename, filename_len);
+        data += filename_len;
+        memcpy(data, funcname, funcname_len);
+        data += funcname_len;
+    }
     memcpy(data, logger->name, logger->name_length);
     data += logger->name_length;
     memcpy(data, rawstr, rawstr_len);
 
-    for (size_t i = 0; i< BXILOG__GLOBALS->internal_handlers_nb; i++) {
-        // Send the frame
-        // normal version if record comes from the stack 'buf'
-        err2 = bxizmq_data_snd(record, data_len,
-                               log_channel[i], ZMQ_DONTWAIT,
-                               RETRIES_MAX, RETRY_DELAY);
-
-        // Zero-copy version (if record has been mallocated).
-//        err2 = bxizmq_data_snd_zc(record, data_len,
-//                                 log_channel[i], ZMQ_DONTWAIT,
-//                                 RETRIES_MAX, RETRY_DELAY,
-//                                 bxizmq_data_free, NULL);
-
-        if (err2->code == BXIZMQ_RETRIES_MAX_ERR) {
-            bxierr_destroy(&err2);
-        } else {
+    err2 = bxilog__send_record(tsd, record, data_len, handlers);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
+void _format_msg(const tsd_p tsd, const char * const fmt, va_list arglist,
+                 char ** const logmsg_p, size_t * const logmsg_len_p,
+                 bool * const allocated_p, bool * const deferred_p) {
+
+    // Start creating the logmsg so the length can be computed
+    // We start in the thread local buffer
+
+    char * logmsg = tsd->log_buf;
+    size_t logmsg_len = tsd->log_buf_size;
+    bool logmsg_allocated = false; // When true,  means that a new special buffer has been
+                                   // allocated -> it will have to be freed
+
+    // Deferred formatting: only the format pointer and a binary copy of the arguments
+    // are sent, the vsnprintf() cost is paid by the handler threads (and only by
+    // those not filtering out the log).
+    bool deferred = BXILOG__GLOBALS->config->deferred_formatting;
+    while (deferred) {
+        va_list arglist_copy;
+        va_copy(arglist_copy, arglist);
+        size_t needed;
+        deferred = bxilog__fmt_encode(fmt, arglist_copy, logmsg, logmsg_len, &needed);
+        va_end(arglist_copy);
+
+        // Not supported by the encoder: fall back to immediate formatting
+        if (!deferred) break;
+
+        if (needed <= logmsg_len) {
+            logmsg_len = needed;
+            break;
+        }
+        logmsg = _resize_log_buf(tsd, logmsg, logmsg_allocated, needed);
+        logmsg_len = needed;
+        logmsg_allocated = logmsg != tsd->log_buf;
+    }
+
+    while (!deferred) {
+        va_list arglist_copy;
+        va_copy(arglist_copy, arglist);
+        // Does not include the null terminated byte
+        int n = vsnprintf(logmsg, logmsg_len, fmt, arglist_copy);
+        va_end(arglist_copy);
+
+        // Check error
+        bxiassert(n >= 0);
+
+        // Ok
+        if ((size_t) n < logmsg_len) {
+            logmsg_len = (size_t) n + 1; // Record the actual size of the message
+            break;
+        }
+
+        // Not enough space, include the null terminated byte
+        logmsg_len = (size_t) (n + 1);
+        logmsg = _resize_log_buf(tsd, logmsg, logmsg_allocated, logmsg_len);
+        logmsg_allocated = logmsg != tsd->log_buf;
+    }
+
+    tsd->max_log_size = tsd->max_log_size > logmsg_len ? tsd->max_log_size : logmsg_len;
+    tsd->min_log_size = tsd->min_log_size < logmsg_len ? tsd->min_log_size : logmsg_len;
+    tsd->sum_log_size += logmsg_len;
+    tsd->log_nb++;
+
+    *logmsg_p = logmsg;
+    *logmsg_len_p = logmsg_len;
+    *allocated_p = logmsg_allocated;
+    *deferred_p = deferred;
+}
+
+char * _resize_log_buf(const tsd_p tsd, char * const logmsg,
+                       const bool allocated, const size_t size) {
+    tsd->rsz_log_nb++;
+
+    if (size <= BXILOG__TSD_LOG_BUF_MAX) {
+        // Keep the larger buffer for the next logs of this thread
+        bxiassert(!allocated);
+        tsd->log_buf = bximem_realloc(tsd->log_buf, tsd->log_buf_size, size);
+        tsd->log_buf_size = size;
+        return tsd->log_buf;
+    }
+
+    // Too large to be kept: mallocate a new special buffer of the precise size
+    if (allocated) BXIFREE(logmsg);
+    char * result = malloc(size);
+    bxiassert(NULL != result);
+
+    return result;
+}
+
+void _ring_snd(bxilog__ring_p ring,
+               bxilog__ring_registry_p registry,
+               bxilog_handler_param_p param,
+               bxilog_record_p record) {
+
+    if (bxilog__ring_push(ring, record)) {
+        bxilog__ring_registry_wakeup(registry, false);
+        return;
+    }
+    // The handler queue is full
+    bxilog__ring_registry_wakeup(registry, true);
+
+    if (BXILOG_OVERFLOW_DROP_OLDEST == param->overflow_policy) {
+        // We are the only producer: evicting always makes room for us
+        do {
+            bxilog_record_p oldest = bxilog__ring_evict(ring);
+            if (NULL == oldest) continue;
+            __atomic_add_fetch(&param->dropped_nb, 1, __ATOMIC_RELAXED);
+            bxilog__record_unref(oldest);
+        } while (!bxilog__ring_push(ring, record));
+        bxilog__ring_registry_wakeup(registry, false);
+        return;
+    }
+
+    if (!_overflow(param, record)) {
+        // Dropped or spilled: release the handler reference
+        bxilog__record_unref(record);
+        return;
+    }
+
+    // Block until the handler makes some room
+    while (!bxilog__ring_push(ring, record)) {
+        bxilog__ring_registry_wakeup(registry, true);
+        bxierr_p err = bxitime_sleep(CLOCK_MONOTONIC, 0, BLOCK_DELAY);
+        bxierr_destroy(&err);
+    }
+    bxilog__ring_registry_wakeup(registry, false);
+}
+
+bxierr_p _zmq_snd(void * const zocket,
+                  const bxilog_handler_param_p param,
+                  const bxilog_record_p record, const size_t data_len) {
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    // Zero-copy version: the reference is released by zmq_msg_close()
+    // either on the handler side, or here if the record is not sent.
+    zmq_msg_t zmsg;
+    errno = 0;
+    int rc = zmq_msg_init_data(&zmsg, record, data_len, bxilog__record_zmq_free, NULL);
+    if (0 != rc) return bxizmq_err(errno, "Calling zmq_msg_init_data() failed");
+
+    do {
+        errno = 0;
+        rc = zmq_msg_send(&zmsg, zocket, ZMQ_DONTWAIT);
+    } while (-1 == rc && EINTR == errno);
+
+    if (-1 == rc && EAGAIN == errno) {
+        // The handler queue is full
+        if (_overflow(param, record)) {
+            err2 = bxizmq_msg_snd(&zmsg, zocket, 0, 0, 0);
             BXIERR_CHAIN(err, err2);
         }
+    } else if (-1 == rc) {
+        err2 = bxizmq_err(errno, "Can't send msg through zsocket %p", zocket);
+        BXIERR_CHAIN(err, err2);
     }
-    BXIFREE(record);
+
+    err2 = bxizmq_msg_close(&zmsg);
+    BXIERR_CHAIN(err, err2);
+
     return err;
 }
+
+uint64_t _handlers(const bxilog_logger_p logger, const bxilog_level_e level) {
+    bxiassert(BXILOG_LOWEST >= level);
+    return __atomic_load_n(&logger->handlers[level], __ATOMIC_RELAXED);
+}
+
+bool _discarded(const bxilog_logger_p logger, const bxilog_level_e level) {
+    // Handlers beyond the mask width have no bit: they always receive logs
+    if (BXILOG__HANDLERS_MASK_BITS < BXILOG__GLOBALS->internal_handlers_nb) return false;
+    return 0 == _handlers(logger, level);
+}
+
+bool _overflow(const bxilog_handler_param_p param, const bxilog_record_p record) {
+    switch (param->overflow_policy) {
+        case BXILOG_OVERFLOW_BLOCK:
+            return true;
+        case BXILOG_OVERFLOW_DROP_BELOW:
+            if (record->level <= param->overflow_level) return true;
+            break;
+        case BXILOG_OVERFLOW_SPILL:
+            _spill(param, record);
+            return false;
+        case BXILOG_OVERFLOW_DROP_NEWEST:
+        case BXILOG_OVERFLOW_DROP_OLDEST:
+            // Queued zmq messages cannot be evicted: the newest one is dropped
+            break;
+        default:
+            bxiunreachable_statement;
+    }
+    __atomic_add_fetch(&param->dropped_nb, 1, __ATOMIC_RELAXED);
+
+    return false;
+}
+
+void _spill(const bxilog_handler_param_p param, const bxilog_record_p record) {
+    if (0 > __atomic_load_n(&param->overflow_fd, __ATOMIC_RELAXED)) {
+        // The handler is gone (or could not open the file)
+        __atomic_add_fetch(&param->dropped_nb, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    const bxilog__record_header_p header = bxilog__record_header(record);
+    const char * filename = (char *) record + sizeof(*record);
+    const char * funcname = filename + record->filename_len;
+    const char * loggername = funcname + record->funcname_len;
+    const char * logmsg = loggername + record->logname_len;
+    if (NULL != header->site) {
+        const bxilog_site_p site = bxilog__site_resolve(header->site);
+        filename = site->filename;
+        funcname = site->funcname;
+    }
+    struct timespec detail_time = record->detail_time;
+    if (BXILOG__RECORD_TSC & header->flags) {
+        bxitime_tsc_to_timespec(&BXILOG__GLOBALS->tsc_calib, header->ticks, &detail_time);
+    }
+    char * decoded = NULL;
+    size_t decoded_size = 0;
+    if (BXILOG__RECORD_DEFERRED & header->flags) {
+        bxilog__fmt_decode(logmsg, record->logmsg_len, &decoded, &decoded_size, 0);
+        logmsg = decoded;
+    }
+
+    char ** level_names;
+    bxilog_level_names(&level_names);
+    // One write() per line: lines from different threads are not mixed
+    char * line = bxistr_new("%s|%ld.%09ld|%d|%s:%d@%s|%s|%s\n",
+                             level_names[record->level],
+                             (long) detail_time.tv_sec, detail_time.tv_nsec,
+                             record->pid,
+                             filename, record->line_nb, funcname,
+                             loggername, logmsg);
+    const size_t len = strlen(line);
+    // Announce the write before reading the descriptor: the handler does not close
+    // it until all announced writers are done (see _cleanup() in handler.c)
+    __atomic_add_fetch(&param->overflow_writers_nb, 1, __ATOMIC_SEQ_CST);
+    const int fd = __atomic_load_n(&param->overflow_fd, __ATOMIC_SEQ_CST);
+    const ssize_t n = (0 > fd) ? -1 : write(fd, line, len);
+    __atomic_sub_fetch(&param->overflow_writers_nb, 1, __ATOMIC_RELEASE);
+    if (len == (size_t) n) {
+        __atomic_add_fetch(&param->spilled_nb, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_add_fetch(&param->dropped_nb, 1, __ATOMIC_RELAXED);
+    }
+    BXIFREE(line);
+    BXIFREE(decoded);
+}
+
+uint64_t _limit_now(void) {
+    struct timespec now;
+    int rc = clock_gettime(CLOCK_MONOTONIC, &now);
+    bxiassert(0 == rc);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+bool _limit_window(bxilog_limit_p limit) {
+    // Only the low bits of the second are kept: windows are compared for equality
+    const uint64_t second = (_limit_now() / 1000000000) & LIMIT_COUNT_MASK;
+    uint64_t state = __atomic_load_n(&limit->state, __ATOMIC_RELAXED);
+    while (true) {
+        uint64_t next;
+        if (second != state >> LIMIT_COUNT_BITS) {
+            // A new window starts
+            next = (second << LIMIT_COUNT_BITS) | 1;
+        } else if ((state & LIMIT_COUNT_MASK) < limit->rate) {
+            next = state + 1;
+        } else {
+            return false;
+        }
+        if (__atomic_compare_exchange_n(&limit->state, &state, next, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+}
+
+bool _limit_bucket(bxilog_limit_p limit) {
+    // Generic cell rate algorithm: the state is the theoretical arrival time of the
+    // next log when the bucket is full. Each log moves it by one emission interval.
+    const uint64_t interval = 1000000000 / limit->rate;
+    const uint64_t burst = (0 == limit->burst) ? 1 : limit->burst;
+    const uint64_t tolerance = interval * (burst - 1);
+    const uint64_t now = _limit_now();
+    uint64_t tat = __atomic_load_n(&limit->state, __ATOMIC_RELAXED);
+    while (true) {
+        const uint64_t start = (tat > now) ? tat : now;
+        if (start - now > tolerance) return false;
+        if (__atomic_compare_exchange_n(&limit->state, &tat, start + interval, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+}
+
+bxilog_level_e _handler_level(const bxilog_filters_p filters, const bxilog_logger_p logger) {
+    size_t best_match_len = 0; // The length of the most precise matching filter
+    bxilog_level_e best_match_level = BXILOG_LOWEST; // The best match level
+    // Look after the most precise filter
+    for (size_t f = 0; f < filters->nb; f++) {
+        const bxilog_filter_p filter = filters->list[f];
+        const size_t filter_pre_len = strlen(filter->prefix);
+        if (logger->name_length < filter_pre_len) continue;
+        if (0 != strncmp(filter->prefix, logger->name, filter_pre_len)) continue;
+        // This filter prefix matches the logger name
+        // Let see if it is the maximum match
+        if (best_match_len > filter_pre_len) continue;
+        // We found a new good match, make it the last best known
+        best_match_len = filter_pre_len;
+        best_match_level = filter->level;
+    }
+    return best_match_level;
+}
+
+void _reconfigure_level(const bxilog_logger_p logger) {
+    bxilog_level_e minimum_level = BXILOG_OFF; // The minimum level required for the current logger
+                                               // across all handlers
+    for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
+        const bxilog_filters_p filters = BXILOG__GLOBALS->config->handlers_params[i]->filters;
+        // At that stage, we know the most precise filter's level
+        // However, other handlers might have other requirements
+        // If another handler specifies a more detailed level, it must be set in
+        // the logger, otherwise, it won't be seen by expected handlers.
+        // Therefore, the minimum level is the one with the greatest details across
+        // handlers
+        const bxilog_level_e best_match_level = _handler_level(filters, logger);
+        if (best_match_level < minimum_level) continue;
+        minimum_level = best_match_level;
+    }
+    logger->level = minimum_level;
+}
@@ -283,7 +283,7 @@ bxierr_p _process_ierr(bxierr_p *err, bxilog_snmplog_handler_param_p data) {
 
 bxierr_p _process_cfg(bxilog_snmplog_handler_param_p data) {
     UNUSED(data);
-    bxiunreachable_statement;
+    // Filters are applied before records reach us: nothing to do
     return BXIERR_OK;
 }
 
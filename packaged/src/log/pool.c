@@ -0,0 +1,157 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "pool_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static size_t _size_class(size_t size);
+static void _release(bxilog__pool_p pool);
+static void _free_list(bxilog__pool_block_p block);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxilog__pool_p bxilog__pool_new(void) {
+    bxilog__pool_p pool = NULL;
+    int rc = posix_memalign((void **) &pool, BXILOG__POOL_CACHELINE_SIZE, sizeof(*pool));
+    bxiassert(0 == rc && NULL != pool);
+    memset(pool, 0, sizeof(*pool));
+    pool->refcount = 1;
+
+    return pool;
+}
+
+void bxilog__pool_unref(bxilog__pool_p * pool_p) {
+    bxilog__pool_p pool = *pool_p;
+    if (NULL == pool) return;
+    *pool_p = NULL;
+
+    _release(pool);
+}
+
+void * bxilog__pool_alloc(bxilog__pool_p pool, const size_t size) {
+    const size_t total = sizeof(bxilog__pool_block_s) + size;
+    const size_t size_class = _size_class(total);
+    bxilog__pool_block_p block;
+
+    if (NULL == pool || BXILOG__POOL_CLASSES_NB <= size_class) {
+        if (NULL != pool) pool->misses++;
+        // We use malloc() instead of calloc() for performance reason
+        block = malloc(total);
+        bxiassert(NULL != block);
+        block->pool = NULL;
+        return block + 1;
+    }
+
+    block = pool->local[size_class];
+    if (NULL == block) {
+        // Take back all blocks released by other threads at once
+        block = __atomic_exchange_n(&pool->returned[size_class], NULL, __ATOMIC_ACQUIRE);
+    }
+    if (NULL == block) {
+        pool->misses++;
+        block = malloc((size_t) 1 << (size_class + BXILOG__POOL_CLASS_MIN_SHIFT));
+        bxiassert(NULL != block);
+        block->pool = pool;
+        block->size_class = size_class;
+        block->next = NULL;
+    } else {
+        pool->hits++;
+    }
+    pool->local[size_class] = block->next;
+
+    const size_t in_use = __atomic_add_fetch(&pool->refcount, 1, __ATOMIC_RELAXED) - 1;
+    if (in_use > pool->peak) pool->peak = in_use;
+
+    return block + 1;
+}
+
+void bxilog__pool_free(void * const ptr) {
+    if (NULL == ptr) return;
+
+    bxilog__pool_block_p block = ((bxilog__pool_block_p) ptr) - 1;
+    bxilog__pool_p pool = block->pool;
+    if (NULL == pool) {
+        free(block);
+        return;
+    }
+
+    bxilog__pool_block_p * head = &pool->returned[block->size_class];
+    block->next = __atomic_load_n(head, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(head, &block->next, block, true,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    _release(pool);
+}
+
+void bxilog__pool_stats(bxilog__pool_p pool, bxilog__pool_stats_s * stats) {
+    bxiassert(NULL != pool && NULL != stats);
+
+    stats->hits = pool->hits;
+    stats->misses = pool->misses;
+    stats->in_use = __atomic_load_n(&pool->refcount, __ATOMIC_RELAXED) - 1;
+    stats->peak = pool->peak;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+size_t _size_class(const size_t size) {
+    size_t size_class = 0;
+    while (size_class < BXILOG__POOL_CLASSES_NB &&
+           ((size_t) 1 << (size_class + BXILOG__POOL_CLASS_MIN_SHIFT)) < size) {
+        size_class++;
+    }
+    return size_class;
+}
+
+void _release(bxilog__pool_p pool) {
+    if (0 < __atomic_sub_fetch(&pool->refcount, 1, __ATOMIC_ACQ_REL)) return;
+
+    // Last reference: nobody else can access the pool anymore
+    for (size_t i = 0; i < BXILOG__POOL_CLASSES_NB; i++) {
+        _free_list(pool->local[i]);
+        _free_list(pool->returned[i]);
+    }
+    free(pool);
+}
+
+void _free_list(bxilog__pool_block_p block) {
+    while (NULL != block) {
+        bxilog__pool_block_p next = block->next;
+        free(block);
+        block = next;
+    }
+}
@@ -0,0 +1,103 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_POOL_IMPL_H
+#define BXILOG_POOL_IMPL_H
+
+#include <stddef.h>
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Number of size classes: from 256 bytes up to 64 KiB (powers of 2).
+// Larger blocks are always given by malloc().
+#define BXILOG__POOL_CLASSES_NB 9
+#define BXILOG__POOL_CLASS_MIN_SHIFT 8
+
+// Used to prevent false sharing between the owner and the other threads
+#define BXILOG__POOL_CACHELINE_SIZE 64
+
+#define BXILOG__POOL_ALIGNED __attribute__((aligned(BXILOG__POOL_CACHELINE_SIZE)))
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef struct bxilog__pool_block_s bxilog__pool_block_s;
+typedef bxilog__pool_block_s * bxilog__pool_block_p;
+
+typedef struct bxilog__pool_s bxilog__pool_s;
+typedef bxilog__pool_s * bxilog__pool_p;
+
+/* Hidden header of each block given by the pool */
+struct bxilog__pool_block_s {
+    bxilog__pool_p pool;                // NULL when the block comes from malloc()
+    bxilog__pool_block_p next;          // Link in the free lists
+    size_t size_class;
+} __attribute__((aligned(16)));
+
+/*
+ * A per-thread pool of memory blocks, one free list per size class.
+ *
+ * Only the owner thread allocates, but blocks are usually released by other
+ * threads (handlers). Those push them on the lock-free 'returned' lists. The owner
+ * takes a whole 'returned' list at once when its private list is empty, therefore
+ * there is no ABA issue. Once the pool has grown to the peak number of blocks in
+ * flight, no more heap allocation is done.
+ *
+ * The pool is freed when the owner has released it and all blocks are back.
+ */
+struct bxilog__pool_s {
+    // Owner side
+    bxilog__pool_block_p local[BXILOG__POOL_CLASSES_NB] BXILOG__POOL_ALIGNED;
+    size_t hits;                        // Allocations served from the free lists
+    size_t misses;                      // Allocations requiring malloc()
+    size_t peak;                        // Maximum number of blocks in flight
+
+    // Shared side
+    bxilog__pool_block_p returned[BXILOG__POOL_CLASSES_NB] BXILOG__POOL_ALIGNED;
+    size_t refcount;                    // Owner + blocks in flight
+};
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t in_use;
+    size_t peak;
+} bxilog__pool_stats_s;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/* Create a new pool owned by the calling thread */
+bxilog__pool_p bxilog__pool_new(void);
+
+/* Owner side: release the pool, it is actually freed once all its blocks are back */
+void bxilog__pool_unref(bxilog__pool_p * pool_p);
+
+/* Owner side: return a block of at least size bytes (pool may be NULL) */
+void * bxilog__pool_alloc(bxilog__pool_p pool, size_t size);
+
+/* Release the given block, from any thread */
+void bxilog__pool_free(void * ptr);
+
+/* Owner side: fill stats with the current pool statistics */
+void bxilog__pool_stats(bxilog__pool_p pool, bxilog__pool_stats_s * stats);
+
+#endif
@@ -0,0 +1,80 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <stdlib.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "record_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxilog_record_p bxilog__record_new(bxilog__pool_p pool,
+                                   const size_t size, const size_t refs) {
+    bxiassert(0 < refs);
+    // Allocating each record with malloc() has been profiled as a hotspot:
+    // records are recycled through the producer thread pool instead.
+    bxilog__record_header_p header = bxilog__pool_alloc(pool, sizeof(*header) + size);
+    header->refcount = refs;
+    header->size = size;
+    header->flags = 0;
+    header->site = NULL;
+    header->logger = NULL;
+
+    return (bxilog_record_p) (header + 1);
+}
+
+bxilog__record_header_p bxilog__record_header(bxilog_record_p record) {
+    return ((bxilog__record_header_p) record) - 1;
+}
+
+void bxilog__record_ref(bxilog_record_p record) {
+    __atomic_add_fetch(&bxilog__record_header(record)->refcount, 1, __ATOMIC_RELAXED);
+}
+
+void bxilog__record_unref(bxilog_record_p record) {
+    if (NULL == record) return;
+    bxilog__record_header_p header = bxilog__record_header(record);
+
+    if (0 < __atomic_sub_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL)) return;
+    // Given back to the pool of the producer thread
+    bxilog__pool_free(header);
+}
+
+void bxilog__record_zmq_free(void * data, void * hint) {
+    UNUSED(hint);
+    bxilog__record_unref(data);
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
@@ -0,0 +1,84 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_RECORD_IMPL_H
+#define BXILOG_RECORD_IMPL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bxi/base/log/logger.h"
+#include "bxi/base/log/handler.h"
+
+#include "pool_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// The logmsg holds the binary encoding of the format and its arguments
+// (see bxilog__fmt_encode()) instead of the formatted message
+#define BXILOG__RECORD_DEFERRED 0x1
+
+// The timestamp is a raw CPU timestamp counter value held by the header: it is
+// converted to wall clock time by handlers (BXITIME_SOURCE_TSC)
+#define BXILOG__RECORD_TSC 0x2
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+/*
+ * A record is allocated once by the business code thread and shared by reference
+ * between all handlers. This header lives just before the record itself.
+ */
+typedef struct {
+    size_t refcount;                // Number of owners (handlers + producer)
+    size_t size;                    // Size of the record (header excluded)
+    unsigned flags;                 // BXILOG__RECORD_* flags
+    bxilog_site_p site;             // When not NULL, the record holds no filename
+                                    // nor funcname: they are given by the site
+    uint64_t ticks;                 // Timestamp when BXILOG__RECORD_TSC is set
+    bxilog_logger_p logger;         // The producer, NULL if unknown (only used as
+                                    // a key, it might have been released)
+} __attribute__((aligned(16))) bxilog__record_header_s;
+
+typedef bxilog__record_header_s * bxilog__record_header_p;
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Allocate a new record of the given size, owned by refs owners.
+ * The record is taken from the given per-thread pool unless it is NULL.
+ */
+bxilog_record_p bxilog__record_new(bxilog__pool_p pool, size_t size, size_t refs);
+
+/* Return the header of the given record */
+bxilog__record_header_p bxilog__record_header(bxilog_record_p record);
+
+/* Take one more reference on the given record */
+void bxilog__record_ref(bxilog_record_p record);
+
+/* Release one reference on the given record, the last one frees it */
+void bxilog__record_unref(bxilog_record_p record);
+
+/* Same as bxilog__record_unref() but can be used as a zmq_free_fn */
+void bxilog__record_zmq_free(void * data, void * hint);
+
+#endif
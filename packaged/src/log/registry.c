@@ -13,8 +13,11 @@
 
 
 #include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "bxi/base/err.h"
 #include "bxi/base/mem.h"
@@ -30,41 +33,99 @@
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
-#define REGISTERED_LOGGERS_DEFAULT_ARRAY_SIZE 64
+// A power of 2
+#define REGISTRY_DEFAULT_SIZE 128
+
+// The mark left by an unregistered logger, so lookups go on probing after it
+#define TOMBSTONE (&TOMBSTONE_LOGGER)
+
+// Keep each reader slot on its own cache line
+#define READER_ALIGN 64
 
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
 
-
+/*
+ * The index of registered loggers by name: open addressing with linear probing.
+ *
+ * Lookups do not take any lock: they read the currently published index. Writers
+ * update it under REGISTER_LOCK, only filling free or tombstone slots, and keep at
+ * least half of the slots free. When that would not be the case anymore, a new
+ * index is built and published: the previous one is retired but not freed since
+ * some lookup may still be reading it. Retired indexes are freed with the loggers,
+ * at exit, once the lookups in progress are over (see reader_s).
+ */
+typedef struct registry_s registry_s;
+typedef registry_s * registry_p;
+struct registry_s {
+    registry_p retired;             // The previous retired index
+    size_t size;                    // A power of 2
+    bxilog_logger_p slots[];        // NULL when the slot is free
+};
+
+/*
+ * The lookup state of a thread.
+ *
+ * Each thread announces its lookups in its own slot so the read path does not
+ * share any written cache line with other threads. Slots are linked in READERS
+ * forever: a slot released at thread exit is reused by a later thread.
+ */
+typedef struct reader_s reader_s;
+typedef reader_s * reader_p;
+struct reader_s {
+    size_t lookups_nb;              // Non zero while the thread reads the index
+    bool in_use;                    // False once the owning thread has exited
+    reader_p next;                  // The next slot in READERS
+} __attribute__((aligned(READER_ALIGN)));
 
 //*********************************************************************************
 //********************************** Static Functions  ****************************
 //*********************************************************************************
 
-static void _sort(void);
+static size_t _hash(const char * name);
+static bxilog_logger_p _lookup(const char * name);
+static void _insert(bxilog_logger_p logger);
+static void _rebuild(size_t size);
 static int _logger_compar(const void * l1, const void * l2);
 static void _reset_config();
+static reader_p _get_reader();
+static void _new_reader_key();
+static void _free_reader(void * data);
+static void _wait_readers();
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
 //*********************************************************************************
 
 /**
- * Initial number of registered loggers array size
- */
-static size_t REGISTERED_LOGGERS_ARRAY_SIZE = REGISTERED_LOGGERS_DEFAULT_ARRAY_SIZE;
-/**
- * The array of registered loggers.
+ * The published index of registered loggers.
  */
-static bxilog_logger_p * REGISTERED_LOGGERS = NULL;
+static registry_p REGISTRY = NULL;
 /**
  * Number of registered loggers.
  */
 static size_t REGISTERED_LOGGERS_NB = 0;
+/**
+ * Number of non free slots in the index: loggers and tombstones.
+ */
+static size_t REGISTRY_USED_NB = 0;
+/**
+ * All reader slots ever allocated (see reader_s).
+ */
+static reader_p READERS = NULL;
+/**
+ * The reader slot of the current thread.
+ */
+static pthread_key_t READER_KEY;
+static pthread_once_t READER_KEY_ONCE = PTHREAD_ONCE_INIT;
+
+static struct bxilog_logger_s TOMBSTONE_LOGGER;
 
 static pthread_mutex_t REGISTER_LOCK = PTHREAD_MUTEX_INITIALIZER;
 
+size_t BXILOG__REGISTRY_GENERATION = 0;
+
 //*********************************************************************************
 //********************************** Implementation    ****************************
 //*********************************************************************************
@@ -75,48 +136,9 @@ void bxilog_registry_add(bxilog_logger_p logger) {
     int rc = pthread_mutex_lock(&REGISTER_LOCK);
     bxiassert(0 == rc);
 
-    if (REGISTERED_LOGGERS == NULL) {
-        size_t bytes = REGISTERED_LOGGERS_ARRAY_SIZE * sizeof(*REGISTERED_LOGGERS);
-        REGISTERED_LOGGERS = bximem_calloc(bytes);
-        int rc = atexit(bxilog__wipeout);
-        bxiassert(0 == rc);
-
-    } else if (REGISTERED_LOGGERS_NB >= REGISTERED_LOGGERS_ARRAY_SIZE) {
-        size_t old_size = REGISTERED_LOGGERS_ARRAY_SIZE;
-        REGISTERED_LOGGERS_ARRAY_SIZE *= 2;
-        size_t bytes = REGISTERED_LOGGERS_ARRAY_SIZE * sizeof(*REGISTERED_LOGGERS);
-        REGISTERED_LOGGERS = bximem_realloc(REGISTERED_LOGGERS,
-                                            old_size * sizeof(*REGISTERED_LOGGERS),
-                                            bytes);
-
-        DBG("[I] Reallocation of %zu slots for (currently) "
-            "%zu registered loggers\n",
-            REGISTERED_LOGGERS_ARRAY_SIZE,
-            REGISTERED_LOGGERS_NB);
-    }
-
-    size_t slot = REGISTERED_LOGGERS_NB;
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        // Find next free slot
-        if (NULL == REGISTERED_LOGGERS[i]) {
-            if (slot == REGISTERED_LOGGERS_NB) slot = i;
-
-        } else if (0 == strncmp(REGISTERED_LOGGERS[i]->name,
-                                logger->name,
-                                logger->name_length)) {
-            // TODO: provide something better here!
-            fprintf(stderr,
-                    "[W] Logger name '%s' already registered at position %zu, "
-                    "this can lead to various problems such as wrong logging level "
-                    "configuration or misleading messages!\n",
-                    logger->name, i);
-        }
-    }
-    DBG("Registering new logger[%zu]: %s\n", slot, logger->name);
-    REGISTERED_LOGGERS[slot] = logger;
-    REGISTERED_LOGGERS_NB++;
-    _sort();
+    _insert(logger);
     bxilog_logger_reconfigure(logger);
+
     rc = pthread_mutex_unlock(&REGISTER_LOCK);
     bxiassert(0 == rc);
 }
@@ -127,33 +149,20 @@ void bxilog_registry_del(bxilog_logger_p logger) {
     bxiassert(0 == rc);
     bool found = false;
     DBG("Nb Registered loggers: %zu\n", REGISTERED_LOGGERS_NB);
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        bxilog_logger_p current = REGISTERED_LOGGERS[i];
-        if (NULL == current) continue;
-        DBG("Logger[%zu]: %s\n", i, current->name);
-        if (current == logger) {
-         DBG("Unregistering loggers[%zu]: %s\n", i, current->name);
-            REGISTERED_LOGGERS[i] = NULL;
+    if (NULL != REGISTRY) {
+        const size_t mask = REGISTRY->size - 1;
+        for (size_t i = _hash(logger->name) & mask;
+             NULL != REGISTRY->slots[i];
+             i = (i + 1) & mask) {
+            if (REGISTRY->slots[i] != logger) continue;
+            DBG("Unregistering loggers[%zu]: %s\n", i, logger->name);
+            __atomic_store_n(&REGISTRY->slots[i], TOMBSTONE, __ATOMIC_RELEASE);
+            REGISTERED_LOGGERS_NB--;
             found = true;
         }
     }
-    if (!found) {
-//        bxierr_p bxierr = bxierr_gen("[W] Can't find registered logger: %s\n",
-//                                     logger->name);
-//        char * str = NULL;
-//        if (err->str != NULL) {
-//            err_str = err->str(err);
-//        } else {
-//            err_str = bxierr_str(err);
-//        }
-//        _display_err_msg(str);
-//        BXIFREE(str);
-    } else REGISTERED_LOGGERS_NB--;
-
-    if (0 == REGISTERED_LOGGERS_NB) {
-        BXIFREE(REGISTERED_LOGGERS);
-    } else {
-        _sort();
+    if (found) {
+        __atomic_add_fetch(&BXILOG__REGISTRY_GENERATION, 1, __ATOMIC_RELEASE);
     }
     rc = pthread_mutex_unlock(&REGISTER_LOCK);
     bxiassert(0 == rc);
@@ -161,32 +170,29 @@ void bxilog_registry_del(bxilog_logger_p logger) {
 
 
 bxierr_p bxilog_registry_get(const char * logger_name, bxilog_logger_p * result) {
-    *result = NULL;
+    // Most of the time, the logger already exists: no lock is required
+    *result = _lookup(logger_name);
+    if (NULL != *result) return BXIERR_OK;
 
     int rc = pthread_mutex_lock(&REGISTER_LOCK);
     if (0 != rc) return bxierr_errno("Call to pthread_mutex_lock() failed (rc=%d)", rc);
 
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        bxilog_logger_p logger = REGISTERED_LOGGERS[i];
-        if (NULL == logger) continue;
-        if (strncmp(logger->name, logger_name, logger->name_length) == 0) {
-            *result = logger;
-            break;
-        }
-    }
-
-    rc = pthread_mutex_unlock(&REGISTER_LOCK);
-    if (0 != rc) return bxierr_errno("Call to pthread_mutex_unlock() failed (rc=%d)", rc);
-
+    // Another thread may have created it meanwhile
+    *result = _lookup(logger_name);
     if (NULL == *result) { // Not found
         bxilog_logger_p self = bximem_calloc(sizeof(*self));
         self->allocated = true;
         self->name = strdup(logger_name);
         self->name_length = strlen(logger_name) + 1;
         self->level = BXILOG_LOWEST;
-        bxilog_registry_add(self);
+        _insert(self);
+        bxilog_logger_reconfigure(self);
         *result = self;
     }
+
+    rc = pthread_mutex_unlock(&REGISTER_LOCK);
+    if (0 != rc) return bxierr_errno("Call to pthread_mutex_unlock() failed (rc=%d)", rc);
+
     DBG("Returning %s %d\n", (*result)->name, (*result)->level);
     return BXIERR_OK;
 }
@@ -198,12 +204,16 @@ size_t bxilog_registry_getall(bxilog_logger_p *loggers[]) {
     bxiassert(0 == rc);
     bxilog_logger_p * result = bximem_calloc(REGISTERED_LOGGERS_NB * sizeof(*result));
     size_t j = 0;
-    for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-        if (NULL == REGISTERED_LOGGERS[i]) continue;
-        result[j++] = REGISTERED_LOGGERS[i];
+    for (size_t i = 0; NULL != REGISTRY && i < REGISTRY->size; i++) {
+        bxilog_logger_p logger = REGISTRY->slots[i];
+        if (NULL == logger || TOMBSTONE == logger) continue;
+        result[j++] = logger;
     }
     rc = pthread_mutex_unlock(&REGISTER_LOCK);
     bxiassert(0 == rc);
+
+    // Loggers are only sorted by name when requested
+    qsort(result, j, sizeof(*result), _logger_compar);
     *loggers = result;
     return j;
 }
@@ -218,34 +228,209 @@ void bxilog_registry_reset() {
 }
 
 
+void bxilog__registry_reconfigure_handler(size_t handler_rank, bxilog_filters_p old) {
+    // Registering a logger reconfigures it under the same lock
+    int rc = pthread_mutex_lock(&REGISTER_LOCK);
+    bxiassert(0 == rc);
+    for (size_t i = 0; NULL != REGISTRY && i < REGISTRY->size; i++) {
+        bxilog_logger_p logger = REGISTRY->slots[i];
+        if (NULL == logger || TOMBSTONE == logger) continue;
+        bxilog__logger_reconfigure_handler(logger, handler_rank, old);
+    }
+    rc = pthread_mutex_unlock(&REGISTER_LOCK);
+    bxiassert(0 == rc);
+}
+
+
 void bxilog__cfg_release_loggers() {
-    if (NULL != REGISTERED_LOGGERS) {
+    int rc = pthread_mutex_lock(&REGISTER_LOCK);
+    bxiassert(0 == rc);
+
+    // Unpublish the index first: lookups starting from now on do not read it.
+    // Then wait for the lookups still reading it before freeing it.
+    registry_p registry = REGISTRY;
+    __atomic_store_n(&REGISTRY, NULL, __ATOMIC_SEQ_CST);
+    _wait_readers();
+
+    if (NULL != registry) {
         DBG("Nb Registered loggers: %zu\n", REGISTERED_LOGGERS_NB);
-        for (size_t i = 0; i < REGISTERED_LOGGERS_ARRAY_SIZE; i++) {
-            if (NULL == REGISTERED_LOGGERS[i]) {
+        for (size_t i = 0; i < registry->size; i++) {
+            if (NULL == registry->slots[i] || TOMBSTONE == registry->slots[i]) {
                 continue;
             }
-            DBG("loggers[%zu]: %s\n", i, REGISTERED_LOGGERS[i]->name);
-            if (REGISTERED_LOGGERS[i]->allocated) {
-                DBG("[I] Destroying %s\n", REGISTERED_LOGGERS[i]->name);
-                bxilog_logger_destroy(&REGISTERED_LOGGERS[i]);
+            DBG("loggers[%zu]: %s\n", i, registry->slots[i]->name);
+            if (registry->slots[i]->allocated) {
+                DBG("[I] Destroying %s\n", registry->slots[i]->name);
+                bxilog_logger_destroy(&registry->slots[i]);
             }
-            REGISTERED_LOGGERS[i] = NULL;
+            registry->slots[i] = NULL;
             REGISTERED_LOGGERS_NB--;
         }
         bxiassert(0 == REGISTERED_LOGGERS_NB);
+        __atomic_add_fetch(&BXILOG__REGISTRY_GENERATION, 1, __ATOMIC_RELEASE);
         DBG("[I] Removing registered loggers\n");
-        BXIFREE(REGISTERED_LOGGERS);
-        REGISTERED_LOGGERS_ARRAY_SIZE = 0;
+        while (NULL != registry) {
+            registry_p retired = registry->retired;
+            BXIFREE(registry);
+            registry = retired;
+        }
+        REGISTRY_USED_NB = 0;
     }
+
+    rc = pthread_mutex_unlock(&REGISTER_LOCK);
+    bxiassert(0 == rc);
 }
 
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
-void _sort(void) {
-    qsort(REGISTERED_LOGGERS, REGISTERED_LOGGERS_ARRAY_SIZE, sizeof(*REGISTERED_LOGGERS),
-          _logger_compar);
+size_t _hash(const char * name) {
+    // FNV-1a
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (const unsigned char * c = (const unsigned char *) name; '\0' != *c; c++) {
+        hash ^= *c;
+        hash *= UINT64_C(1099511628211);
+    }
+    return (size_t) hash;
+}
+
+bxilog_logger_p _lookup(const char * name) {
+    // Announce the lookup before reading the index (see bxilog__cfg_release_loggers())
+    // Only the current thread writes its slot: no read-modify-write is required.
+    const reader_p reader = _get_reader();
+    const size_t lookups_nb = reader->lookups_nb;
+    __atomic_store_n(&reader->lookups_nb, lookups_nb + 1, __ATOMIC_SEQ_CST);
+    const registry_p registry = __atomic_load_n(&REGISTRY, __ATOMIC_SEQ_CST);
+    bxilog_logger_p result = NULL;
+
+    if (NULL != registry) {
+        const size_t mask = registry->size - 1;
+        for (size_t i = _hash(name) & mask; ; i = (i + 1) & mask) {
+            bxilog_logger_p logger = __atomic_load_n(&registry->slots[i],
+                                                     __ATOMIC_ACQUIRE);
+            if (NULL == logger) break;
+            if (TOMBSTONE == logger) continue;
+            if (0 == strcmp(logger->name, name)) {
+                result = logger;
+                break;
+            }
+        }
+    }
+    __atomic_store_n(&reader->lookups_nb, lookups_nb, __ATOMIC_RELEASE);
+    return result;
+}
+
+reader_p _get_reader() {
+    int rc = pthread_once(&READER_KEY_ONCE, _new_reader_key);
+    bxiassert(0 == rc);
+
+    reader_p reader = pthread_getspecific(READER_KEY);
+    if (NULL != reader) return reader;
+
+    // Reuse the slot of an exited thread if any
+    for (reader = __atomic_load_n(&READERS, __ATOMIC_ACQUIRE);
+         NULL != reader;
+         reader = reader->next) {
+        bool in_use = false;
+        if (__atomic_compare_exchange_n(&reader->in_use, &in_use, true, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (NULL == reader) {
+        rc = posix_memalign((void **) &reader, READER_ALIGN, sizeof(*reader));
+        bxiassert(0 == rc);
+        memset(reader, 0, sizeof(*reader));
+        reader->in_use = true;
+        reader->next = __atomic_load_n(&READERS, __ATOMIC_RELAXED);
+        // Sequentially consistent so _wait_readers() either sees the slot or this
+        // thread sees the index unpublished
+        while (!__atomic_compare_exchange_n(&READERS, &reader->next, reader, true,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+    }
+    rc = pthread_setspecific(READER_KEY, reader);
+    bxiassert(0 == rc);
+    return reader;
+}
+
+void _new_reader_key() {
+    int rc = pthread_key_create(&READER_KEY, _free_reader);
+    bxiassert(0 == rc);
+}
+
+void _free_reader(void * data) {
+    reader_p reader = data;
+    bxiassert(0 == reader->lookups_nb);
+    __atomic_store_n(&reader->in_use, false, __ATOMIC_RELEASE);
+}
+
+void _wait_readers() {
+    // The index has been unpublished with a sequentially consistent store: a lookup
+    // announced after our loads below cannot read it anymore.
+    for (reader_p reader = __atomic_load_n(&READERS, __ATOMIC_SEQ_CST);
+         NULL != reader;
+         reader = reader->next) {
+        while (0 != __atomic_load_n(&reader->lookups_nb, __ATOMIC_SEQ_CST)) {
+            sched_yield();
+        }
+    }
+}
+
+void _insert(bxilog_logger_p logger) {
+    if (NULL == REGISTRY) {
+        int rc = atexit(bxilog__wipeout);
+        bxiassert(0 == rc);
+    }
+    if (NULL == REGISTRY || 2 * (REGISTRY_USED_NB + 1) > REGISTRY->size) {
+        size_t size = REGISTRY_DEFAULT_SIZE;
+        // Tombstones are dropped: leave room for as many loggers again
+        while (size < 4 * (REGISTERED_LOGGERS_NB + 1)) size *= 2;
+        _rebuild(size);
+    }
+
+    const size_t mask = REGISTRY->size - 1;
+    size_t slot = REGISTRY->size;
+    size_t i = _hash(logger->name) & mask;
+    for (; NULL != REGISTRY->slots[i]; i = (i + 1) & mask) {
+        bxilog_logger_p current = REGISTRY->slots[i];
+        if (TOMBSTONE == current) {
+            if (REGISTRY->size == slot) slot = i;
+        } else if (0 == strcmp(current->name, logger->name)) {
+            // TODO: provide something better here!
+            fprintf(stderr,
+                    "[W] Logger name '%s' already registered at position %zu, "
+                    "this can lead to various problems such as wrong logging level "
+                    "configuration or misleading messages!\n",
+                    logger->name, i);
+        }
+    }
+    if (REGISTRY->size == slot) {
+        slot = i;
+        REGISTRY_USED_NB++;
+    }
+    DBG("Registering new logger[%zu]: %s\n", slot, logger->name);
+    __atomic_store_n(&REGISTRY->slots[slot], logger, __ATOMIC_RELEASE);
+    REGISTERED_LOGGERS_NB++;
+}
+
+void _rebuild(size_t size) {
+    registry_p registry = bximem_calloc(sizeof(*registry) + size * sizeof(*registry->slots));
+    registry->size = size;
+    registry->retired = REGISTRY;
+
+    const size_t mask = size - 1;
+    for (size_t i = 0; NULL != REGISTRY && i < REGISTRY->size; i++) {
+        bxilog_logger_p logger = REGISTRY->slots[i];
+        if (NULL == logger || TOMBSTONE == logger) continue;
+        size_t j = _hash(logger->name) & mask;
+        while (NULL != registry->slots[j]) j = (j + 1) & mask;
+        registry->slots[j] = logger;
+    }
+    REGISTRY_USED_NB = REGISTERED_LOGGERS_NB;
+
+    DBG("[I] Reallocation of %zu slots for (currently) "
+        "%zu registered loggers\n", size, REGISTERED_LOGGERS_NB);
+    __atomic_store_n(&REGISTRY, registry, __ATOMIC_RELEASE);
 }
 
 int _logger_compar(const void * l1, const void * l2) {
@@ -254,11 +439,6 @@ int _logger_compar(const void * l1, const void * l2) {
 
     if (logger1 == logger2) return 0;
 
-    if (NULL == logger1) return -1; // l2 is different, therefore it is not NULL and greater
-    if (NULL == logger2) return 1; // Reverse case
-
-
-
     return strcmp(logger1->name, logger2->name);
 }
 
@@ -24,13 +24,32 @@
 // ********************************** Global Variables *****************************
 // *********************************************************************************
 
+/*
+ * Incremented each time a logger is unregistered: caches keyed by logger address
+ * must be cleared then (see filter_impl.h).
+ */
+extern size_t BXILOG__REGISTRY_GENERATION;
 
 
 // *********************************************************************************
 // ********************************** Interface ************************************
 // *********************************************************************************
 
+/*
+ * Release all registered loggers and the index, at exit.
+ *
+ * Lookups in progress are waited for before the index is freed, and lookups starting
+ * meanwhile find no logger. No other thread may use a logger released by this call.
+ */
 void bxilog__cfg_release_loggers();
 
+/*
+ * Reconfigure all registered loggers once the filters of the given handler have been
+ * replaced by new ones (see bxilog__logger_reconfigure_handler()).
+ *
+ * Once done, no registry operation is using the old filters.
+ */
+void bxilog__registry_reconfigure_handler(size_t handler_rank, bxilog_filters_p old);
+
 
 #endif
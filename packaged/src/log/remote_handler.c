@@ -22,6 +22,7 @@
 
 #include "bxi/base/log.h"
 #include "log_impl.h"
+#include "zblock_impl.h"
 
 #include "bxi/base/log/remote_handler.h"
 
@@ -32,6 +33,9 @@
 
 #define INTERNAL_LOGGER_NAME BXILOG_LIB_PREFIX "bxilog.handler.remote"
 
+// A compressed block is sent once it holds that many bytes of records
+#define BLOCK_SIZE (64 * 1024)
+
 #define _ilog(level, data, ...) _internal_log_func(level, data, __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
 
 //*********************************************************************************
@@ -51,6 +55,14 @@ typedef struct bxilog_remote_handler_param_s_f {
     void * cfg_zock;  // Only when bind is false
     void * ctrl_zock;
     void * data_zock;
+    char * record_buf;  // Used to send records that are not contiguous
+    size_t record_buf_size;
+    int compression;    // zlib level, 0 for none
+    bxilog__zblock_p zblock;
+    char * block;       // Records not sent yet (compressed mode only)
+    size_t block_size;
+    size_t block_used;
+    uint32_t block_records_nb;
 
 } bxilog_remote_handler_param_s;
 
@@ -78,6 +90,9 @@ static bxierr_p _process_ctrl_msg(bxilog_remote_handler_param_p data, int revent
 static bxierr_p _process_get_cfg_msg(bxilog_remote_handler_param_p data,
                                      zmq_msg_t id_frame);
 static bxierr_p _sync_pub(bxilog_remote_handler_param_p data);
+static void _append_record(bxilog_remote_handler_param_p data,
+                           bxilog_record_p record, size_t record_len);
+static bxierr_p _send_block(bxilog_remote_handler_param_p data);
 
 //*********************************************************************************
 //********************************** Global Variables  ****************************
@@ -149,10 +164,19 @@ bxilog_handler_param_p _param_new(bxilog_handler_p self,
     result->ctx = NULL;
     result->ctrl_zock = NULL;
     result->data_zock = NULL;
+    result->compression = 0;
 
     return (bxilog_handler_param_p) result;
 }
 
+void bxilog_remote_handler_set_compression(bxilog_handler_param_p param, int level) {
+    bxiassert(NULL != param);
+    bxiassert(0 <= level && 9 >= level);
+
+    bxilog_remote_handler_param_p data = (bxilog_remote_handler_param_p) param;
+    data->compression = level;
+}
+
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
@@ -166,6 +190,12 @@ bxierr_p _init(bxilog_remote_handler_param_p data) {
 
     if (bxierr_isko(err)) return err;
 
+    if (0 < data->compression) {
+        data->zblock = bxilog__zblock_new(data->compression, false);
+        data->block_size = BLOCK_SIZE;
+        data->block = bximem_calloc(data->block_size);
+    }
+
     if (data->bind) {
         int port;
 
@@ -290,6 +320,9 @@ bxierr_p _init(bxilog_remote_handler_param_p data) {
 bxierr_p _process_exit(bxilog_remote_handler_param_p data) {
     bxierr_p err = BXIERR_OK, err2;
 
+    err2 = _send_block(data);
+    BXIERR_CHAIN(err, err2);
+
     // Inform potential receiver that we are exiting
     const char * header =  BXILOG_REMOTE_HANDLER_EXITING_HEADER;
 
@@ -330,14 +363,14 @@ bxierr_p _process_exit(bxilog_remote_handler_param_p data) {
     BXIFREE(data->pub_url);
     BXIFREE(data->generic.private_items);
     BXIFREE(data->generic.cbs);
+    bxilog__zblock_destroy(&data->zblock);
+    BXIFREE(data->block);
 
     return err;
 }
 
 bxierr_p _process_implicit_flush(bxilog_remote_handler_param_p data) {
-    UNUSED(data);
-
-    return BXIERR_OK;
+    return _send_block(data);
 }
 
 bxierr_p _process_explicit_flush(bxilog_remote_handler_param_p data) {
@@ -353,10 +386,44 @@ bxierr_p _process_log(bxilog_record_p record,
 
     bxierr_p err = BXIERR_OK, err2;
 
-    UNUSED(filename);
-    UNUSED(funcname);
-    UNUSED(loggername);
-    UNUSED(logmsg);
+    size_t record_len = sizeof(*record) +\
+            record->filename_len +\
+            record->funcname_len +\
+            record->logname_len +\
+            record->logmsg_len;
+
+    // Strings may not follow the record, for example when they come from a static
+    // call site descriptor: the receiver expects a single contiguous frame.
+    const char * first = (char *) record + sizeof(*record);
+    if (filename != first
+        || funcname != filename + record->filename_len
+        || loggername != funcname + record->funcname_len
+        || logmsg != loggername + record->logname_len) {
+
+        if (data->record_buf_size < record_len) {
+            data->record_buf = bximem_realloc(data->record_buf,
+                                              data->record_buf_size,
+                                              record_len);
+            data->record_buf_size = record_len;
+        }
+        char * p = data->record_buf;
+        memcpy(p, record, sizeof(*record));
+        p += sizeof(*record);
+        memcpy(p, filename, record->filename_len);
+        p += record->filename_len;
+        memcpy(p, funcname, record->funcname_len);
+        p += record->funcname_len;
+        memcpy(p, loggername, record->logname_len);
+        p += record->logname_len;
+        memcpy(p, logmsg, record->logmsg_len);
+        record = (bxilog_record_p) data->record_buf;
+    }
+
+    if (NULL != data->zblock) {
+        _append_record(data, record, record_len);
+        if (data->block_used < BLOCK_SIZE) return err;
+        return _send_block(data);
+    }
 
     const char * header =  _LOG_LEVEL_HEADER[record->level];
 
@@ -364,12 +431,6 @@ bxierr_p _process_log(bxilog_record_p record,
                              0, 0, false);
     BXIERR_CHAIN(err, err2);
 
-    size_t record_len = sizeof(*record) +\
-            record->filename_len +\
-            record->funcname_len +\
-            record->logname_len +\
-            record->logmsg_len;
-
     err2 = bxizmq_data_snd(record, record_len, data->data_zock, 0, 0, 0);
     BXIERR_CHAIN(err, err2);
 
@@ -397,6 +458,7 @@ bxierr_p _param_destroy(bxilog_remote_handler_param_p * data_p) {
 
     BXIFREE(data->ctrl_url);
     BXIFREE(data->hostname);
+    BXIFREE(data->record_buf);
 
     bximem_destroy((char**) data_p);
 
@@ -637,3 +699,47 @@ bxierr_p _sync_pub(bxilog_remote_handler_param_p data) {
     return err;
 
 }
+
+void _append_record(bxilog_remote_handler_param_p data,
+                    bxilog_record_p record, size_t record_len) {
+
+    if (data->block_size - data->block_used < record_len) {
+        const size_t new_size = data->block_used + record_len;
+        data->block = bximem_realloc(data->block, data->block_size, new_size);
+        data->block_size = new_size;
+    }
+    memcpy(data->block + data->block_used, record, record_len);
+    data->block_used += record_len;
+    data->block_records_nb++;
+}
+
+bxierr_p _send_block(bxilog_remote_handler_param_p data) {
+    if (0 == data->block_records_nb) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    const struct iovec iov = {.iov_base = data->block, .iov_len = data->block_used};
+    const char * out;
+    size_t out_len;
+    err2 = bxilog__zblock_deflate(data->zblock, &iov, 1, &out, &out_len);
+    BXIERR_CHAIN(err, err2);
+
+    const uint32_t raw_len = (uint32_t) data->block_used;
+    data->block_used = 0;
+    data->block_records_nb = 0;
+    if (bxierr_isko(err)) return err;
+
+    err2 = bxizmq_str_snd_zc(BXILOG_REMOTE_HANDLER_BLOCK_HEADER, data->data_zock,
+                             ZMQ_SNDMORE, 0, 0, false);
+    BXIERR_CHAIN(err, err2);
+
+    // The receiver needs the size of the decompressed block
+    err2 = bxizmq_data_snd(&raw_len, sizeof(raw_len), data->data_zock,
+                           ZMQ_SNDMORE, 0, 0);
+    BXIERR_CHAIN(err, err2);
+
+    err2 = bxizmq_data_snd(out, out_len, data->data_zock, 0, 0, 0);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
@@ -23,6 +23,8 @@
 
 #include "tsd_impl.h"
 #include "log_impl.h"
+#include "record_impl.h"
+#include "zblock_impl.h"
 
 
 SET_LOGGER(LOGGER, BXILOG_LIB_PREFIX "bxilog.remote");
@@ -69,6 +71,7 @@ struct bxilog_remote_receiver_s {
 //--------------------------------- Generic Helpers --------------------------------
 static bxierr_p _process_ctrl_msg(bxilog_remote_receiver_p self, tsd_p tsd);
 static bxierr_p _process_new_log(bxilog_remote_receiver_p self, tsd_p tsd);
+static bxierr_p _process_new_block(bxilog_remote_receiver_p self, tsd_p tsd);
 static bxierr_p _recv_log_record(void * zock, bxilog_record_p * record_p, size_t * record_len);
 static bxierr_p _dispatch_log_record(tsd_p tsd, bxilog_record_p record, size_t data_len);
 static bxierr_p _connect_zocket(bxilog_remote_receiver_p self);
@@ -83,10 +86,6 @@ static bxierr_p _process_data_header(bxilog_remote_receiver_p self, char *header
 //********************************** Global Variables  ****************************
 //*********************************************************************************
 
-#define BXILOG_RECEIVER_RETRIES_MAX 3u
-
-#define BXILOG_RECEIVER_RETRY_DELAY 500000l
-
 #define BXILOG_RECEIVER_POLLING_TIMEOUT 500
 #define BXILOG_RECEIVER_SYNC_TIMEOUT 1000
 
@@ -547,6 +546,13 @@ bxierr_p _process_data_header(bxilog_remote_receiver_p self, char *header, tsd_p
                       "Problem while receiving bxilog record - continuing (best effort)");
         return BXIERR_OK;
     }
+    if (0 == strncmp(BXILOG_REMOTE_HANDLER_BLOCK_HEADER,
+                     header, ARRAYLEN(BXILOG_REMOTE_HANDLER_BLOCK_HEADER)-1)) {
+        bxierr_p err  = _process_new_block(self, tsd);
+        BXILOG_REPORT(LOGGER, BXILOG_WARNING, err,
+                      "Problem while receiving bxilog block - continuing (best effort)");
+        return BXIERR_OK;
+    }
     bxierr_p tmp_err = bxierr_simple(_BAD_HEADER_ERR,
                                      "Wrong bxilog header: %s",
                                      header);
@@ -591,29 +597,17 @@ bxierr_p _recv_log_record(void * zock, bxilog_record_p * record_p, size_t * reco
 
 bxierr_p _dispatch_log_record(tsd_p tsd, bxilog_record_p record, size_t data_len) {
 
-    bxierr_p err = BXIERR_OK, err2;
-
     LOWEST(LOGGER,
            "Dispatching the log to all %zu handlers",
            BXILOG__GLOBALS->internal_handlers_nb);
 
-    for (size_t i = 0; i < BXILOG__GLOBALS->internal_handlers_nb; i++) {
-      // Send the frame
-      // normal version if record comes from the stack 'buf'
-      err2 = bxizmq_data_snd(record, data_len,
-                             tsd->data_channel[i], ZMQ_DONTWAIT,
-                             BXILOG_RECEIVER_RETRIES_MAX,
-                             BXILOG_RECEIVER_RETRY_DELAY);
+    // Handlers expect a shared record: one reference per handler plus ours
+    bxilog_record_p shared = bxilog__record_new(tsd->pool, data_len,
+                                                BXILOG__GLOBALS->internal_handlers_nb + 1);
+    memcpy(shared, record, data_len);
 
-      // Zero-copy version (if record has been mallocated).
-      //            err2 = bxizmq_data_snd_zc(record, data_len,
-      //                                      tsd->data_channel[i], ZMQ_DONTWAIT,
-      //                                      RETRIES_MAX, RETRY_DELAY,
-      //                                      bxizmq_data_free, NULL);
-      BXIERR_CHAIN(err, err2);
-    }
-
-    return err;
+    // The logger is not known here: handlers filter the record themselves
+    return bxilog__send_record(tsd, shared, data_len, BXILOG__HANDLERS_ALL);
 }
 
 
@@ -757,7 +751,64 @@ bxierr_p _process_new_log(bxilog_remote_receiver_p self, tsd_p tsd) {
     } else {
         err2 = _dispatch_log_record(tsd, record, record_len);
         BXIERR_CHAIN(err, err2);
+        BXIFREE(record);
+    }
+
+    return err;
+}
+
+bxierr_p _process_new_block(bxilog_remote_receiver_p self, tsd_p tsd) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    uint32_t raw_len = 0;
+    uint32_t * raw_len_p = &raw_len;
+    err2 = bxizmq_data_rcv((void**)&raw_len_p, sizeof(raw_len), self->data_zock,
+                           0, true, NULL);
+    BXIERR_CHAIN(err, err2);
+    if (bxierr_isko(err)) return err;
+
+    char * compressed = NULL;
+    size_t size;
+    err2 = bxizmq_data_rcv((void**)&compressed, 0, self->data_zock, 0, true, &size);
+    BXIERR_CHAIN(err, err2);
+    if (bxierr_isko(err)) return err;
+
+    char * block = bximem_calloc(raw_len);
+    err2 = bxilog__zblock_inflate(compressed, size, block, raw_len);
+    BXIERR_CHAIN(err, err2);
+    BXIFREE(compressed);
+
+    size_t offset = 0;
+    size_t records_nb = 0;
+    while (bxierr_isok(err) && offset < raw_len) {
+        // Records are not aligned in the block
+        bxilog_record_s record;
+        if (raw_len - offset < sizeof(record)) {
+            err2 = bxierr_simple(_BAD_RECORD_ERR,
+                                 "Wrong bxilog block: truncated record at %zu", offset);
+            BXIERR_CHAIN(err, err2);
+            break;
+        }
+        memcpy(&record, block + offset, sizeof(record));
+        const size_t record_len = sizeof(record) +
+                                  record.filename_len +
+                                  record.funcname_len +
+                                  record.logname_len +
+                                  record.logmsg_len;
+        if (raw_len - offset < record_len) {
+            err2 = bxierr_simple(_BAD_RECORD_ERR,
+                                 "Wrong bxilog block: record at %zu too large (%zu)",
+                                 offset, record_len);
+            BXIERR_CHAIN(err, err2);
+            break;
+        }
+        err2 = _dispatch_log_record(tsd, (bxilog_record_p) (block + offset), record_len);
+        BXIERR_CHAIN(err, err2);
+        offset += record_len;
+        records_nb++;
     }
+    LOWEST(LOGGER, "Block received, size: %u, records: %zu", raw_len, records_nb);
+    BXIFREE(block);
 
     return err;
 }
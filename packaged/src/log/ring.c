@@ -0,0 +1,286 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "ring_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+static void _refresh_rings(bxilog__ring_registry_p registry);
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxilog__ring_p bxilog__ring_new(size_t size) {
+    size_t slots_nb = 2;
+    while (slots_nb < size) slots_nb <<= 1;
+
+    bxilog__ring_p ring = NULL;
+    const size_t bytes = sizeof(*ring) + slots_nb * sizeof(*ring->slots);
+    int rc = posix_memalign((void **) &ring, BXILOG__RING_CACHELINE_SIZE, bytes);
+    bxiassert(0 == rc && NULL != ring);
+    memset(ring, 0, bytes);
+
+    ring->mask = slots_nb - 1;
+    ring->refcount = 1;
+
+    return ring;
+}
+
+void bxilog__ring_unref(bxilog__ring_p * ring_p) {
+    bxilog__ring_p ring = *ring_p;
+    if (NULL == ring) return;
+    *ring_p = NULL;
+
+    if (0 < __atomic_sub_fetch(&ring->refcount, 1, __ATOMIC_ACQ_REL)) return;
+    free(ring);
+}
+
+void bxilog__ring_close(bxilog__ring_p ring) {
+    __atomic_store_n(&ring->closed, true, __ATOMIC_RELEASE);
+}
+
+bool bxilog__ring_push(bxilog__ring_p ring, void * item) {
+    const size_t tail = ring->tail;
+    if (tail - ring->cached_head > ring->mask) {
+        ring->cached_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (tail - ring->cached_head > ring->mask) return false;
+    }
+    ring->slots[tail & ring->mask] = item;
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+void * bxilog__ring_pop(bxilog__ring_p ring) {
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    while (true) {
+        if (head == ring->cached_tail) {
+            ring->cached_tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+            if (head == ring->cached_tail) return NULL;
+        }
+        void * item = __atomic_load_n(&ring->slots[head & ring->mask], __ATOMIC_RELAXED);
+        // The producer may have evicted this item in the meantime
+        if (__atomic_compare_exchange_n(&ring->head, &head, head + 1, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return item;
+        }
+    }
+}
+
+void * bxilog__ring_evict(bxilog__ring_p ring) {
+    size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    while (head != ring->tail) {
+        void * item = __atomic_load_n(&ring->slots[head & ring->mask], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&ring->head, &head, head + 1, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return item;
+        }
+    }
+    return NULL;
+}
+
+bxierr_p bxilog__ring_registry_new(bxilog__ring_registry_p * result) {
+    bxiassert(NULL != result);
+
+    errno = 0;
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (-1 == fd) {
+        *result = NULL;
+        return bxierr_errno("Calling eventfd() failed");
+    }
+
+    bxilog__ring_registry_p registry = NULL;
+    int rc = posix_memalign((void **) &registry,
+                            BXILOG__RING_CACHELINE_SIZE,
+                            sizeof(*registry));
+    bxiassert(0 == rc && NULL != registry);
+    memset(registry, 0, sizeof(*registry));
+
+    rc = pthread_mutex_init(&registry->mutex, NULL);
+    bxiassert(0 == rc);
+    registry->wakeup_fd = fd;
+
+    *result = registry;
+    return BXIERR_OK;
+}
+
+bxierr_p bxilog__ring_registry_destroy(bxilog__ring_registry_p * registry_p,
+                                       void (*free_fn)(void *)) {
+    bxilog__ring_registry_p registry = *registry_p;
+    if (NULL == registry) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    // The handler thread is gone, take the pending rings as well
+    _refresh_rings(registry);
+
+    while (NULL != registry->rings) {
+        bxilog__ring_p ring = registry->rings;
+        registry->rings = ring->next;
+        void * item;
+        while (NULL != (item = bxilog__ring_pop(ring))) {
+            if (NULL != free_fn) free_fn(item);
+        }
+        bxilog__ring_unref(&ring);
+    }
+
+    errno = 0;
+    int rc = close(registry->wakeup_fd);
+    if (0 != rc) {
+        err2 = bxierr_errno("Calling close(%d) failed", registry->wakeup_fd);
+        BXIERR_CHAIN(err, err2);
+    }
+    rc = pthread_mutex_destroy(&registry->mutex);
+    bxiassert(0 == rc);
+
+    free(registry);
+    *registry_p = NULL;
+
+    return err;
+}
+
+void bxilog__ring_registry_add(bxilog__ring_registry_p registry, bxilog__ring_p ring) {
+    __atomic_add_fetch(&ring->refcount, 1, __ATOMIC_RELAXED);
+
+    int rc = pthread_mutex_lock(&registry->mutex);
+    bxiassert(0 == rc);
+    ring->next = registry->pending;
+    registry->pending = ring;
+    __atomic_add_fetch(&registry->version, 1, __ATOMIC_RELEASE);
+    rc = pthread_mutex_unlock(&registry->mutex);
+    bxiassert(0 == rc);
+}
+
+void bxilog__ring_registry_wakeup(bxilog__ring_registry_p registry, bool force) {
+    // Pairs with the fence in bxilog__ring_registry_idle(): either the handler sees
+    // our new tail, or we see it is sleeping.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!force) {
+        if (!__atomic_load_n(&registry->sleeping, __ATOMIC_RELAXED)) return;
+        if (!__atomic_exchange_n(&registry->sleeping, false, __ATOMIC_SEQ_CST)) return;
+    }
+    const uint64_t one = 1;
+    ssize_t n = write(registry->wakeup_fd, &one, sizeof(one));
+    // EAGAIN means the counter is already huge: the handler will wake up anyway.
+    UNUSED(n);
+}
+
+bool bxilog__ring_registry_idle(bxilog__ring_registry_p registry) {
+    __atomic_store_n(&registry->sleeping, true, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    bool idle = __atomic_load_n(&registry->version,
+                                __ATOMIC_ACQUIRE) == registry->seen_version;
+
+    for (bxilog__ring_p ring = registry->rings; idle && NULL != ring; ring = ring->next) {
+        idle = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) ==
+               __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    }
+    if (!idle) __atomic_store_n(&registry->sleeping, false, __ATOMIC_RELAXED);
+
+    return idle;
+}
+
+void bxilog__ring_registry_awake(bxilog__ring_registry_p registry) {
+    uint64_t value;
+    ssize_t n = read(registry->wakeup_fd, &value, sizeof(value));
+    // EAGAIN: nothing to clear
+    UNUSED(n);
+    __atomic_store_n(&registry->sleeping, false, __ATOMIC_RELAXED);
+}
+
+bxierr_p bxilog__ring_registry_drain(bxilog__ring_registry_p registry,
+                                     bxierr_p (*process)(void * item, void * param),
+                                     void * param,
+                                     size_t * processed) {
+    bxierr_p err = BXIERR_OK;
+    *processed = 0;
+
+    _refresh_rings(registry);
+
+    bxilog__ring_p * prev_p = &registry->rings;
+    while (NULL != *prev_p) {
+        bxilog__ring_p ring = *prev_p;
+        // Read closed before tail: all items pushed before the close are then seen
+        const bool closed = __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE);
+        // Only take what is there now, so a very active producer cannot starve
+        // the other ones
+        const size_t end = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        ring->cached_tail = end;
+        // The producer may evict items as well: head can go beyond end
+        while (0 < (ssize_t) (end - __atomic_load_n(&ring->head, __ATOMIC_RELAXED))) {
+            void * item = bxilog__ring_pop(ring);
+            if (NULL == item) break;
+            (*processed)++;
+            err = process(item, param);
+            if (bxierr_isko(err)) return err;
+        }
+        if (closed) {
+            *prev_p = ring->next;
+            registry->rings_nb--;
+            bxilog__ring_unref(&ring);
+            continue;
+        }
+        prev_p = &ring->next;
+    }
+
+    return err;
+}
+
+//*********************************************************************************
+//********************************** Static Helpers Implementation ****************
+//*********************************************************************************
+
+void _refresh_rings(bxilog__ring_registry_p registry) {
+    if (__atomic_load_n(&registry->version,
+                        __ATOMIC_ACQUIRE) == registry->seen_version) return;
+
+    int rc = pthread_mutex_lock(&registry->mutex);
+    bxiassert(0 == rc);
+    bxilog__ring_p pending = registry->pending;
+    registry->pending = NULL;
+    registry->seen_version = registry->version;
+    rc = pthread_mutex_unlock(&registry->mutex);
+    bxiassert(0 == rc);
+
+    while (NULL != pending) {
+        bxilog__ring_p ring = pending;
+        pending = ring->next;
+        ring->next = registry->rings;
+        registry->rings = ring;
+        registry->rings_nb++;
+    }
+}
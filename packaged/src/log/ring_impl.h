@@ -0,0 +1,154 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#ifndef BXILOG_RING_IMPL_H
+#define BXILOG_RING_IMPL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "bxi/base/err.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// Used to prevent false sharing between the producer and the consumer
+#define BXILOG__RING_CACHELINE_SIZE 64
+
+#define BXILOG__RING_ALIGNED __attribute__((aligned(BXILOG__RING_CACHELINE_SIZE)))
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef struct bxilog__ring_s bxilog__ring_s;
+typedef bxilog__ring_s * bxilog__ring_p;
+
+/*
+ * A single producer/single consumer lock-free ring of pointers.
+ *
+ * The producer is a business code thread (one ring per thread and per handler),
+ * the consumer is the handler thread. Each side owns its own cache line: the
+ * producer only writes 'tail', the consumer only writes 'head'. Each side caches the
+ * last seen value of the other side index so the shared cache line is touched only
+ * when the ring seems full (producer) or empty (consumer).
+ *
+ * 'head' is only moved with a compare-and-swap since the producer may also move it
+ * to evict the oldest item (see bxilog__ring_evict()).
+ */
+struct bxilog__ring_s {
+    // Consumer side
+    size_t head BXILOG__RING_ALIGNED;   // Next slot to read (CAS only)
+    size_t cached_tail;                 // Last known value of tail
+
+    // Producer side
+    size_t tail BXILOG__RING_ALIGNED;   // Next slot to write
+    size_t cached_head;                 // Last known value of head
+
+    // Read-only after creation (except for closed and refcount)
+    size_t mask BXILOG__RING_ALIGNED;   // Number of slots - 1 (power of 2)
+    int refcount;                       // Producer + registry references
+    bool closed;                        // Set by the producer when it exits
+    bxilog__ring_p next;                // Link in the registry (consumer owned)
+    void * slots[];
+};
+
+typedef struct bxilog__ring_registry_s bxilog__ring_registry_s;
+typedef bxilog__ring_registry_s * bxilog__ring_registry_p;
+
+/*
+ * The set of rings a given handler thread must sweep.
+ *
+ * Producers register their rings under the mutex in the 'pending' list and bump
+ * the version. The handler thread splices the pending list into its private
+ * 'rings' list when it sees a new version, therefore the sweep itself is lock-free.
+ */
+struct bxilog__ring_registry_s {
+    pthread_mutex_t mutex;
+    bxilog__ring_p pending;             // Newly registered rings (mutex protected)
+    size_t version;                     // Bumped on each registration
+
+    size_t seen_version BXILOG__RING_ALIGNED; // Handler private from here
+    bxilog__ring_p rings;               // Rings currently swept
+    size_t rings_nb;
+
+    int wakeup_fd BXILOG__RING_ALIGNED; // eventfd used to wake up the handler
+    bool sleeping;                      // True when the handler is about to poll
+};
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/* Create a new ring able to hold at least size pointers (rounded to a power of 2) */
+bxilog__ring_p bxilog__ring_new(size_t size);
+
+/* Release one reference on the given ring, the ring is freed on the last one */
+void bxilog__ring_unref(bxilog__ring_p * ring_p);
+
+/* Producer side: mark the ring as closed, no more push must be done */
+void bxilog__ring_close(bxilog__ring_p ring);
+
+/* Producer side: return false if the ring is full */
+bool bxilog__ring_push(bxilog__ring_p ring, void * item);
+
+/* Consumer side: return NULL if the ring is empty */
+void * bxilog__ring_pop(bxilog__ring_p ring);
+
+/*
+ * Producer side: remove and return the oldest item, NULL if the ring is empty.
+ * Used to make room in a full ring, the consumer simply never sees that item.
+ */
+void * bxilog__ring_evict(bxilog__ring_p ring);
+
+/* Create a new registry */
+bxierr_p bxilog__ring_registry_new(bxilog__ring_registry_p * result);
+
+/* Destroy the registry, remaining items are given to free_fn */
+bxierr_p bxilog__ring_registry_destroy(bxilog__ring_registry_p * registry_p,
+                                       void (*free_fn)(void *));
+
+/* Producer side: register the given ring so the handler will sweep it */
+void bxilog__ring_registry_add(bxilog__ring_registry_p registry, bxilog__ring_p ring);
+
+/* Producer side: wake up the handler if it is sleeping (or always if forced) */
+void bxilog__ring_registry_wakeup(bxilog__ring_registry_p registry, bool force);
+
+/*
+ * Consumer side: declare the handler is about to sleep.
+ * Return false if some items are actually available, in which case the handler
+ * should not sleep.
+ */
+bool bxilog__ring_registry_idle(bxilog__ring_registry_p registry);
+
+/* Consumer side: clear the wakeup notification */
+void bxilog__ring_registry_awake(bxilog__ring_registry_p registry);
+
+/*
+ * Consumer side: sweep all rings, giving each item to the process function.
+ *
+ * Stop on the first error returned by process. The number of processed items is
+ * returned in processed.
+ */
+bxierr_p bxilog__ring_registry_drain(bxilog__ring_registry_p registry,
+                                     bxierr_p (*process)(void * item, void * param),
+                                     void * param,
+                                     size_t * processed);
+
+#endif
@@ -11,12 +11,21 @@
  ###############################################################################
  */
 
+// sendmmsg()
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <unistd.h>
 #include <syscall.h>
 #include <string.h>
 #include <errno.h>
 #include <pthread.h>
 #include <syslog.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include "bxi/base/err.h"
 #include "bxi/base/mem.h"
@@ -34,6 +43,17 @@
 #define INTERNAL_LOGGER_NAME BXILOG_LIB_PREFIX "bxilog.handler.syslog"
 #define LOG_IGNORE INT32_MAX
 
+#define DEFAULT_SOCKET_PATH "/dev/log"
+#define DEFAULT_PENDING_MAX 1024
+// Messages given to a single sendmmsg() call
+#define SEND_MAX 64
+// How long a full buffer, an explicit flush or the exit waits for a slow daemon
+#define SEND_TIMEOUT_MS 1000
+// RFC 5424 limits
+#define APPNAME_MAX 48
+#define MSGID_MAX 32
+#define HOSTNAME_MAX 255
+
 #define _ilog(level, data, ...) _internal_log_func(level, data, __func__, ARRAYLEN(__func__), __LINE__, __VA_ARGS__)
 //*********************************************************************************
 //********************************** Types ****************************************
@@ -53,6 +73,22 @@ typedef struct bxilog_syslog_handler_param_s_f {
     size_t error_nb;
     size_t error_limit;
 
+    // Native mode
+    bxilog_syslog_handler_format_e format;
+    char * path;
+    int fd;
+    char hostname[HOSTNAME_MAX + 1];
+    time_t tm_time;                 // the second tm is related to
+    struct tm tm;
+    char * pending;                 // BXILOG_SYSLOG_HANDLER_MSG_MAX bytes per message
+    size_t * pending_len;
+    size_t pending_max;
+    size_t pending_first;
+    size_t pending_nb;
+    size_t dropped_nb;
+    bool stalled;                   // the daemon did not receive anything for a while
+    struct mmsghdr msgs[SEND_MAX];
+    struct iovec iovs[SEND_MAX];
 } bxilog_syslog_handler_param_s;
 
 typedef struct {
@@ -62,6 +98,8 @@ typedef struct {
     const char *funcname;
     const char * loggername;
     const char *logmsg;
+    const char * header;            // native mode only
+    size_t header_len;
 } log_single_line_param_s;
 
 typedef log_single_line_param_s * log_single_line_param_p;
@@ -79,6 +117,9 @@ static bxierr_p _process_log(bxilog_record_p record,
                              char * loggername,
                              char * logmsg,
                              bxilog_syslog_handler_param_p data);
+static bxierr_p _process_log_batch(bxilog_batch_record_s * records,
+                                   size_t n,
+                                   bxilog_syslog_handler_param_p data);
 static bxierr_p _process_ierr(bxierr_p * err, bxilog_syslog_handler_param_p data);
 static bxierr_p _process_implicit_flush(bxilog_syslog_handler_param_p data);
 static bxierr_p _process_explicit_flush(bxilog_syslog_handler_param_p data);
@@ -86,7 +127,20 @@ static bxierr_p _process_exit(bxilog_syslog_handler_param_p data);
 static bxierr_p _process_cfg(bxilog_syslog_handler_param_p data);
 static bxierr_p _param_destroy(bxilog_syslog_handler_param_p *data_p);
 
-static bxierr_p _sync(bxilog_syslog_handler_param_p data);
+static bxierr_p _sync(bxilog_syslog_handler_param_p data, int timeout_ms);
+static bxierr_p _connect(bxilog_syslog_handler_param_p data);
+static size_t _header(bxilog_syslog_handler_param_p data,
+                      bxilog_record_p record,
+                      int priority,
+                      const char * loggername,
+                      char * buf);
+static bxierr_p _queue(bxilog_syslog_handler_param_p data,
+                       const char * header, size_t header_len,
+                       const char * line, size_t line_len);
+static bxierr_p _send(bxilog_syslog_handler_param_p data, int timeout_ms);
+static bool _wait(bxilog_syslog_handler_param_p data, struct timespec * deadline);
+static void _release(bxilog_syslog_handler_param_p data, size_t n);
+static bxierr_p _report_drops(bxilog_syslog_handler_param_p data);
 
 static bxierr_p _internal_log_func(bxilog_level_e level,
                                    bxilog_syslog_handler_param_p data,
@@ -118,6 +172,9 @@ static const bxilog_handler_s BXILOG_SYSLOG_HANDLER_S = {
                   .process_exit = (bxierr_p (*) (bxilog_handler_param_p)) _process_exit,
                   .process_cfg = (bxierr_p (*) (bxilog_handler_param_p)) _process_cfg,
                   .param_destroy = (bxierr_p (*) (bxilog_handler_param_p*)) _param_destroy,
+                  .process_log_batch = (bxierr_p (*) (bxilog_batch_record_s *,
+                                                      size_t,
+                                                      bxilog_handler_param_p)) _process_log_batch,
 };
 const bxilog_handler_p BXILOG_SYSLOG_HANDLER = (bxilog_handler_p) &BXILOG_SYSLOG_HANDLER_S;
 
@@ -136,6 +193,12 @@ static const int BXILOG2SYSLOG_LEVELS[] = {
     LOG_IGNORE,       // BXILOG_TRACE
     LOG_IGNORE,       // BXILOG_LOWEST
 };
+
+// Not locale dependent, as required by RFC 3164
+static const char * const MONTHS[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec",
+};
 //*********************************************************************************
 //********************************** Implementation    ****************************
 //*********************************************************************************
@@ -159,10 +222,26 @@ bxilog_handler_param_p _param_new(bxilog_handler_p self,
     result->ident = strdup(basename);
     result->option = option;
     result->facility = facility;
+    result->format = BXILOG_SYSLOG_HANDLER_LIBC;
+    result->fd = -1;
 
     return (bxilog_handler_param_p) result;
 }
 
+void bxilog_syslog_handler_set_native(bxilog_handler_param_p param,
+                                      bxilog_syslog_handler_format_e format,
+                                      const char * path,
+                                      size_t pending_max) {
+    bxiassert(NULL != param);
+    bxiassert(BXILOG_SYSLOG_HANDLER_RFC5424 >= format);
+
+    bxilog_syslog_handler_param_p data = (bxilog_syslog_handler_param_p) param;
+    data->format = format;
+    BXIFREE(data->path);
+    data->path = strdup(NULL == path ? DEFAULT_SOCKET_PATH : path);
+    data->pending_max = (0 == pending_max) ? DEFAULT_PENDING_MAX : pending_max;
+}
+
 //*********************************************************************************
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
@@ -181,18 +260,50 @@ bxierr_p _init(bxilog_syslog_handler_param_p data) {
     data->error_nb = 0;
     data->error_limit = 10;
 
-    openlog(data->ident, data->option, data->facility);
+    if (BXILOG_SYSLOG_HANDLER_LIBC == data->format) {
+        openlog(data->ident, data->option, data->facility);
+        return BXIERR_OK;
+    }
 
-    return BXIERR_OK;
+    // As syslog(3) does
+    if (0 == (data->facility & LOG_FACMASK)) data->facility |= LOG_USER;
+
+    int rc = gethostname(data->hostname, sizeof(data->hostname));
+    if (0 != rc || '\0' == data->hostname[0]) strcpy(data->hostname, "-");
+    data->hostname[HOSTNAME_MAX] = '\0';
+    data->tm_time = -1;
+
+    data->pending = bximem_calloc(data->pending_max * BXILOG_SYSLOG_HANDLER_MSG_MAX);
+    data->pending_len = bximem_calloc(data->pending_max * sizeof(*data->pending_len));
+    for (size_t i = 0; i < SEND_MAX; i++) {
+        data->msgs[i].msg_hdr.msg_iov = &data->iovs[i];
+        data->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    return _connect(data);
 }
 
 bxierr_p _process_exit(bxilog_syslog_handler_param_p data) {
     bxierr_p err = BXIERR_OK, err2;
 
-    err2 = _sync(data);
+    err2 = _sync(data, SEND_TIMEOUT_MS);
     BXIERR_CHAIN(err, err2);
 
-    closelog();
+    if (BXILOG_SYSLOG_HANDLER_LIBC == data->format) {
+        closelog();
+    } else {
+        if (0 < data->pending_nb + data->dropped_nb) {
+            err2 = bxierr_gen("%zu syslog messages lost: the syslog daemon (%s) "
+                              "does not keep up", data->pending_nb + data->dropped_nb,
+                              data->path);
+            BXIERR_CHAIN(err, err2);
+        }
+        if (-1 != data->fd) close(data->fd);
+        data->fd = -1;
+        BXIFREE(data->pending);
+        BXIFREE(data->pending_len);
+        data->pending_nb = 0;
+    }
 
     bxierr_set_destroy(&data->errset);
 
@@ -200,8 +311,7 @@ bxierr_p _process_exit(bxilog_syslog_handler_param_p data) {
 }
 
 inline bxierr_p _process_implicit_flush(bxilog_syslog_handler_param_p data) {
-    UNUSED(data);
-    return _sync(data);
+    return _sync(data, 0);
 }
 
 inline bxierr_p _process_explicit_flush(bxilog_syslog_handler_param_p data) {
@@ -210,7 +320,8 @@ inline bxierr_p _process_explicit_flush(bxilog_syslog_handler_param_p data) {
 //    err2 = _ilog(BXILOG_TRACE, data, "Flushing requested");
 //    BXIERR_CHAIN(err, err2);
 
-    err2 = _process_implicit_flush(data);
+    // Wait a bit for a slow daemon
+    err2 = _sync(data, SEND_TIMEOUT_MS);
     BXIERR_CHAIN(err, err2);
 
 //    err2 = _ilog(BXILOG_TRACE, data, "Flushed");
@@ -226,6 +337,16 @@ inline bxierr_p _process_log(bxilog_record_p record,
                              char * logmsg,
                              bxilog_syslog_handler_param_p data) {
 
+    int priority = BXILOG2SYSLOG_LEVELS[record->level];
+    if (LOG_IGNORE == priority) return BXIERR_OK;
+
+    // In native mode, the header is the same for each line
+    char header[BXILOG_SYSLOG_HANDLER_MSG_MAX];
+    size_t header_len = 0;
+    if (BXILOG_SYSLOG_HANDLER_LIBC != data->format) {
+        header_len = _header(data, record, priority, loggername, header);
+    }
+
     log_single_line_param_s param = {
                                      .data = data,
                                      .record = record,
@@ -233,6 +354,8 @@ inline bxierr_p _process_log(bxilog_record_p record,
                                      .funcname = funcname,
                                      .loggername = loggername,
                                      .logmsg = logmsg,
+                                     .header = header,
+                                     .header_len = header_len,
     };
 
     bxierr_p err = bxistr_apply_lines(logmsg,
@@ -243,6 +366,24 @@ inline bxierr_p _process_log(bxilog_record_p record,
     return err;
 }
 
+bxierr_p _process_log_batch(bxilog_batch_record_s * records,
+                            size_t n,
+                            bxilog_syslog_handler_param_p data) {
+    bxierr_p err = BXIERR_OK, err2;
+
+    for (size_t i = 0; i < n; i++) {
+        bxilog_batch_record_s * log = &records[i];
+        err2 = _process_log(log->record, log->filename, log->funcname,
+                            log->loggername, log->logmsg, data);
+        BXIERR_CHAIN(err, err2);
+    }
+    // The whole batch at once
+    err2 = _sync(data, 0);
+    BXIERR_CHAIN(err, err2);
+
+    return err;
+}
+
 
 bxierr_p _process_ierr(bxierr_p *err, bxilog_syslog_handler_param_p data) {
     bxierr_p result = BXIERR_OK;
@@ -280,7 +421,7 @@ bxierr_p _process_ierr(bxierr_p *err, bxilog_syslog_handler_param_p data) {
 
 bxierr_p _process_cfg(bxilog_syslog_handler_param_p data) {
     UNUSED(data);
-    bxiunreachable_statement;
+    // Filters are applied before records reach us: nothing to do
     return BXIERR_OK;
 }
 
@@ -290,18 +431,249 @@ inline bxierr_p _param_destroy(bxilog_syslog_handler_param_p * data_p) {
     bxilog_handler_clean_param(&data->generic);
 
     bxierr_set_destroy(&data->errset);
+    if (-1 != data->fd) close(data->fd);
+    BXIFREE(data->pending);
+    BXIFREE(data->pending_len);
+    BXIFREE(data->path);
     BXIFREE((*data_p)->ident);
     bximem_destroy((char**) data_p);
     return BXIERR_OK;
 }
 
 
-bxierr_p _sync(bxilog_syslog_handler_param_p data) {
-    UNUSED(data);
+bxierr_p _sync(bxilog_syslog_handler_param_p data, int timeout_ms) {
+    if (BXILOG_SYSLOG_HANDLER_LIBC == data->format) return BXIERR_OK;
+    if (NULL == data->pending) return BXIERR_OK;
+
+    bxierr_p err = BXIERR_OK, err2;
+
+    err2 = _send(data, timeout_ms);
+    BXIERR_CHAIN(err, err2);
+
+    if (0 < data->dropped_nb && data->pending_nb < data->pending_max) {
+        err2 = _report_drops(data);
+        BXIERR_CHAIN(err, err2);
+        err2 = _send(data, timeout_ms);
+        BXIERR_CHAIN(err, err2);
+    }
+
+    return err;
+}
+
+bxierr_p _connect(bxilog_syslog_handler_param_p data) {
+    if (-1 != data->fd) close(data->fd);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(data->path) >= sizeof(addr.sun_path)) {
+        data->fd = -1;
+        return bxierr_gen("Syslog socket path too long: %s", data->path);
+    }
+    strcpy(addr.sun_path, data->path);
+
+    errno = 0;
+    data->fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (-1 == data->fd) return bxierr_errno("Calling socket() failed");
+
+    errno = 0;
+    int rc = connect(data->fd, (struct sockaddr *) &addr, sizeof(addr));
+    if (-1 == rc) {
+        bxierr_p err = bxierr_errno("Calling connect(%s) failed", data->path);
+        close(data->fd);
+        data->fd = -1;
+        return err;
+    }
 
     return BXIERR_OK;
 }
 
+size_t _header(bxilog_syslog_handler_param_p data,
+               bxilog_record_p record,
+               int priority,
+               const char * loggername,
+               char * buf) {
+
+    // Logs are produced in order: the broken-down time is rarely recomputed
+    if (record->detail_time.tv_sec != data->tm_time) {
+        localtime_r(&record->detail_time.tv_sec, &data->tm);
+        data->tm_time = record->detail_time.tv_sec;
+    }
+    const struct tm * tm = &data->tm;
+    int pri = data->facility | priority;
+    int len;
+
+    if (BXILOG_SYSLOG_HANDLER_RFC3164 == data->format) {
+        len = snprintf(buf, BXILOG_SYSLOG_HANDLER_MSG_MAX,
+                       "<%d>%s %2d %02d:%02d:%02d %s",
+                       pri, MONTHS[tm->tm_mon], tm->tm_mday,
+                       tm->tm_hour, tm->tm_min, tm->tm_sec,
+                       data->ident);
+        if (0 != (data->option & LOG_PID) && len < BXILOG_SYSLOG_HANDLER_MSG_MAX) {
+            len += snprintf(buf + len, (size_t) (BXILOG_SYSLOG_HANDLER_MSG_MAX - len),
+                            "[%d]", record->pid);
+        }
+        if (len < BXILOG_SYSLOG_HANDLER_MSG_MAX) {
+            len += snprintf(buf + len, (size_t) (BXILOG_SYSLOG_HANDLER_MSG_MAX - len),
+                            ": ");
+        }
+    } else {
+        // MSGID: the logger name, restricted to printable US-ASCII
+        char msgid[MSGID_MAX + 1];
+        size_t msgid_len = 0;
+        for (; msgid_len < MSGID_MAX && '\0' != loggername[msgid_len]; msgid_len++) {
+            char c = loggername[msgid_len];
+            msgid[msgid_len] = (33 <= c && c <= 126) ? c : '_';
+        }
+        if (0 == msgid_len) msgid[msgid_len++] = '-';
+        msgid[msgid_len] = '\0';
+
+        long offset = tm->tm_gmtoff / 60;
+        char sign = (0 > offset) ? '-' : '+';
+        if (0 > offset) offset = -offset;
+
+        len = snprintf(buf, BXILOG_SYSLOG_HANDLER_MSG_MAX,
+                       "<%d>1 %04d-%02d-%02dT%02d:%02d:%02d.%06ld%c%02ld:%02ld "
+                       "%s %.*s %d %s - ",
+                       pri, tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+                       tm->tm_hour, tm->tm_min, tm->tm_sec,
+                       record->detail_time.tv_nsec / 1000, sign, offset / 60, offset % 60,
+                       data->hostname, APPNAME_MAX, data->ident, record->pid, msgid);
+    }
+
+    return (len < BXILOG_SYSLOG_HANDLER_MSG_MAX) ? (size_t) len
+                                                 : BXILOG_SYSLOG_HANDLER_MSG_MAX - 1;
+}
+
+bxierr_p _queue(bxilog_syslog_handler_param_p data,
+                const char * header, size_t header_len,
+                const char * line, size_t line_len) {
+
+    bxierr_p err = BXIERR_OK;
+
+    if (data->pending_nb == data->pending_max) {
+        // Slow down with the daemon, unless it does not receive anything anymore
+        err = _send(data, data->stalled ? 0 : SEND_TIMEOUT_MS);
+        if (data->pending_nb == data->pending_max) {
+            // The buffer is bounded
+            data->stalled = true;
+            data->dropped_nb++;
+            return err;
+        }
+    }
+
+    size_t slot = (data->pending_first + data->pending_nb) % data->pending_max;
+    char * msg = data->pending + slot * BXILOG_SYSLOG_HANDLER_MSG_MAX;
+    memcpy(msg, header, header_len);
+    size_t len = line_len;
+    if (len > BXILOG_SYSLOG_HANDLER_MSG_MAX - header_len) {
+        len = BXILOG_SYSLOG_HANDLER_MSG_MAX - header_len;
+    }
+    memcpy(msg + header_len, line, len);
+    data->pending_len[slot] = header_len + len;
+    data->pending_nb++;
+
+    return err;
+}
+
+bxierr_p _send(bxilog_syslog_handler_param_p data, int timeout_ms) {
+    bxierr_p err = BXIERR_OK, err2;
+    bool reconnected = false;
+    struct timespec deadline = {0, 0};
+
+    if (0 < timeout_ms) {
+        err2 = bxitime_get(CLOCK_MONOTONIC, &deadline);
+        BXIERR_CHAIN(err, err2);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (1000000000L <= deadline.tv_nsec) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    while (0 < data->pending_nb) {
+        if (-1 == data->fd) {
+            // The daemon is away: messages are kept until the buffer is full
+            if (reconnected) break;
+            reconnected = true;
+            err2 = _connect(data);
+            if (bxierr_isko(err2)) {
+                bxierr_destroy(&err2);
+                break;
+            }
+        }
+
+        size_t n = 0;
+        while (n < SEND_MAX && n < data->pending_nb) {
+            size_t slot = (data->pending_first + n) % data->pending_max;
+            data->iovs[n].iov_base = data->pending + slot * BXILOG_SYSLOG_HANDLER_MSG_MAX;
+            data->iovs[n].iov_len = data->pending_len[slot];
+            n++;
+        }
+
+        errno = 0;
+        int rc = sendmmsg(data->fd, data->msgs, (unsigned int) n,
+                          MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (0 < rc) {
+            _release(data, (size_t) rc);
+            data->stalled = false;
+            continue;
+        }
+        if (0 == rc) break;
+        if (EINTR == errno) continue;
+        if (EAGAIN == errno || EWOULDBLOCK == errno || ENOBUFS == errno) {
+            // The daemon does not keep up
+            if (0 < timeout_ms && _wait(data, &deadline)) continue;
+            break;
+        }
+        if (ECONNREFUSED == errno || ENOTCONN == errno || ENOENT == errno) {
+            // The daemon has probably been restarted
+            close(data->fd);
+            data->fd = -1;
+            continue;
+        }
+        // The first message can't be sent at all (e.g. EMSGSIZE)
+        err2 = bxierr_errno("Calling sendmmsg(%s) failed, one message dropped",
+                            data->path);
+        BXIERR_CHAIN(err, err2);
+        _release(data, 1);
+    }
+
+    return err;
+}
+
+bool _wait(bxilog_syslog_handler_param_p data, struct timespec * deadline) {
+    struct timespec now;
+    bxierr_p err = bxitime_get(CLOCK_MONOTONIC, &now);
+    if (bxierr_isko(err)) {
+        bxierr_destroy(&err);
+        return false;
+    }
+    long remaining_ms = (deadline->tv_sec - now.tv_sec) * 1000
+                      + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+    if (0 >= remaining_ms) return false;
+
+    struct pollfd pfd = {.fd = data->fd, .events = POLLOUT, .revents = 0};
+    int rc = poll(&pfd, 1, (int) remaining_ms);
+    // On EINTR, the caller retries
+    return 0 != rc;
+}
+
+void _release(bxilog_syslog_handler_param_p data, size_t n) {
+    data->pending_first = (data->pending_first + n) % data->pending_max;
+    data->pending_nb -= n;
+}
+
+bxierr_p _report_drops(bxilog_syslog_handler_param_p data) {
+    size_t dropped_nb = data->dropped_nb;
+    data->dropped_nb = 0;
+
+    return _ilog(BXILOG_WARNING, data,
+                 "%zu messages dropped: the syslog daemon (%s) does not keep up",
+                 dropped_nb, data->path);
+}
+
 
 bxierr_p _internal_log_func(bxilog_level_e level,
                             bxilog_syslog_handler_param_p data,
@@ -359,21 +731,16 @@ bxierr_p _log_single_line(char * line,
                           bool last,
                           log_single_line_param_p param) {
 
-//    bxilog_syslog_handler_param_p data = param->data;
-    bxilog_record_p record = param->record;
-
-    int priority = BXILOG2SYSLOG_LEVELS[record->level];
+    UNUSED(last);
+    bxilog_syslog_handler_param_p data = param->data;
 
-    if (LOG_IGNORE == priority) return BXIERR_OK;
-
-    if (!last) {
-        char s[line_len + 1];
-        memcpy(s, line, line_len);
-        s[line_len] = '\0';
-        syslog(priority, "%s", s);
-    } else {
-        syslog(priority, "%s", line);
+    if (BXILOG_SYSLOG_HANDLER_LIBC != data->format) {
+        return _queue(data, param->header, param->header_len, line, line_len);
     }
 
+    int priority = BXILOG2SYSLOG_LEVELS[param->record->level];
+    // No copy needed for lines that are not NULL terminated
+    syslog(priority, "%.*s", (int) line_len, line);
+
     return BXIERR_OK;
 }
@@ -38,6 +38,8 @@
 //********************************** Static Functions  ****************************
 //*********************************************************************************
 
+static void _report_stats(const tsd_p tsd);
+
 //*********************************************************************************
 //********************************** Global Variables  ****************************
 //*********************************************************************************
@@ -47,6 +49,8 @@
  * we use thread-specific data to holds thread specific sockets,
  */
 
+SET_LOGGER(LOGGER, BXILOG_LIB_PREFIX "bxilog.tsd");
+
 //*********************************************************************************
 //********************************** Interface         ****************************
 //*********************************************************************************
@@ -55,18 +59,37 @@
 void bxilog__tsd_free(void * const data) {
     const tsd_p tsd = (tsd_p) data;
 
-    if (NULL != tsd->data_channel) {
+    // On thread exit, the key has already been cleared: restore it while reporting
+    if (NULL == pthread_getspecific(BXILOG__GLOBALS->tsd_key)) {
+        int rc = pthread_setspecific(BXILOG__GLOBALS->tsd_key, tsd);
+        bxiassert(0 == rc);
+        _report_stats(tsd);
+        rc = pthread_setspecific(BXILOG__GLOBALS->tsd_key, NULL);
+        bxiassert(0 == rc);
+    }
+
+    if (NULL != tsd->data_channel || NULL != tsd->rings) {
         bxierr_p err = BXIERR_OK, err2;
         for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
-            err2 = bxizmq_zocket_destroy(&tsd->data_channel[i]);
-            BXIERR_CHAIN(err, err2);
+            if (NULL != tsd->rings) {
+                // Handlers own a reference on each ring: they will release it
+                // once all remaining records have been processed.
+                bxilog__ring_close(tsd->rings[i]);
+                bxilog__ring_unref(&tsd->rings[i]);
+            } else {
+                err2 = bxizmq_zocket_destroy(&tsd->data_channel[i]);
+                BXIERR_CHAIN(err, err2);
+            }
         }
         BXIFREE(tsd->data_channel);
+        BXIFREE(tsd->rings);
         err2 = bxizmq_zocket_destroy(&tsd->ctrl_channel);
         BXIERR_CHAIN(err, err2);
         if (bxierr_isko(err)) bxierr_report(&err, STDERR_FILENO);
     }
     BXIFREE(tsd->log_buf);
+    // Records still in flight keep the pool alive until handlers release them
+    bxilog__pool_unref(&tsd->pool);
     BXIFREE(tsd);
 }
 
@@ -106,31 +129,46 @@ bxierr_p bxilog__tsd_get(tsd_p * result) {
 
     bxiassert(NULL != BXILOG__GLOBALS->config->handlers);
     bxiassert(0 < BXILOG__GLOBALS->config->tsd_log_buf_size);
-    tsd->log_buf = bximem_calloc(BXILOG__GLOBALS->config->tsd_log_buf_size);
+    tsd->log_buf_size = BXILOG__GLOBALS->config->tsd_log_buf_size;
+    tsd->log_buf = bximem_calloc(tsd->log_buf_size);
+    tsd->pool = bxilog__pool_new();
+    const bool use_rings = NULL != BXILOG__GLOBALS->rings;
     if (0 != BXILOG__GLOBALS->config->handlers_nb) {
-        tsd->data_channel = bximem_calloc(BXILOG__GLOBALS->config->handlers_nb * 
-                                          sizeof(*tsd->data_channel));
+        if (use_rings) {
+            tsd->rings = bximem_calloc(BXILOG__GLOBALS->config->handlers_nb *
+                                       sizeof(*tsd->rings));
+        } else {
+            tsd->data_channel = bximem_calloc(BXILOG__GLOBALS->config->handlers_nb *
+                                              sizeof(*tsd->data_channel));
+        }
     }
 
     bxierr_list_p errlist = bxierr_list_new();
     for (size_t i = 0; i < BXILOG__GLOBALS->config->handlers_nb; i++) {
-        char * url = BXILOG__GLOBALS->config->handlers_params[i]->data_url;
-        bxiassert(NULL != url);
+        char * url;
         bxierr_p err = BXIERR_OK, err2;
 
-        err2 = bxizmq_zocket_create(BXILOG__GLOBALS->zmq_ctx,
-                                    ZMQ_PUSH,
-                                    &tsd->data_channel[i]);
-        BXIERR_CHAIN(err, err2);
+        if (use_rings) {
+            tsd->rings[i] = bxilog__ring_new(BXILOG__GLOBALS->config->ring_size);
+            bxilog__ring_registry_add(BXILOG__GLOBALS->rings[i], tsd->rings[i]);
+        } else {
+            url = BXILOG__GLOBALS->config->handlers_params[i]->data_url;
+            bxiassert(NULL != url);
 
-        err2 = bxizmq_zocket_setopt(tsd->data_channel[i],
-                                    ZMQ_SNDHWM,
-                                    &BXILOG__GLOBALS->config->data_hwm,
-                                    sizeof(BXILOG__GLOBALS->config->data_hwm));
-        BXIERR_CHAIN(err, err2);
+            err2 = bxizmq_zocket_create(BXILOG__GLOBALS->zmq_ctx,
+                                        ZMQ_PUSH,
+                                        &tsd->data_channel[i]);
+            BXIERR_CHAIN(err, err2);
 
-        err2 = bxizmq_zocket_connect(tsd->data_channel[i], url);
-        BXIERR_CHAIN(err, err2);
+            err2 = bxizmq_zocket_setopt(tsd->data_channel[i],
+                                        ZMQ_SNDHWM,
+                                        &BXILOG__GLOBALS->config->data_hwm,
+                                        sizeof(BXILOG__GLOBALS->config->data_hwm));
+            BXIERR_CHAIN(err, err2);
+
+            err2 = bxizmq_zocket_connect(tsd->data_channel[i], url);
+            BXIERR_CHAIN(err, err2);
+        }
 
         url = BXILOG__GLOBALS->config->handlers_params[i]->ctrl_url;
 
@@ -186,3 +224,16 @@ bxierr_p bxilog__tsd_get(tsd_p * result) {
 //********************************** Static Helpers Implementation ****************
 //*********************************************************************************
 
+void _report_stats(const tsd_p tsd) {
+    if (0 == tsd->log_nb || !bxilog_logger_is_enabled_for(LOGGER, BXILOG_DEBUG)) return;
+
+    bxilog__pool_stats_s stats;
+    bxilog__pool_stats(tsd->pool, &stats);
+    DEBUG(LOGGER,
+          "Thread exit: %zu logs, size min/avg/max: %zu/%zu/%zu, %zu buffer resizes, "
+          "pool hits/misses: %zu/%zu, blocks peak/in use: %zu/%zu",
+          tsd->log_nb,
+          tsd->min_log_size, tsd->sum_log_size / tsd->log_nb, tsd->max_log_size,
+          tsd->rsz_log_nb,
+          stats.hits, stats.misses, stats.peak, stats.in_use);
+}
@@ -19,10 +19,17 @@
 
 #include "bxi/base/err.h"
 
+#include "ring_impl.h"
+#include "pool_impl.h"
+
 //*********************************************************************************
 //********************************** Defines **************************************
 //*********************************************************************************
 
+// The per-thread log buffer grows up to this size to hold oversized messages,
+// larger ones are allocated on each log
+#define BXILOG__TSD_LOG_BUF_MAX (64 * 1024)
+
 //*********************************************************************************
 //********************************** Types ****************************************
 //*********************************************************************************
@@ -35,7 +42,10 @@ struct tsd_s {
     size_t sum_log_size;
 
     char *  log_buf;                 // The per-thread log buffer
+    size_t log_buf_size;
+    bxilog__pool_p pool;              // The per-thread pool records are taken from
     void ** data_channel;             // The thread-specific zmq logging socket;
+    bxilog__ring_p * rings;           // The thread-specific rings (one per handler)
     void *  ctrl_channel;             // The thread-specific zmq controlling socket;
 #ifdef __linux__
     pid_t tid;                      // Cache the tid on Linux since we assume NPTL
@@ -0,0 +1,130 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <string.h>
+
+#include "bxi/base/err.h"
+#include "bxi/base/mem.h"
+
+#include "zblock_impl.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+// zlib windowBits: raw deflate, or gzip wrapper
+#define RAW_WINDOW_BITS (-MAX_WBITS)
+#define GZIP_WINDOW_BITS (MAX_WBITS + 16)
+
+#define MEM_LEVEL 8
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Static Functions  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Implementation    ****************************
+//*********************************************************************************
+
+bxilog__zblock_p bxilog__zblock_new(int level, bool gzip) {
+    bxiassert(Z_BEST_SPEED <= level && Z_BEST_COMPRESSION >= level);
+
+    bxilog__zblock_p self = bximem_calloc(sizeof(*self));
+    self->gzip = gzip;
+    // Only fails on bad parameters or memory exhaustion
+    int rc = deflateInit2(&self->stream, level, Z_DEFLATED,
+                          gzip ? GZIP_WINDOW_BITS : RAW_WINDOW_BITS,
+                          MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    bxiassert(Z_OK == rc);
+
+    return self;
+}
+
+void bxilog__zblock_destroy(bxilog__zblock_p * self_p) {
+    bxilog__zblock_p self = *self_p;
+    if (NULL == self) return;
+
+    deflateEnd(&self->stream);
+    BXIFREE(self->out);
+    bximem_destroy((char**) self_p);
+}
+
+bxierr_p bxilog__zblock_deflate(bxilog__zblock_p self,
+                                const struct iovec * iov, int iov_nb,
+                                const char ** out, size_t * out_len) {
+
+    *out = NULL;
+    *out_len = 0;
+
+    int rc = deflateReset(&self->stream);
+    bxiassert(Z_OK == rc);
+
+    size_t len = 0;
+    for (int i = 0; i < iov_nb; i++) len += iov[i].iov_len;
+
+    // With enough room, deflate() always consumes all its input
+    const size_t bound = deflateBound(&self->stream, (uLong) len);
+    if (self->out_size < bound) {
+        self->out = bximem_realloc(self->out, self->out_size, bound);
+        self->out_size = bound;
+    }
+    self->stream.next_out = (Bytef *) self->out;
+    self->stream.avail_out = (uInt) self->out_size;
+
+    for (int i = 0; i < iov_nb; i++) {
+        self->stream.next_in = (Bytef *) iov[i].iov_base;
+        self->stream.avail_in = (uInt) iov[i].iov_len;
+        rc = deflate(&self->stream, Z_NO_FLUSH);
+        if (Z_OK != rc && Z_BUF_ERROR != rc) {
+            return bxierr_gen("Calling deflate() failed (rc=%d)", rc);
+        }
+    }
+    rc = deflate(&self->stream, Z_FINISH);
+    if (Z_STREAM_END != rc) return bxierr_gen("Calling deflate() failed (rc=%d)", rc);
+
+    *out = self->out;
+    *out_len = self->out_size - self->stream.avail_out;
+
+    return BXIERR_OK;
+}
+
+bxierr_p bxilog__zblock_inflate(const char * in, size_t in_len,
+                                char * out, size_t out_len) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int rc = inflateInit2(&stream, RAW_WINDOW_BITS);
+    if (Z_OK != rc) return bxierr_gen("Calling inflateInit2() failed (rc=%d)", rc);
+
+    stream.next_in = (Bytef *) in;
+    stream.avail_in = (uInt) in_len;
+    stream.next_out = (Bytef *) out;
+    stream.avail_out = (uInt) out_len;
+    rc = inflate(&stream, Z_FINISH);
+    const size_t produced = out_len - stream.avail_out;
+    inflateEnd(&stream);
+
+    if (Z_STREAM_END != rc || produced != out_len) {
+        return bxierr_gen("Bad compressed block (rc=%d, %zu bytes instead of %zu)",
+                          rc, produced, out_len);
+    }
+
+    return BXIERR_OK;
+}
@@ -0,0 +1,86 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 24, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+
+#ifndef BXILOG_ZBLOCK_IMPL_H
+#define BXILOG_ZBLOCK_IMPL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+#include <zlib.h>
+
+#include "bxi/base/err.h"
+
+//*********************************************************************************
+//********************************** Defines **************************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Types ****************************************
+//*********************************************************************************
+
+typedef struct bxilog__zblock_s bxilog__zblock_s;
+typedef bxilog__zblock_s * bxilog__zblock_p;
+
+/*
+ * Compress blocks independently of each other (deflate).
+ *
+ * Each block can therefore be decompressed on its own: a reader may start at any
+ * block and a corrupted block does not prevent reading the following ones.
+ * With the gzip framing, each block is a gzip member: a file made of such
+ * blocks is a valid gzip file (e.g. for zcat).
+ */
+struct bxilog__zblock_s {
+    z_stream stream;
+    bool gzip;
+    char * out;                         // Last compressed block
+    size_t out_size;                    // Allocated size
+};
+
+//*********************************************************************************
+//********************************** Global Variables  ****************************
+//*********************************************************************************
+
+//*********************************************************************************
+//********************************** Interface         ****************************
+//*********************************************************************************
+
+/*
+ * Create a new compressor with the given zlib level (1 to 9).
+ *
+ * Blocks are raw deflate streams, or gzip members if gzip is true.
+ */
+bxilog__zblock_p bxilog__zblock_new(int level, bool gzip);
+
+/* Release the given compressor */
+void bxilog__zblock_destroy(bxilog__zblock_p * self_p);
+
+/*
+ * Compress the concatenation of the given iovec list as a new block.
+ *
+ * The block is returned in *out (owned by self, valid until the next call).
+ */
+bxierr_p bxilog__zblock_deflate(bxilog__zblock_p self,
+                                const struct iovec * iov, int iov_nb,
+                                const char ** out, size_t * out_len);
+
+/*
+ * Decompress the given raw deflate block into out which must be exactly out_len
+ * bytes long once decompressed.
+ */
+bxierr_p bxilog__zblock_inflate(const char * in, size_t in_len,
+                                char * out, size_t out_len);
+
+#endif
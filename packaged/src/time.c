@@ -14,6 +14,7 @@
 #include <time.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include <stdio.h>
 
 #include "bxi/base/mem.h"
@@ -25,6 +26,11 @@
 // ********************************** Defines **************************************
 // *********************************************************************************
 
+// Duration of the CPU timestamp counter calibration (ns)
+#define TSC_CALIBRATION_DELAY 10000000l
+
+#define NS_PER_SEC 1000000000l
+
 // *********************************************************************************
 // ********************************** Types ****************************************
 // *********************************************************************************
@@ -41,6 +47,12 @@
 // ********************************** Implementation   *****************************
 // *********************************************************************************
 
+// Instantiate the inline functions defined in the header
+extern uint64_t bxitime_tsc_read(void);
+extern void bxitime_fast_get(const bxitime_source_e source,
+                             const bxitime_tsc_calib_s * const calib,
+                             struct timespec * const time);
+
 
 bxierr_p bxitime_sleep(clockid_t clk_id, const time_t tv_sec, const long tv_nsec) {
 
@@ -106,6 +118,48 @@ bxierr_p bxitime_str(struct timespec * time, char ** result) {
     return BXIERR_OK;
 }
 
+bxierr_p bxitime_tsc_calibrate(const bxitime_tsc_calib_p calib) {
+    struct timespec start, end, now;
+
+    bxierr_p err = bxitime_get(CLOCK_MONOTONIC, &start);
+    if (bxierr_isko(err)) return err;
+    const uint64_t start_ticks = bxitime_tsc_read();
+
+    err = bxitime_sleep(CLOCK_MONOTONIC, 0, TSC_CALIBRATION_DELAY);
+    if (bxierr_isko(err)) return err;
+
+    err = bxitime_get(CLOCK_MONOTONIC, &end);
+    if (bxierr_isko(err)) return err;
+    const uint64_t end_ticks = bxitime_tsc_read();
+    err = bxitime_get(CLOCK_REALTIME, &now);
+    if (bxierr_isko(err)) return err;
+
+    if (end_ticks <= start_ticks) {
+        return bxierr_gen("The CPU timestamp counter is not increasing: "
+                          "%" PRIu64 " -> %" PRIu64,
+                          start_ticks, end_ticks);
+    }
+    const double elapsed = (double) (end.tv_sec - start.tv_sec) * NS_PER_SEC +
+                           (double) (end.tv_nsec - start.tv_nsec);
+
+    calib->ns_per_tick = elapsed / (double) (end_ticks - start_ticks);
+    calib->ticks = end_ticks;
+    calib->time_ns = (int64_t) now.tv_sec * NS_PER_SEC + now.tv_nsec;
+
+    return BXIERR_OK;
+}
+
+void bxitime_tsc_to_timespec(const bxitime_tsc_calib_s * const calib,
+                             const uint64_t ticks,
+                             struct timespec * const time) {
+    // Signed: the counter may have been read before the calibration
+    const int64_t delta = (int64_t) (ticks - calib->ticks);
+    const int64_t ns = calib->time_ns + (int64_t) ((double) delta * calib->ns_per_tick);
+
+    time->tv_sec = (time_t) (ns / NS_PER_SEC);
+    time->tv_nsec = (long) (ns % NS_PER_SEC);
+}
+
 char * bxitime_duration_str(const double duration){
     long iduration = (long) duration;
     long double rest = (long double) duration - (long double) iduration;
@@ -73,6 +73,18 @@ static bxierr_p _process_sub_last_msg(void * sync_zocket,
 // ********************************** Global Variables *****************************
 // *********************************************************************************
 
+// Expected conditions on hot paths: preallocated, without backtrace
+static bxierr_s EAGAIN_ERR_S = BXIERR_STATIC_INIT(EAGAIN,
+                                                  "Can't receive a msg through zocket: "
+                                                  "Resource temporarily unavailable");
+static bxierr_s RETRIES_MAX_ERR_S = BXIERR_STATIC_INIT(BXIZMQ_RETRIES_MAX_ERR,
+                                                       "Sending a message "
+                                                       "needed retries");
+static bxierr_s RCV_RETRIES_MAX_ERR_S = BXIERR_STATIC_INIT(BXIZMQ_RETRIES_MAX_ERR,
+                                                           "No message received "
+                                                           "after the maximum number "
+                                                           "of retries");
+
 // *********************************************************************************
 // ********************************** Implementation   *****************************
 // *********************************************************************************
@@ -462,6 +474,8 @@ bxierr_p bxizmq_msg_rcv(void * const zocket,
                                                  "through zocket: %p:"
                                                  " ZMQ EFSM (man zmq_msg_recv)",
                                                  zocket);
+            // Expected with ZMQ_DONTWAIT, and frequent: no need for a backtrace
+            if (EAGAIN == errno) return &EAGAIN_ERR_S;
 
             return bxizmq_err(errno, "Can't receive a msg through zocket %p", zocket);
         }
@@ -495,9 +509,10 @@ bxierr_p bxizmq_msg_rcv_async(void * const zocket, zmq_msg_t * const msg,
         BXIERR_CHAIN(err, err2);
     }
 
-    return bxierr_new(4941, NULL, NULL, NULL, err,
-                      "No receipt after %zu retries. Giving up.",
-                      retries_max);
+    // Expected when polling: no need for a backtrace
+    bxierr_p new = &RCV_RETRIES_MAX_ERR_S;
+    BXIERR_CHAIN(err, new);
+    return err;
 }
 
 
@@ -545,13 +560,8 @@ bxierr_p bxizmq_msg_snd(zmq_msg_t * const zmsg,
         const int n = zmq_msg_send(zmsg, zocket, flags);
         if (n >= 0) {
             if (0 == retries) return BXIERR_OK;
-            bxierr_p new = bxierr_new(BXIZMQ_RETRIES_MAX_ERR,
-                                      (void *) retries,
-                                      NULL,
-                                      NULL,
-                                      NULL,
-                                      "Sending a message "
-                                      "needed %zu retries", retries);
+            // Expected under back-pressure: no need for a backtrace
+            bxierr_p new = &RETRIES_MAX_ERR_S;
             BXIERR_CHAIN(current, new);
             return current;
         }
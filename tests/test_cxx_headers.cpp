@@ -0,0 +1,38 @@
+/* -*- coding: utf-8 -*-
+ ###############################################################################
+ # Author: Pierre Vigneras <pierre.vigneras@bull.net>
+ # Created on: May 21, 2013
+ # Contributors:
+ ###############################################################################
+ # Copyright (C) 2012  Bull S. A. S.  -  All rights reserved
+ # Bull, Rue Jean Jaures, B.P.68, 78340, Les Clayes-sous-Bois
+ # This is not Free or Open Source software.
+ # Please contact Bull S. A. S. for details about its license.
+ ###############################################################################
+ */
+
+#include <cstring>
+
+// Public headers must remain usable from C++
+extern "C" {
+#include "bxi/base/mem.h"
+#include "bxi/base/str.h"
+#include "bxi/base/err.h"
+#include "bxi/base/time.h"
+#include "bxi/base/zmq.h"
+#include "bxi/base/log.h"
+
+#include "bxi/base/log/console_handler.h"
+#include "bxi/base/log/file_handler.h"
+#include "bxi/base/log/binfile.h"
+#include "bxi/base/log/null_handler.h"
+#include "bxi/base/log/syslog_handler.h"
+#include "bxi/base/log/remote_handler.h"
+#include "bxi/base/log/remote_receiver.h"
+}
+
+SET_LOGGER(CXX_LOGGER, "test.bxibase.cxx");
+
+int main(void) {
+    return (0 == strcmp(CXX_LOGGER->name, "test.bxibase.cxx")) ? 0 : 1;
+}
@@ -13,6 +13,7 @@
 
 #include <stdlib.h>
 #include <time.h>
+#include <string.h>
 
 #include <CUnit/Basic.h>
 
@@ -146,3 +147,71 @@ void test_bxierr_chain() {
     bxierr_destroy(&err);
 }
 
+
+void test_bxierr_static() {
+    static bxierr_s STATIC_ERR_S = BXIERR_STATIC_INIT(EAGAIN, "Static error");
+
+    // Destroying a preallocated error does nothing
+    bxierr_p err = &STATIC_ERR_S;
+    bxierr_destroy(&err);
+    CU_ASSERT_PTR_NULL(err);
+    CU_ASSERT_EQUAL(STATIC_ERR_S.code, EAGAIN);
+    CU_ASSERT_STRING_EQUAL(STATIC_ERR_S.msg, "Static error");
+
+    // Chaining never modifies it, even with itself
+    bxierr_p err2;
+    err2 = &STATIC_ERR_S;
+    BXIERR_CHAIN(err, err2);
+    CU_ASSERT_PTR_EQUAL(err, &STATIC_ERR_S);
+    err2 = &STATIC_ERR_S;
+    BXIERR_CHAIN(err, err2);
+    err2 = bxierr_gen("Dynamic error");
+    BXIERR_CHAIN(err, err2);
+    err2 = &STATIC_ERR_S;
+    BXIERR_CHAIN(err, err2);
+
+    CU_ASSERT_PTR_NULL(STATIC_ERR_S.cause);
+    CU_ASSERT_PTR_NULL(STATIC_ERR_S.last_cause);
+    CU_ASSERT_EQUAL_FATAL(bxierr_get_depth(err), 4);
+    CU_ASSERT_EQUAL(err->code, EAGAIN);
+    CU_ASSERT_FALSE(err->preallocated);
+    CU_ASSERT_EQUAL(err->cause->code, BXIERR_GENERIC_CODE);
+    CU_ASSERT_EQUAL(err->cause->cause->code, EAGAIN);
+    CU_ASSERT_EQUAL(err->cause->cause->cause->code, EAGAIN);
+
+    bxierr_p cause = bxierr_new(42, NULL, NULL, NULL, &STATIC_ERR_S, "With a static cause");
+    CU_ASSERT_PTR_NOT_EQUAL(cause->cause, &STATIC_ERR_S);
+    BXIERR_CHAIN(err, cause);
+    CU_ASSERT_EQUAL(bxierr_get_depth(err), 6);
+    CU_ASSERT_PTR_NULL(STATIC_ERR_S.cause);
+
+    bxierr_destroy(&err);
+}
+
+void test_bxierr_backtrace() {
+    bxierr_p err = bxierr_gen("An error with a lazy backtrace");
+
+    // Only raw addresses are recorded at creation
+    CU_ASSERT_PTR_NULL(err->backtrace);
+    CU_ASSERT_TRUE(0 < err->addresses_nb);
+
+    size_t len;
+    char * bt = bxierr_get_backtrace(err, &len);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(bt);
+    CU_ASSERT_EQUAL(len, strlen(bt) + 1);
+    CU_ASSERT_PTR_NOT_NULL(strstr(bt, "Backtrace of tid"));
+    // Computed once
+    CU_ASSERT_PTR_EQUAL(bxierr_get_backtrace(err, NULL), bt);
+
+    // Same site: symbols come from the cache, the result is the same
+    bxierr_p err2 = bxierr_gen("An error with a lazy backtrace");
+    char * str = bxierr_str(err);
+    char * str2 = bxierr_str(err2);
+    CU_ASSERT_PTR_NOT_NULL(strstr(str, "Backtrace end"));
+    CU_ASSERT_PTR_NOT_NULL(strstr(str2, "Backtrace end"));
+
+    BXIFREE(str);
+    BXIFREE(str2);
+    bxierr_destroy(&err);
+    bxierr_destroy(&err2);
+}
@@ -11,6 +11,9 @@
  ###############################################################################
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -21,6 +24,7 @@
 #include <sysexits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <wait.h>
@@ -29,6 +33,11 @@
 #include <signal.h>
 #include <syslog.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <termios.h>
 
 #include <CUnit/Basic.h>
 
@@ -38,10 +47,15 @@
 
 #include "bxi/base/log/console_handler.h"
 #include "bxi/base/log/file_handler.h"
+#include "bxi/base/log/binfile.h"
 #include "bxi/base/log/syslog_handler.h"
 #include "bxi/base/log/remote_handler.h"
 #include "bxi/base/log/null_handler.h"
 
+#include "log/config_impl.h"
+#include "log/log_impl.h"
+#include "log/tsd_impl.h"
+
 SET_LOGGER(TEST_LOGGER, "test.bxibase.log");
 SET_LOGGER(BAD_LOGGER1, "test.bad.logger");
 SET_LOGGER(BAD_LOGGER2, "test.bad.logger");
@@ -532,6 +546,41 @@ void test_registry(void) {
 }
 
 
+void test_registry_many_loggers(void) {
+    const size_t loggers_nb = 10000;
+    bxilog_logger_p * before;
+    const size_t before_nb = bxilog_registry_getall(&before);
+    BXIFREE(before);
+
+    bxilog_logger_p * loggers = bximem_calloc(loggers_nb * sizeof(*loggers));
+    for (size_t i = 0; i < loggers_nb; i++) {
+        char * name = bxistr_new("test.registry.many.%zu", i);
+        bxierr_p err = bxilog_registry_get(name, &loggers[i]);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        CU_ASSERT_STRING_EQUAL(loggers[i]->name, name);
+        BXIFREE(name);
+    }
+    // The same instances are found again
+    for (size_t i = 0; i < loggers_nb; i++) {
+        char * name = bxistr_new("test.registry.many.%zu", i);
+        bxilog_logger_p logger;
+        bxierr_p err = bxilog_registry_get(name, &logger);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        CU_ASSERT_PTR_EQUAL(logger, loggers[i]);
+        BXIFREE(name);
+    }
+
+    // All loggers are returned, sorted by name
+    bxilog_logger_p * all;
+    const size_t all_nb = bxilog_registry_getall(&all);
+    CU_ASSERT_EQUAL(all_nb, before_nb + loggers_nb);
+    for (size_t i = 1; i < all_nb; i++) {
+        CU_ASSERT_TRUE(0 >= strcmp(all[i - 1]->name, all[i]->name));
+    }
+    BXIFREE(all);
+    BXIFREE(loggers);
+}
+
 void test_filters_parser(void) {
     bxilog_registry_reset();
 
@@ -992,6 +1041,1640 @@ void test_logger_threads(void) {
 
 }
 
+void test_logger_ring_transport(void) {
+    // Same as test_logger_threads() but using the ring transport:
+    // each thread logs into its own logger, the file handler must see all of them
+    size_t threads_nb = 3;
+    bxilog_logger_p loggers[threads_nb];
+    size_t logs_nb[threads_nb];
+
+    char * filename = strdup("/tmp/test_logger_ring.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = BXILOG_TRANSPORT_RING;
+    config->ring_size = 16; // Small enough to exercise the full ring case
+    bxilog_filters_p filters = bxilog_filters_new();
+    for (size_t i = 0; i < threads_nb; i++) {
+        char * logger_name = bxistr_new("test.ring-%zu", i);
+        bxierr_p err = bxilog_registry_get(logger_name, &loggers[i]);
+        bxierr_abort_ifko(err);
+        bxilog_filters_add(&filters, logger_name, BXILOG_ALL);
+        BXIFREE(logger_name);
+    }
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, FULLFILENAME, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    pthread_t threads[threads_nb];
+    for (size_t i = 0; i < threads_nb; i++) {
+        int rc = pthread_create(&threads[i], NULL, logging_thread, loggers[i]);
+        CU_ASSERT_TRUE_FATAL(0 == rc);
+    }
+    size_t total_log_nb = 0;
+    for (size_t i = 0; i < threads_nb; i++) {
+        int rc = pthread_join(threads[i], (void**)&logs_nb[i]);
+        CU_ASSERT_TRUE_FATAL(0 == rc);
+        total_log_nb += logs_nb[i];
+    }
+
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    size_t lines_nb = 0;
+    while(true) {
+        char c;
+        ssize_t n = read(fd, &c, 1);
+        if (0 >= n) break;
+        if ('\n' == c) lines_nb++;
+    }
+    OUT(TEST_LOGGER, "Number of lines expected in file %s: %zu, found: %zu",
+        filename, total_log_nb, lines_nb);
+    CU_ASSERT_TRUE_FATAL(total_log_nb == lines_nb);
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
+void test_logger_deferred_formatting(void) {
+    char * filename = strdup("/tmp/test_logger_deferred.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->deferred_formatting = true;
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.deferred", &logger);
+    bxierr_abort_ifko(err);
+
+    // Strings must be copied at logging time
+    char str[] = "before";
+    OUT(logger, "Deferred: %d|%5.2f|%*d|%-4s|%.3s|%zu|%s|%%|%p",
+        -42, 3.14159, 4, 7, "ab", "abcdef", (size_t) 123, str, (void *) 0x1234);
+    strcpy(str, "after!");
+    // Not supported by the encoder, formatted immediately
+    errno = EINVAL;
+    OUT(logger, "Eager: %m");
+    errno = 0;
+
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    char content[4096];
+    ssize_t n = read(fd, content, sizeof(content) - 1);
+    CU_ASSERT_TRUE_FATAL(0 < n);
+    content[n] = '\0';
+    char expected[256];
+    snprintf(expected, sizeof(expected), "Deferred: %d|%5.2f|%*d|%-4s|%.3s|%zu|%s|%%|%p",
+             -42, 3.14159, 4, 7, "ab", "abcdef", (size_t) 123, "before", (void *) 0x1234);
+    CU_ASSERT_PTR_NOT_NULL(strstr(content, expected));
+    snprintf(expected, sizeof(expected), "Eager: %s", strerror(EINVAL));
+    CU_ASSERT_PTR_NOT_NULL(strstr(content, expected));
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
+void test_logger_call_site(void) {
+    char * filename = strdup("/tmp/test_logger_site.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.site", &logger);
+    bxierr_abort_ifko(err);
+
+    static bxilog_site_s site = BXILOG_SITE_INIT(BXILOG_OUTPUT);
+    CU_ASSERT_EQUAL(site.id, 0);
+    for (size_t i = 0; i < 3; i++) {
+        err = bxilog_logger_log_site_nolevelcheck(logger, &site, "Site log %zu", i);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    }
+
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Resolved by the handler on the first log
+    CU_ASSERT_NOT_EQUAL(site.id, 0);
+    CU_ASSERT_STRING_EQUAL(site.filename, "test_logger.c");
+
+    char content[4096];
+    ssize_t n = read(fd, content, sizeof(content) - 1);
+    CU_ASSERT_TRUE_FATAL(0 < n);
+    content[n] = '\0';
+    char expected[256];
+    for (size_t i = 0; i < 3; i++) {
+        snprintf(expected, sizeof(expected), "|test_logger.c:%d@%s|test.site|Site log %zu",
+                 site.line, __func__, i);
+        CU_ASSERT_PTR_NOT_NULL(strstr(content, expected));
+    }
+
+    close(fd);
+    unlink(filename);
+    BXIFREE(filename);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
+void test_logger_file_io(void) {
+    char * filename = strdup("/tmp/test_logger_io.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.io", &logger);
+    bxierr_abort_ifko(err);
+
+    // Large lines do not fit in the file handler buffer: they must be written
+    // in order with the buffered ones
+    const size_t large_size = 256 * 1024;
+    char * large = bximem_calloc(large_size);
+    memset(large, 'x', large_size - 1);
+
+    const size_t logs_nb = 5000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        if (0 == i % 500) {
+            OUT(logger, "IO log %zu %s", i, large);
+        } else {
+            OUT(logger, "IO log %zu", i);
+        }
+    }
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    FILE * file = fdopen(fd, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char * line = NULL;
+    size_t line_size = 0;
+    size_t expected = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        char * msg = strstr(line, "|test.io|IO log ");
+        if (NULL == msg) continue;
+        size_t i = strtoul(msg + ARRAYLEN("|test.io|IO log ") - 1, NULL, 10);
+        CU_ASSERT_EQUAL(i, expected);
+        if (0 == i % 500) CU_ASSERT_EQUAL(strlen(strchr(msg, 'x')), large_size);
+        expected++;
+    }
+    CU_ASSERT_EQUAL(expected, logs_nb);
+
+    BXIFREE(line);
+    BXIFREE(large);
+    fclose(file);
+    unlink(filename);
+    BXIFREE(filename);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
+void test_logger_binary_file(void) {
+    char * filename = strdup("/tmp/test_logger_bin.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER_BINARY,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.binary", &logger);
+    bxierr_abort_ifko(err);
+
+    const size_t logs_nb = 1000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        WARNING(logger, "Binary log %zu\nsecond line", i);
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    bxilog_binfile_p reader;
+    err = bxilog_binfile_open(filename, &reader);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(reader);
+
+    bxilog_binfile_entry_record_s record;
+    size_t found = 0;
+    char expected[64];
+    while (bxilog_binfile_next(reader, &record)) {
+        if (0 != strncmp("test.binary", record.logname, record.logname_len)) continue;
+        CU_ASSERT_EQUAL(record.level, BXILOG_WARNING);
+        CU_ASSERT_EQUAL(record.pid, getpid());
+        CU_ASSERT_EQUAL(record.funcname_len, strlen(__func__));
+        CU_ASSERT_EQUAL(0, strncmp(__func__, record.funcname, record.funcname_len));
+        int len = snprintf(expected, sizeof(expected),
+                           "Binary log %zu\nsecond line", found);
+        CU_ASSERT_EQUAL(record.logmsg_len, (size_t) len);
+        CU_ASSERT_EQUAL(0, memcmp(expected, record.logmsg, record.logmsg_len));
+        found++;
+    }
+    CU_ASSERT_EQUAL(found, logs_nb);
+    CU_ASSERT_EQUAL(bxilog_binfile_corrupted_nb(reader), 0);
+
+    err = bxilog_binfile_close(&reader);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_file_mmap(void) {
+    char * filename = strdup("/tmp/test_logger_mmap.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_file_handler_set_io(config->handlers_params[config->handlers_nb - 1],
+                               BXILOG_FILE_HANDLER_IO_MMAP,
+                               BXILOG_FILE_HANDLER_MSYNC_ASYNC);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.mmap", &logger);
+    bxierr_abort_ifko(err);
+
+    // Enough logs to use several segments, large lines included
+    const size_t large_size = 256 * 1024;
+    char * large = bximem_calloc(large_size);
+    memset(large, 'x', large_size - 1);
+
+    const size_t logs_nb = 20000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        if (0 == i % 2000) {
+            OUT(logger, "Mmap log %zu %s", i, large);
+        } else {
+            OUT(logger, "Mmap log %zu", i);
+        }
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    FILE * file = fdopen(fd, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char * line = NULL;
+    size_t line_size = 0;
+    size_t expected = 0;
+    ssize_t n;
+    off_t size = 0;
+    while (-1 != (n = getline(&line, &line_size, file))) {
+        // The preallocated tail must have been truncated
+        CU_ASSERT_EQUAL(line[n - 1], '\n');
+        size += n;
+        char * msg = strstr(line, "|test.mmap|Mmap log ");
+        if (NULL == msg) continue;
+        size_t i = strtoul(msg + ARRAYLEN("|test.mmap|Mmap log ") - 1, NULL, 10);
+        CU_ASSERT_EQUAL(i, expected);
+        if (0 == i % 2000) CU_ASSERT_EQUAL(strlen(strchr(msg, 'x')), large_size);
+        expected++;
+    }
+    CU_ASSERT_EQUAL(expected, logs_nb);
+
+    struct stat st;
+    int rc = fstat(fd, &st);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    CU_ASSERT_EQUAL(st.st_size, size);
+
+    BXIFREE(line);
+    BXIFREE(large);
+    fclose(file);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_file_mmap_fallback(void) {
+    char * filename = strdup("/tmp/test_logger_mmap_fallback.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    // Not a multiple of the page size
+    const size_t existing_nb = 1000;
+    for (size_t i = 0; i < existing_nb; i++) {
+        char * line = bxistr_new("Existing line %zu\n", i);
+        ssize_t n = write(fd, line, strlen(line));
+        bxiassert(n == (ssize_t) strlen(line));
+        BXIFREE(line);
+    }
+    struct stat st;
+    int rc = fstat(fd, &st);
+    bxiassert(0 == rc);
+    const off_t existing_size = st.st_size;
+
+    // Segments can't be preallocated: mapping the file fails
+    struct rlimit old_limit, limit;
+    rc = getrlimit(RLIMIT_FSIZE, &old_limit);
+    bxiassert(0 == rc);
+    limit = old_limit;
+    limit.rlim_cur = (rlim_t) existing_size + 64 * 1024;
+    rc = setrlimit(RLIMIT_FSIZE, &limit);
+    bxiassert(0 == rc);
+    void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_file_handler_set_io(config->handlers_params[config->handlers_nb - 1],
+                               BXILOG_FILE_HANDLER_IO_MMAP,
+                               BXILOG_FILE_HANDLER_MSYNC_ASYNC);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    const size_t logs_nb = 100;
+    for (size_t i = 0; i < logs_nb; i++) {
+        OUT(TEST_LOGGER, "Fallback log %zu", i);
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    signal(SIGXFSZ, old_handler);
+    rc = setrlimit(RLIMIT_FSIZE, &old_limit);
+    bxiassert(0 == rc);
+
+    // Existing lines are kept, new logs follow them
+    FILE * file = fdopen(fd, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    rewind(file);
+    char * line = NULL;
+    size_t line_size = 0;
+    size_t existing = 0, logs = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        if (existing < existing_nb) {
+            char * expected = bxistr_new("Existing line %zu\n", existing);
+            CU_ASSERT_STRING_EQUAL(line, expected);
+            BXIFREE(expected);
+            existing++;
+            continue;
+        }
+        if (NULL != strstr(line, "|Fallback log ")) logs++;
+    }
+    CU_ASSERT_EQUAL(existing, existing_nb);
+    CU_ASSERT_EQUAL(logs, logs_nb);
+
+    BXIFREE(line);
+    fclose(file);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_file_rotation(void) {
+    char * template = strdup("/tmp/test_logger_rotation.XXXXXX");
+    char * dirname = mkdtemp(template);
+    bxiassert(NULL != dirname);
+    char * filename = bxistr_new("%s/rotation.bxilog", dirname);
+
+    const size_t max_size = 64 * 1024;
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_file_handler_set_rotation(config->handlers_params[config->handlers_nb - 1],
+                                     max_size, 0, false);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.rotation", &logger);
+    bxierr_abort_ifko(err);
+
+    const size_t logs_nb = 5000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        OUT(logger, "Rotation log %zu", i);
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Every log must be in exactly one of the files
+    struct dirent ** entries;
+    int entries_nb = scandir(dirname, &entries, NULL, alphasort);
+    CU_ASSERT_TRUE_FATAL(0 < entries_nb);
+    size_t files_nb = 0;
+    size_t found = 0;
+    char * line = NULL;
+    size_t line_size = 0;
+    for (int i = 0; i < entries_nb; i++) {
+        if ('.' == entries[i]->d_name[0]) {
+            BXIFREE(entries[i]);
+            continue;
+        }
+        char * path = bxistr_new("%s/%s", dirname, entries[i]->d_name);
+        struct stat st;
+        int rc = stat(path, &st);
+        CU_ASSERT_EQUAL_FATAL(rc, 0);
+        // Rotated files hold at least max_size bytes
+        if (0 != strcmp(path, filename)) CU_ASSERT_TRUE((size_t) st.st_size >= max_size);
+        FILE * file = fopen(path, "r");
+        CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+        while (-1 != getline(&line, &line_size, file)) {
+            if (NULL != strstr(line, "|test.rotation|Rotation log ")) found++;
+        }
+        fclose(file);
+        unlink(path);
+        BXIFREE(path);
+        BXIFREE(entries[i]);
+        files_nb++;
+    }
+    BXIFREE(entries);
+    BXIFREE(line);
+    CU_ASSERT_TRUE(files_nb > 1);
+    CU_ASSERT_EQUAL(found, logs_nb);
+
+    int rc = rmdir(dirname);
+    CU_ASSERT_EQUAL(rc, 0);
+    BXIFREE(filename);
+    BXIFREE(template);
+}
+
+void test_logger_file_compressed(void) {
+    char * filename = strdup("/tmp/test_logger_zbin.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER_BINARY,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_file_handler_set_compression(config->handlers_params[config->handlers_nb - 1],
+                                        6);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.compressed", &logger);
+    bxierr_abort_ifko(err);
+
+    const size_t logs_nb = 10000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        WARNING(logger, "Compressed log %zu", i);
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    bxilog_binfile_p reader;
+    err = bxilog_binfile_open(filename, &reader);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(reader);
+
+    bxilog_binfile_entry_record_s record;
+    size_t found = 0;
+    char expected[64];
+    while (bxilog_binfile_next(reader, &record)) {
+        if (0 != strncmp("test.compressed", record.logname, record.logname_len)) continue;
+        int len = snprintf(expected, sizeof(expected), "Compressed log %zu", found);
+        CU_ASSERT_EQUAL(record.logmsg_len, (size_t) len);
+        CU_ASSERT_EQUAL(0, memcmp(expected, record.logmsg, record.logmsg_len));
+        found++;
+    }
+    CU_ASSERT_EQUAL(found, logs_nb);
+    CU_ASSERT_EQUAL(bxilog_binfile_corrupted_nb(reader), 0);
+
+    err = bxilog_binfile_close(&reader);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_file_durability(void) {
+    char * filename = strdup("/tmp/test_logger_sync.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_file_handler_set_durability(config->handlers_params[config->handlers_nb - 1],
+                                       BXILOG_FILE_HANDLER_DURABILITY_PERIODIC,
+                                       100, BXILOG_ERROR);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.sync", &logger);
+    bxierr_abort_ifko(err);
+
+    // Important records are synced as they come, others with the flush
+    const size_t logs_nb = 5000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        if (0 == i % 100) {
+            ERROR(logger, "Sync log %zu", i);
+        } else {
+            DEBUG(logger, "Sync log %zu", i);
+        }
+    }
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    FILE * file = fdopen(fd, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char * line = NULL;
+    size_t line_size = 0;
+    size_t expected = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        char * msg = strstr(line, "|test.sync|Sync log ");
+        if (NULL == msg) continue;
+        size_t i = strtoul(msg + ARRAYLEN("|test.sync|Sync log ") - 1, NULL, 10);
+        CU_ASSERT_EQUAL(i, expected);
+        CU_ASSERT_EQUAL(line[0], (0 == i % 100) ? 'E' : 'D');
+        expected++;
+    }
+    CU_ASSERT_EQUAL(expected, logs_nb);
+
+    BXIFREE(line);
+    fclose(file);
+    unlink(filename);
+    BXIFREE(filename);
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
+static size_t _count_lines(const char * filename, const char * pattern) {
+    FILE * file = fopen(filename, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char * line = NULL;
+    size_t line_size = 0;
+    size_t result = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        if (NULL != strstr(line, pattern)) result++;
+    }
+    BXIFREE(line);
+    fclose(file);
+
+    return result;
+}
+
+void test_logger_file_routes(void) {
+    char * filename = strdup("/tmp/test_logger_routes.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+    char * errors_filename = bxistr_new("%s.errors", filename);
+    char * sub_filename = bxistr_new("%s.sub", filename);
+
+    bxilog_filters_p errors = bxilog_filters_new();
+    bxilog_filters_add(&errors, "", BXILOG_ERROR);
+
+    bxilog_filters_p sub = bxilog_filters_new();
+    bxilog_filters_add(&sub, "", BXILOG_OFF);
+    bxilog_filters_add(&sub, "test.routes.sub", BXILOG_ALL);
+
+    // The subsystem logs go to their own file only
+    bxilog_filters_p main = bxilog_filters_new();
+    bxilog_filters_add(&main, "", BXILOG_ALL);
+    bxilog_filters_add(&main, "test.routes.sub", BXILOG_OFF);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_handler_param_p param = config->handlers_params[config->handlers_nb - 1];
+    bxilog_file_handler_add_route(param, errors, errors_filename);
+    bxilog_file_handler_add_route(param, sub, sub_filename);
+    bxilog_file_handler_set_main_filters(param, main);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p main_logger, sub_logger;
+    err = bxilog_registry_get("test.routes.main", &main_logger);
+    bxierr_abort_ifko(err);
+    err = bxilog_registry_get("test.routes.sub", &sub_logger);
+    bxierr_abort_ifko(err);
+
+    const size_t logs_nb = 1000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        if (0 == i % 10) {
+            ERROR(main_logger, "Route log %zu", i);
+        } else {
+            DEBUG(main_logger, "Route log %zu", i);
+        }
+        DEBUG(sub_logger, "Route log %zu", i);
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Each file gets its own part of the same records
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.routes.main|Route log "), logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.routes.sub|"), 0);
+    CU_ASSERT_EQUAL(_count_lines(errors_filename, "|test.routes.main|Route log "),
+                    logs_nb / 10);
+    CU_ASSERT_EQUAL(_count_lines(errors_filename, "|test.routes.sub|"), 0);
+    CU_ASSERT_EQUAL(_count_lines(sub_filename, "|test.routes.sub|Route log "), logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(sub_filename, "|test.routes.main|"), 0);
+
+    unlink(filename);
+    unlink(errors_filename);
+    unlink(sub_filename);
+    BXIFREE(filename);
+    BXIFREE(errors_filename);
+    BXIFREE(sub_filename);
+}
+
+// The printf() format of the file handler before it was hand-rolled
+#ifdef __linux__
+static const char OLD_LOG_FMT[] = "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u=%0*" PRIxPTR ":%s|%s:%d@%s|%s|";
+#else
+static const char OLD_LOG_FMT[] = "%c|%0*d%0*d%0*dT%0*d%0*d%0*d.%0*ld|%0*u.%0*u:%s|%s:%d@%s|%s|";
+#endif
+
+static char * _old_format(bxilog_record_p record,
+                          const char * filename, const char * funcname,
+                          const char * loggername, const char * logmsg) {
+    const char level_chars[] = { '-', 'P', 'A', 'C', 'E', 'W', 'N', 'O',
+                                 'I', 'D', 'F', 'T', 'L'};
+    struct tm dummy;
+    struct tm * now = localtime_r(&record->detail_time.tv_sec, &dummy);
+    bxiassert(NULL != now);
+
+    char * result = strdup("");
+    const char * line = logmsg;
+    while (true) {
+        const char * eol = strchr(line, '\n');
+        const size_t line_len = (NULL == eol) ? strlen(line) : (size_t) (eol - line);
+        char * prefix = bxistr_new(OLD_LOG_FMT,
+                                   level_chars[record->level],
+                                   4, now->tm_year + 1900,
+                                   2, now->tm_mon + 1,
+                                   2, now->tm_mday,
+                                   2, now->tm_hour,
+                                   2, now->tm_min,
+                                   2, now->tm_sec,
+                                   9, record->detail_time.tv_nsec,
+                                   5, (unsigned) record->pid,
+#ifdef __linux__
+                                   5, (unsigned) record->tid,
+#endif
+                                   5, record->thread_rank,
+                                   PROGNAME,
+                                   filename,
+                                   record->line_nb,
+                                   funcname,
+                                   loggername);
+        char * tmp = bxistr_new("%s%s%.*s\n", result, prefix, (int) line_len, line);
+        BXIFREE(prefix);
+        BXIFREE(result);
+        result = tmp;
+        if (NULL == eol) break;
+        line = eol + 1;
+    }
+    return result;
+}
+
+void test_logger_file_format(void) {
+    char * filename = strdup("/tmp/test_logger_format.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    // The handler is driven directly to control every field of the records
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_handler_param_p param = config->handlers_params[0];
+    bxierr_p err = BXILOG_FILE_HANDLER->init(param);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    char record_filename[] = "format.c";
+    char funcname[] = "format_func";
+    char loggername[] = "test.format";
+    struct {
+        pid_t pid;
+        pid_t tid;
+        uintptr_t thread_rank;
+        int line_nb;
+        time_t sec;
+        long nsec;
+        char * logmsg;
+    } cases[] = {
+        {1234, 5678, 0x1f, 42, 1500000000, 123456789, "Single line"},
+        {1234567, 7654321, 0xabcdef12, -42, 1500000000, 5,
+         "First line\nSecond line\n\nFourth line"},
+        {0, 0, 0, 0, 1500086399, 0, "Trailing newline\n"},
+        {INT_MAX, INT_MAX, UINTPTR_MAX, INT_MIN, 1500086400, 999999999, "Extremes"},
+    };
+
+    char * expected = strdup("");
+    for (size_t i = 0; i < ARRAYLEN(cases); i++) {
+        bxilog_record_s record;
+        memset(&record, 0, sizeof(record));
+        record.level = (bxilog_level_e) (BXILOG_PANIC + i);
+        record.detail_time.tv_sec = cases[i].sec;
+        record.detail_time.tv_nsec = cases[i].nsec;
+        record.pid = cases[i].pid;
+#ifdef __linux__
+        record.tid = cases[i].tid;
+#endif
+        record.thread_rank = cases[i].thread_rank;
+        record.line_nb = cases[i].line_nb;
+        record.filename_len = ARRAYLEN(record_filename);
+        record.funcname_len = ARRAYLEN(funcname);
+        record.logname_len = ARRAYLEN(loggername);
+        record.logmsg_len = strlen(cases[i].logmsg) + 1;
+
+        char * logmsg = strdup(cases[i].logmsg);
+        err = BXILOG_FILE_HANDLER->process_log(&record, record_filename, funcname,
+                                               loggername, logmsg, param);
+        CU_ASSERT_TRUE(bxierr_isok(err));
+        BXIFREE(logmsg);
+
+        char * old = _old_format(&record, record_filename, funcname,
+                                 loggername, cases[i].logmsg);
+        char * tmp = bxistr_new("%s%s", expected, old);
+        BXIFREE(old);
+        BXIFREE(expected);
+        expected = tmp;
+    }
+    err = BXILOG_FILE_HANDLER->process_exit(param);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    err = bxilog__config_destroy(&config);
+    CU_ASSERT_TRUE(bxierr_isok(err));
+
+    // Internal logs of the handler, if any, are skipped
+    FILE * file = fopen(filename, "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    char * actual = strdup("");
+    char * line = NULL;
+    size_t line_size = 0;
+    while (-1 != getline(&line, &line_size, file)) {
+        if (NULL == strstr(line, "@format_func|test.format|")) continue;
+        char * tmp = bxistr_new("%s%s", actual, line);
+        BXIFREE(actual);
+        actual = tmp;
+    }
+    BXIFREE(line);
+    fclose(file);
+
+    CU_ASSERT_STRING_EQUAL(actual, expected);
+
+    BXIFREE(actual);
+    BXIFREE(expected);
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+// Give the console handler a batch of records, all from the same logger
+static bxierr_p _console_batch(bxilog_handler_param_p param, char * loggername,
+                               size_t n, bxilog_level_e levels[n], char * msgs[n]) {
+    char filename[] = "console.c";
+    char funcname[] = "console_func";
+    bxilog_record_s records[n];
+    bxilog_batch_record_s batch[n];
+    for (size_t i = 0; i < n; i++) {
+        memset(&records[i], 0, sizeof(records[i]));
+        records[i].level = levels[i];
+        records[i].line_nb = (int) i;
+        records[i].filename_len = ARRAYLEN(filename);
+        records[i].funcname_len = ARRAYLEN(funcname);
+        records[i].logname_len = strlen(loggername) + 1;
+        records[i].logmsg_len = strlen(msgs[i]) + 1;
+        batch[i].record = &records[i];
+        batch[i].filename = filename;
+        batch[i].funcname = funcname;
+        batch[i].loggername = loggername;
+        batch[i].logmsg = msgs[i];
+    }
+    return BXILOG_CONSOLE_HANDLER->process_log_batch(batch, n, param);
+}
+
+// Run the console handler on the given batch, with the standard outputs redirected
+static void _console_run(int out_fd, int err_fd, char * loggername,
+                         size_t n, bxilog_level_e levels[n], char * msgs[n]) {
+    static const char * colors[] = {"<->", "<P>", "<A>", "<C>", "<E>", "<W>", "<N>",
+                                    "<O>", "<I>", "<D>", "<F>", "<T>", "<L>"};
+    int saved_out = dup(STDOUT_FILENO);
+    int saved_err = dup(STDERR_FILENO);
+    bxiassert(0 <= saved_out && 0 <= saved_err);
+    int rc = dup2(out_fd, STDOUT_FILENO);
+    bxiassert(STDOUT_FILENO == rc);
+    rc = dup2(err_fd, STDERR_FILENO);
+    bxiassert(STDERR_FILENO == rc);
+
+    // Colors are only used on a terminal
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_CONSOLE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              BXILOG_WARNING, 8, colors);
+    bxilog_handler_param_p param = config->handlers_params[0];
+    bxierr_p err = BXILOG_CONSOLE_HANDLER->init(param);
+    bxierr_abort_ifko(err);
+    err = _console_batch(param, loggername, n, levels, msgs);
+    bxierr_abort_ifko(err);
+    err = BXILOG_CONSOLE_HANDLER->process_exit(param);
+    bxierr_abort_ifko(err);
+    err = bxilog__config_destroy(&config);
+    bxierr_abort_ifko(err);
+
+    rc = dup2(saved_out, STDOUT_FILENO);
+    bxiassert(STDOUT_FILENO == rc);
+    rc = dup2(saved_err, STDERR_FILENO);
+    bxiassert(STDERR_FILENO == rc);
+    close(saved_out);
+    close(saved_err);
+}
+
+// Read what is available on fd, until the end of file or a short timeout
+static char * _read_available(int fd) {
+    char * result = bximem_calloc(1);
+    size_t len = 0;
+    char buf[4096];
+    struct pollfd pfd = {.fd = fd, .events = POLLIN};
+    while (0 < poll(&pfd, 1, 100)) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (0 >= n) break;
+        result = bximem_realloc(result, len + 1, len + (size_t) n + 1);
+        memcpy(result + len, buf, (size_t) n);
+        len += (size_t) n;
+    }
+    return result;
+}
+
+void test_logger_console(void) {
+    void (*old_handler)(int) = signal(SIGPIPE, SIG_IGN);
+    fflush(stdout);
+    fflush(stderr);
+
+    // Both outputs on the same pipe: lines keep their order across them
+    int fds[2];
+    int rc = pipe(fds);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    bxilog_level_e levels[] = {BXILOG_OUTPUT, BXILOG_INFO, BXILOG_WARNING, BXILOG_DEBUG};
+    char * msgs[] = {"Out", "Info 1\nInfo 2", "Warning", "Debug"};
+    _console_run(fds[1], fds[1], "short", ARRAYLEN(levels), levels, msgs);
+    close(fds[1]);
+    char * actual = _read_available(fds[0]);
+    close(fds[0]);
+    CU_ASSERT_STRING_EQUAL(actual,
+                           "Out\n"
+                           "[I] short    Info 1\n"
+                           "[I] short    Info 2\n"
+                           "[W] short    Warning\n"
+                           "[D] short    Debug\n");
+    BXIFREE(actual);
+
+    // Logger names are truncated to their width
+    rc = pipe(fds);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    bxilog_level_e long_levels[] = {BXILOG_INFO};
+    char * long_msgs[] = {"Long"};
+    _console_run(fds[1], fds[1], "a.very.long.name", 1, long_levels, long_msgs);
+    close(fds[1]);
+    actual = _read_available(fds[0]);
+    close(fds[0]);
+    CU_ASSERT_STRING_EQUAL(actual, "[I] a.very.l Long\n");
+    BXIFREE(actual);
+
+    // Standard output on a terminal: colored, unlike standard error on a pipe
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    CU_ASSERT_TRUE_FATAL(0 <= master);
+    rc = grantpt(master);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    rc = unlockpt(master);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    CU_ASSERT_TRUE_FATAL(0 <= slave);
+    struct termios tio;
+    rc = tcgetattr(slave, &tio);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    tio.c_oflag &= (tcflag_t) ~OPOST; // No "\r\n"
+    rc = tcsetattr(slave, TCSANOW, &tio);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    rc = pipe(fds);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    _console_run(slave, fds[1], "short", ARRAYLEN(levels), levels, msgs);
+    close(fds[1]);
+    actual = _read_available(master);
+    CU_ASSERT_STRING_EQUAL(actual,
+                           "<O>Out\033[0m\n"
+                           "<I>[I] short    Info 1\033[0m\n"
+                           "<I>[I] short    Info 2\033[0m\n"
+                           "<D>[D] short    Debug\033[0m\n");
+    BXIFREE(actual);
+    actual = _read_available(fds[0]);
+    CU_ASSERT_STRING_EQUAL(actual, "[W] short    Warning\n");
+    BXIFREE(actual);
+    close(fds[0]);
+    close(slave);
+    close(master);
+
+    // Lines that cannot be written are counted, oversized ones included
+    int out_fds[2];
+    rc = pipe(out_fds);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    close(out_fds[0]);
+    rc = pipe(fds);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    const size_t oversized_len = 100 * 1024;
+    char * oversized = bximem_calloc(oversized_len + 1);
+    memset(oversized, 'x', oversized_len);
+    bxilog_level_e lost_levels[] = {BXILOG_OUTPUT, BXILOG_OUTPUT, BXILOG_OUTPUT};
+    char * lost_msgs[] = {"Lost 1", "Lost 2", oversized};
+    _console_run(out_fds[1], fds[1], "short", ARRAYLEN(lost_levels), lost_levels, lost_msgs);
+    close(out_fds[1]);
+    close(fds[1]);
+    actual = _read_available(fds[0]);
+    close(fds[0]);
+    CU_ASSERT_PTR_NOT_NULL(strstr(actual, "Number of lost log lines: 3\n"));
+    BXIFREE(actual);
+    BXIFREE(oversized);
+
+    signal(SIGPIPE, old_handler);
+}
+
+void test_logger_many_filters(void) {
+    char * filename = strdup("/tmp/test_logger_filters.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    // As large rule sets are written: many prefixes, some of them overridden
+    const size_t subsystems_nb = 100;
+    bxilog_filters_p filters = bxilog_filters_new();
+    bxilog_filters_add(&filters, "", BXILOG_WARNING);
+    for (size_t i = 0; i < subsystems_nb; i++) {
+        char * prefix = bxistr_new("test.filters.sub%zu.", i);
+        bxilog_filters_add(&filters, prefix, (0 == i % 2) ? BXILOG_DEBUG : BXILOG_OFF);
+        BXIFREE(prefix);
+        prefix = bxistr_new("test.filters.sub%zu.noisy", i);
+        bxilog_filters_add(&filters, prefix, BXILOG_ERROR);
+        BXIFREE(prefix);
+    }
+    // The last matching filter wins
+    bxilog_filters_add(&filters, "test.filters.sub1.", BXILOG_DEBUG);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p loggers[4];
+    const char * names[] = {"test.filters.sub0.main",    // DEBUG
+                            "test.filters.sub3.main",    // OFF
+                            "test.filters.sub1.main",    // DEBUG (overridden)
+                            "test.filters.sub4.noisy",   // ERROR
+                           };
+    for (size_t i = 0; i < ARRAYLEN(names); i++) {
+        err = bxilog_registry_get(names[i], &loggers[i]);
+        bxierr_abort_ifko(err);
+    }
+    const size_t logs_nb = 100;
+    for (size_t i = 0; i < logs_nb; i++) {
+        for (size_t j = 0; j < ARRAYLEN(loggers); j++) {
+            DEBUG(loggers[j], "Filtered log %zu", i);
+            ERROR(loggers[j], "Filtered error %zu", i);
+        }
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.filters.sub0.main|Filtered "),
+                    2 * logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.filters.sub3.main|Filtered "), 0);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.filters.sub1.main|Filtered "),
+                    2 * logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.filters.sub4.noisy|Filtered log "), 0);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.filters.sub4.noisy|Filtered error "),
+                    logs_nb);
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_handlers_mask(void) {
+    char * debug_filename = strdup("/tmp/test_logger_mask.XXXXXX");
+    int fd = mkstemp(debug_filename);
+    bxiassert(0 < fd);
+    close(fd);
+    char * warning_filename = bxistr_new("%s.warning", debug_filename);
+
+    bxilog_filters_p debug_filters = bxilog_filters_new();
+    bxilog_filters_add(&debug_filters, "", BXILOG_OFF);
+    bxilog_filters_add(&debug_filters, "test.mask.debug", BXILOG_DEBUG);
+    bxilog_filters_p warning_filters = bxilog_filters_new();
+    bxilog_filters_add(&warning_filters, "", BXILOG_WARNING);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              debug_filters,
+                              PROGNAME, debug_filename, BXI_APPEND_OPEN_FLAGS);
+    bxilog_config_add_handler(config,
+                              BXILOG_NULL_HANDLER,
+                              BXILOG_FILTERS_ALL_OFF);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              warning_filters,
+                              PROGNAME, warning_filename, BXI_APPEND_OPEN_FLAGS);
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p debug_logger, other_logger;
+    err = bxilog_registry_get("test.mask.debug", &debug_logger);
+    bxierr_abort_ifko(err);
+    err = bxilog_registry_get("test.mask.other", &other_logger);
+    bxierr_abort_ifko(err);
+
+    // Each level is only sent to the handlers accepting it
+    CU_ASSERT_EQUAL(debug_logger->handlers[BXILOG_DEBUG], 0x1);
+    CU_ASSERT_EQUAL(debug_logger->handlers[BXILOG_WARNING], 0x5);
+    CU_ASSERT_EQUAL(debug_logger->handlers[BXILOG_FINE], 0x0);
+    CU_ASSERT_EQUAL(other_logger->handlers[BXILOG_DEBUG], 0x0);
+    CU_ASSERT_EQUAL(other_logger->handlers[BXILOG_WARNING], 0x4);
+
+    const size_t logs_nb = 100;
+    for (size_t i = 0; i < logs_nb; i++) {
+        DEBUG(debug_logger, "Masked debug %zu", i);
+        WARNING(debug_logger, "Masked warning %zu", i);
+        DEBUG(other_logger, "Masked debug %zu", i);
+        WARNING(other_logger, "Masked warning %zu", i);
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    CU_ASSERT_EQUAL(_count_lines(debug_filename, "|test.mask.debug|Masked "), 2 * logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(debug_filename, "|test.mask.other|"), 0);
+    CU_ASSERT_EQUAL(_count_lines(warning_filename, "|Masked warning "), 2 * logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(warning_filename, "|Masked debug "), 0);
+
+    unlink(debug_filename);
+    unlink(warning_filename);
+    BXIFREE(debug_filename);
+    BXIFREE(warning_filename);
+}
+
+void test_logger_handlers_beyond_mask(void) {
+    char * filename = strdup("/tmp/test_logger_beyond_mask.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    // Handlers filling the mask discard everything: only the last one, which has no
+    // bit in the mask, accepts logs
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    for (size_t i = 0; i < BXILOG__HANDLERS_MASK_BITS; i++) {
+        bxilog_config_add_handler(config,
+                                  BXILOG_NULL_HANDLER,
+                                  BXILOG_FILTERS_ALL_OFF);
+    }
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.mask.beyond", &logger);
+    bxierr_abort_ifko(err);
+    CU_ASSERT_EQUAL(logger->handlers[BXILOG_DEBUG], 0x0);
+
+    const size_t logs_nb = 100;
+    for (size_t i = 0; i < logs_nb; i++) {
+        DEBUG(logger, "Beyond debug %zu", i);
+    }
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    CU_ASSERT_EQUAL(_count_lines(filename, "|test.mask.beyond|Beyond debug "), logs_nb);
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_set_filters(void) {
+    char * filename = strdup("/tmp/test_logger_set_filters.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    // Parsed in place
+    char output_format[] = ":output";
+    char debug_format[] = ":output,test.set:debug";
+    char after_format[] = ":output";
+    char unknown_format[] = ":output";
+
+    bxilog_filters_p filters;
+    bxierr_p err = bxilog_filters_parse(output_format, &filters);
+    bxierr_abort_ifko(err);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.set.filters", &logger);
+    bxierr_abort_ifko(err);
+    CU_ASSERT_EQUAL(logger->handlers[BXILOG_DEBUG], 0x0);
+
+    const size_t logs_nb = 100;
+    for (size_t i = 0; i < logs_nb; i++) {
+        DEBUG(logger, "Debug before %zu", i);
+    }
+
+    // Raise the verbosity of the running handler
+    err = bxilog_filters_parse(debug_format, &filters);
+    bxierr_abort_ifko(err);
+    err = bxilog_set_filters(0, filters);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    CU_ASSERT_EQUAL(logger->handlers[BXILOG_DEBUG], 0x1);
+    CU_ASSERT_EQUAL(logger->level, BXILOG_DEBUG);
+    for (size_t i = 0; i < logs_nb; i++) {
+        DEBUG(logger, "Debug during %zu", i);
+        OUT(logger, "Output during %zu", i);
+    }
+
+    // And lower it back
+    err = bxilog_filters_parse(after_format, &filters);
+    bxierr_abort_ifko(err);
+    err = bxilog_set_filters(0, filters);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    CU_ASSERT_EQUAL(logger->handlers[BXILOG_DEBUG], 0x0);
+    CU_ASSERT_EQUAL(logger->handlers[BXILOG_OUTPUT], 0x1);
+    CU_ASSERT_EQUAL(logger->level, BXILOG_OUTPUT);
+    for (size_t i = 0; i < logs_nb; i++) {
+        DEBUG(logger, "Debug after %zu", i);
+    }
+
+    // Unknown handler
+    err = bxilog_filters_parse(unknown_format, &filters);
+    bxierr_abort_ifko(err);
+    err = bxilog_set_filters(1, filters);
+    CU_ASSERT_TRUE(bxierr_isko(err));
+    bxierr_destroy(&err);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    CU_ASSERT_EQUAL(_count_lines(filename, "|Debug before "), 0);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|Debug during "), logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|Output during "), logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|Debug after "), 0);
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+void test_logger_limit(void) {
+    char * filename = strdup("/tmp/test_logger_limit.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              BXILOG_FILTERS_ALL_ALL,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    const size_t logs_nb = 1000;
+    for (size_t round = 0; round < 2; round++) {
+        for (size_t i = 0; i < logs_nb; i++) {
+            BXILOG_SAMPLE(TEST_LOGGER, BXILOG_OUTPUT, 10, "Sampled %zu", i);
+            BXILOG_LIMIT(TEST_LOGGER, BXILOG_OUTPUT, 5, "Limited %zu", i);
+            BXILOG_BURST(TEST_LOGGER, BXILOG_OUTPUT, 1, 3, "Burst %zu", i);
+        }
+        // Let the windows reopen
+        struct timespec delay = {1, 100000000};
+        if (0 == round) nanosleep(&delay, NULL);
+    }
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    CU_ASSERT_EQUAL(_count_lines(filename, "|Sampled "), 2 * logs_nb / 10);
+    // Each round may span two windows
+    const size_t limited = _count_lines(filename, "|Limited ");
+    CU_ASSERT_TRUE(2 * 5 <= limited && limited <= 4 * 5);
+    // The burst, then one log per second
+    const size_t burst = _count_lines(filename, "|Burst ");
+    CU_ASSERT_TRUE(3 + 1 <= burst && burst <= 3 + 3);
+    // Reported by both call sites once their window reopens
+    CU_ASSERT_TRUE(2 <= _count_lines(filename, "similar logs suppressed"));
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+static void * _pool_thread(void * data) {
+    const size_t logs_nb = *(size_t *) data;
+    for (size_t i = 0; i < logs_nb; i++) {
+        OUT(TEST_LOGGER, "Pool thread %zu", i);
+    }
+    return NULL;
+}
+
+void test_logger_pool(void) {
+    char * filename = strdup("/tmp/test_logger_pool.XXXXXX");
+    int fd = mkstemp(filename);
+    bxiassert(0 < fd);
+    close(fd);
+
+    // Parsed in place
+    char filters_format[] = ":output,~bxilog.tsd:debug";
+    bxilog_filters_p filters;
+    bxierr_p err = bxilog_filters_parse(filters_format, &filters);
+    bxierr_abort_ifko(err);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_FILE_HANDLER,
+                              filters,
+                              PROGNAME, filename, BXI_APPEND_OPEN_FLAGS);
+    err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    // Flushing after each log bounds the number of records in flight:
+    // once the pool has grown, records are all taken from it
+    const size_t logs_nb = 100;
+    bxilog__pool_stats_s before, after;
+    for (size_t round = 0; round < 2; round++) {
+        for (size_t i = 0; i < logs_nb; i++) {
+            OUT(TEST_LOGGER, "Pool log %zu", i);
+            err = bxilog_flush();
+            CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        }
+        tsd_p tsd;
+        err = bxilog__tsd_get(&tsd);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        bxilog__pool_stats(tsd->pool, 0 == round ? &before : &after);
+    }
+    CU_ASSERT_EQUAL(after.misses, before.misses);
+    CU_ASSERT_TRUE(after.hits >= before.hits + logs_nb);
+    CU_ASSERT_EQUAL(after.peak, before.peak);
+
+    // Statistics are reported when a thread exits
+    pthread_t thread;
+    int rc = pthread_create(&thread, NULL, _pool_thread, (void *) &logs_nb);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+    rc = pthread_join(thread, NULL);
+    CU_ASSERT_EQUAL_FATAL(rc, 0);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    CU_ASSERT_EQUAL(_count_lines(filename, "|Pool log "), 2 * logs_nb);
+    CU_ASSERT_EQUAL(_count_lines(filename, "|Pool thread "), logs_nb);
+    CU_ASSERT_TRUE(1 <= _count_lines(filename, "|Thread exit: "));
+
+    unlink(filename);
+    BXIFREE(filename);
+}
+
+typedef struct {
+    int fd;
+    size_t received_nb;
+    size_t matching_nb;
+    bool header_ok;
+} syslog_receiver_s;
+
+// Stands for the syslog daemon
+static void * _syslog_receiver(syslog_receiver_s * receiver) {
+    char buf[BXILOG_SYSLOG_HANDLER_MSG_MAX + 1];
+    while (true) {
+        ssize_t n = recv(receiver->fd, buf, sizeof(buf) - 1, 0);
+        if (0 >= n) break;
+        buf[n] = '\0';
+        receiver->received_nb++;
+        if (NULL != strstr(buf, "Syslog end")) break;
+        if (NULL == strstr(buf, "Syslog log ")) continue;
+        receiver->matching_nb++;
+        // <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID - MSG
+        if (0 != strncmp(buf, "<", 1)
+            || NULL == strstr(buf, ">1 ")
+            || NULL == strstr(buf, " test.syslog.native - Syslog log ")) {
+            receiver->header_ok = false;
+        }
+    }
+    return NULL;
+}
+
+void test_logger_syslog_native(void) {
+    char * dirname = strdup("/tmp/test_logger_syslog.XXXXXX");
+    bxiassert(NULL != mkdtemp(dirname));
+    char * path = bxistr_new("%s/log", dirname);
+
+    syslog_receiver_s receiver = {.fd = -1, .received_nb = 0,
+                                  .matching_nb = 0, .header_ok = true};
+    receiver.fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    bxiassert(-1 != receiver.fd);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    int rc = bind(receiver.fd, (struct sockaddr *) &addr, sizeof(addr));
+    bxiassert(0 == rc);
+    // Do not wait forever for lost messages
+    struct timeval timeout = {.tv_sec = 10, .tv_usec = 0};
+    rc = setsockopt(receiver.fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    bxiassert(0 == rc);
+
+    pthread_t thread;
+    rc = pthread_create(&thread, NULL,
+                        (void * (*) (void *)) _syslog_receiver, &receiver);
+    bxiassert(0 == rc);
+
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              BXILOG_SYSLOG_HANDLER,
+                              BXILOG_FILTERS_ALL_OUTPUT,
+                              PROGNAME, LOG_PID, LOG_LOCAL0);
+    bxilog_handler_param_p param = config->handlers_params[config->handlers_nb - 1];
+    bxilog_syslog_handler_set_native(param, BXILOG_SYSLOG_HANDLER_RFC5424, path, 0);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.syslog.native", &logger);
+    bxierr_abort_ifko(err);
+
+    // Far more than the daemon socket queue can hold
+    const size_t logs_nb = 5000;
+    for (size_t i = 0; i < logs_nb; i++) {
+        OUT(logger, "Syslog log %zu", i);
+    }
+    OUT(logger, "Syslog end");
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    rc = pthread_join(thread, NULL);
+    bxiassert(0 == rc);
+    CU_ASSERT_EQUAL(receiver.matching_nb, logs_nb);
+    CU_ASSERT_TRUE(receiver.header_ok);
+
+    close(receiver.fd);
+    unlink(path);
+    rmdir(dirname);
+    BXIFREE(path);
+    BXIFREE(dirname);
+}
+
+static size_t BATCH_RECORDS_NB = 0;
+static size_t BATCH_MAX_NB = 0;
+
+static bxilog_handler_param_p _test_param_new(bxilog_handler_p self,
+                                              bxilog_filters_p filters,
+                                              va_list ap) {
+    UNUSED(ap);
+    bxilog_handler_param_p result = bximem_calloc(sizeof(*result));
+    bxilog_handler_init_param(self, filters, result);
+
+    return result;
+}
+
+static bxierr_p _test_noop(bxilog_handler_param_p param) {
+    UNUSED(param);
+    return BXIERR_OK;
+}
+
+static bxierr_p _test_process_ierr(bxierr_p * err, bxilog_handler_param_p param) {
+    UNUSED(err);
+    UNUSED(param);
+    return BXIERR_OK;
+}
+
+static bxierr_p _batch_process_log_batch(bxilog_batch_record_s * records, size_t n,
+                                         bxilog_handler_param_p param) {
+    UNUSED(param);
+    CU_ASSERT_TRUE(0 < n && n <= BXILOG_HANDLER_BATCH_MAX);
+    for (size_t i = 0; i < n; i++) {
+        CU_ASSERT_PTR_NOT_NULL(strstr(records[i].logmsg, "Batch log"));
+        CU_ASSERT_STRING_EQUAL(records[i].loggername, "test.batch");
+    }
+    BATCH_RECORDS_NB += n;
+    if (n > BATCH_MAX_NB) BATCH_MAX_NB = n;
+
+    return BXIERR_OK;
+}
+
+static bxierr_p _test_param_destroy(bxilog_handler_param_p * param_p) {
+    bxilog_handler_clean_param(*param_p);
+    bximem_destroy((char**) param_p);
+    return BXIERR_OK;
+}
+
+static const bxilog_handler_s BATCH_HANDLER_S = {
+                  .name = "Test Batch Handler",
+                  .param_new = _test_param_new,
+                  .init = _test_noop,
+                  .process_ierr = _test_process_ierr,
+                  .process_implicit_flush = _test_noop,
+                  .process_explicit_flush = _test_noop,
+                  .process_exit = _test_noop,
+                  .process_cfg = _test_noop,
+                  .param_destroy = _test_param_destroy,
+                  .process_log_batch = _batch_process_log_batch,
+};
+
+void test_logger_batch(void) {
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    bxilog_config_add_handler(config,
+                              (bxilog_handler_p) &BATCH_HANDLER_S,
+                              BXILOG_FILTERS_ALL_ALL);
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.batch", &logger);
+    bxierr_abort_ifko(err);
+
+    BATCH_RECORDS_NB = 0;
+    BATCH_MAX_NB = 0;
+    const size_t n = 10 * BXILOG_HANDLER_BATCH_MAX;
+    for (size_t i = 0; i < n; i++) {
+        OUT(logger, "Batch log %zu", i);
+    }
+
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // All records are given exactly once, whatever the batches actually were
+    CU_ASSERT_EQUAL(BATCH_RECORDS_NB, n);
+    CU_ASSERT_TRUE(0 < BATCH_MAX_NB && BATCH_MAX_NB <= BXILOG_HANDLER_BATCH_MAX);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
+static size_t OVERFLOW_PROCESSED_NB = 0;
+static size_t OVERFLOW_REPORTS_NB = 0;
+static bool OVERFLOW_RELEASED = false;
+
+static bxierr_p _overflow_process_log(bxilog_record_p record,
+                                      char * filename,
+                                      char * funcname,
+                                      char * loggername,
+                                      char * logmsg,
+                                      bxilog_handler_param_p param) {
+    UNUSED(record);
+    UNUSED(filename);
+    UNUSED(funcname);
+    UNUSED(logmsg);
+    UNUSED(param);
+
+    if (NULL != strstr(loggername, "bxilog.overflow")) {
+        OVERFLOW_REPORTS_NB++;
+        return BXIERR_OK;
+    }
+    if (0 != strcmp(loggername, "test.overflow")) return BXIERR_OK;
+
+    // Simulate a stuck handler until all logs have been produced
+    while (!__atomic_load_n(&OVERFLOW_RELEASED, __ATOMIC_ACQUIRE)) {
+        bxierr_p err = bxitime_sleep(CLOCK_MONOTONIC, 0, 1000000);
+        bxierr_destroy(&err);
+    }
+    OVERFLOW_PROCESSED_NB++;
+
+    return BXIERR_OK;
+}
+
+static const bxilog_handler_s OVERFLOW_HANDLER_S = {
+                  .name = "Test Overflow Handler",
+                  .param_new = _test_param_new,
+                  .init = _test_noop,
+                  .process_log = _overflow_process_log,
+                  .process_ierr = _test_process_ierr,
+                  .process_implicit_flush = _test_noop,
+                  .process_explicit_flush = _test_noop,
+                  .process_exit = _test_noop,
+                  .process_cfg = _test_noop,
+                  .param_destroy = _test_param_destroy,
+};
+
+void test_logger_overflow(void) {
+    bxilog_config_p config = bxilog_config_new(PROGNAME);
+    config->transport = BXILOG_TRANSPORT_RING;
+    config->ring_size = 4;
+    bxilog_config_add_handler(config,
+                              (bxilog_handler_p) &OVERFLOW_HANDLER_S,
+                              BXILOG_FILTERS_ALL_ALL);
+    bxilog_handler_param_p param = config->handlers_params[0];
+    param->overflow_policy = BXILOG_OVERFLOW_DROP_NEWEST;
+
+    bxierr_p err = bxilog_init(config);
+    bxierr_report(&err, STDERR_FILENO);
+    CU_ASSERT_TRUE_FATAL(bxilog_is_ready());
+
+    bxilog_logger_p logger;
+    err = bxilog_registry_get("test.overflow", &logger);
+    bxierr_abort_ifko(err);
+
+    OVERFLOW_PROCESSED_NB = 0;
+    OVERFLOW_REPORTS_NB = 0;
+    __atomic_store_n(&OVERFLOW_RELEASED, false, __ATOMIC_RELEASE);
+
+    // The handler is stuck: the logging thread must not be
+    const size_t n = 100;
+    for (size_t i = 0; i < n; i++) {
+        OUT(logger, "Overflow log %zu", i);
+    }
+    __atomic_store_n(&OVERFLOW_RELEASED, true, __ATOMIC_RELEASE);
+
+    err = bxilog_flush();
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+
+    // Drop counts are exact
+    const size_t dropped = __atomic_load_n(&param->dropped_nb, __ATOMIC_RELAXED);
+    CU_ASSERT_TRUE(0 < dropped);
+    CU_ASSERT_EQUAL(OVERFLOW_PROCESSED_NB + dropped, n);
+    CU_ASSERT_EQUAL(param->spilled_nb, 0);
+    // And reported
+    CU_ASSERT_TRUE(0 < OVERFLOW_REPORTS_NB);
+
+    err = bxilog_finalize(true);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+}
+
 void test_handlers(void) {
     bxilog_config_p config = bxilog_config_new(PROGNAME);
 
@@ -34,3 +34,25 @@ void test_time(void) {
     CU_ASSERT_PTR_NOT_NULL_FATAL(time_char);
     free(time_char);
 }
+
+void test_time_fast(void) {
+    bxitime_tsc_calib_s calib;
+    bxierr_p err = bxitime_tsc_calibrate(&calib);
+    CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+    CU_ASSERT_TRUE(calib.ns_per_tick > 0);
+
+    const bxitime_source_e sources[] = {BXITIME_SOURCE_REALTIME,
+                                        BXITIME_SOURCE_REALTIME_COARSE,
+                                        BXITIME_SOURCE_TSC};
+    for (size_t i = 0; i < sizeof(sources) / sizeof(*sources); i++) {
+        struct timespec ref, fast;
+        err = bxitime_get(CLOCK_REALTIME, &ref);
+        CU_ASSERT_TRUE_FATAL(bxierr_isok(err));
+        bxitime_fast_get(sources[i], &calib, &fast);
+        double delta = (double) (fast.tv_sec - ref.tv_sec) +
+                       (double) (fast.tv_nsec - ref.tv_nsec) * 1e-9;
+        // Coarse clocks may lag by a few ms
+        CU_ASSERT_TRUE(-0.05 < delta && delta < 0.05);
+        CU_ASSERT_TRUE(0 <= fast.tv_nsec && fast.tv_nsec < 1000000000);
+    }
+}
@@ -58,9 +58,12 @@ void test_bxistr_hex(void);
 // From test_err.c
 void test_bxierr(void);
 void test_bxierr_chain(void);
+void test_bxierr_static(void);
+void test_bxierr_backtrace(void);
 
 // From test_time.c
 void test_time(void);
+void test_time_fast(void);
 
 // From test_zmq.c
 void test_bxizmq_generate_url(void);
@@ -79,6 +82,7 @@ void test_logger_fork(void);
 void test_logger_signal(void);
 void test_single_logger_instance(void);
 void test_registry(void);
+void test_registry_many_loggers(void);
 void test_filters_parser(void);
 void test_filter_merge_same(void);
 void test_filter_merge_distinct(void);
@@ -89,6 +93,28 @@ void test_filters_simple(void);
 void test_filters_symetric(void);
 void test_filters_complex(void);
 void test_logger_threads(void);
+void test_logger_ring_transport(void);
+void test_logger_deferred_formatting(void);
+void test_logger_call_site(void);
+void test_logger_file_io(void);
+void test_logger_binary_file(void);
+void test_logger_file_mmap(void);
+void test_logger_file_mmap_fallback(void);
+void test_logger_file_format(void);
+void test_logger_console(void);
+void test_logger_file_rotation(void);
+void test_logger_file_compressed(void);
+void test_logger_file_durability(void);
+void test_logger_file_routes(void);
+void test_logger_syslog_native(void);
+void test_logger_many_filters(void);
+void test_logger_handlers_mask(void);
+void test_logger_handlers_beyond_mask(void);
+void test_logger_set_filters(void);
+void test_logger_limit(void);
+void test_logger_pool(void);
+void test_logger_batch(void);
+void test_logger_overflow(void);
 void test_handlers(void);
 void test_very_long_log(void);
 void test_strange_log(void);
@@ -231,6 +257,10 @@ int main(int argc, char * argv[]) {
                 || (NULL == CU_add_test(bxierr_suite, "test bxierr", test_bxierr))
                 || (NULL == CU_add_test(bxierr_suite,
                                         "test bxierr_chain", test_bxierr_chain))
+                || (NULL == CU_add_test(bxierr_suite,
+                                        "test bxierr_static", test_bxierr_static))
+                || (NULL == CU_add_test(bxierr_suite,
+                                        "test bxierr_backtrace", test_bxierr_backtrace))
                                         || false) {
             CU_cleanup_registry();
             return (CU_get_error());
@@ -249,6 +279,7 @@ int main(int argc, char * argv[]) {
         /* add the tests to the suite */
         if (false
                 || (NULL == CU_add_test(bxitime_suite, "test time", test_time))
+                || (NULL == CU_add_test(bxitime_suite, "test time fast", test_time_fast))
                 || false) {
             CU_cleanup_registry();
             return (CU_get_error());
@@ -296,6 +327,7 @@ int main(int argc, char * argv[]) {
         || (NULL == CU_add_test(bxilog_suite, "test strange log", test_strange_log))
         || (NULL == CU_add_test(bxilog_suite, "test single logger instance", test_single_logger_instance))
         || (NULL == CU_add_test(bxilog_suite, "test logger registry", test_registry))
+        || (NULL == CU_add_test(bxilog_suite, "test logger registry many loggers", test_registry_many_loggers))
         || (NULL == CU_add_test(bxilog_suite, "test logger filters parser", test_filters_parser))
         || (NULL == CU_add_test(bxilog_suite, "test logger filters same", test_filters_same))
         || (NULL == CU_add_test(bxilog_suite, "test logger filters distinct", test_filters_distinct))
@@ -304,6 +336,29 @@ int main(int argc, char * argv[]) {
         || (NULL == CU_add_test(bxilog_suite, "test logger filters complex", test_filters_complex))
         || (NULL == CU_add_test(bxilog_suite, "test handlers", test_handlers))
         || (NULL == CU_add_test(bxilog_suite, "test logger threads", test_logger_threads))
+        || (NULL == CU_add_test(bxilog_suite, "test logger ring transport", test_logger_ring_transport))
+        || (NULL == CU_add_test(bxilog_suite, "test logger deferred formatting",
+                                test_logger_deferred_formatting))
+        || (NULL == CU_add_test(bxilog_suite, "test logger call site", test_logger_call_site))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file io", test_logger_file_io))
+        || (NULL == CU_add_test(bxilog_suite, "test logger binary file", test_logger_binary_file))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file mmap", test_logger_file_mmap))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file mmap fallback", test_logger_file_mmap_fallback))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file format", test_logger_file_format))
+        || (NULL == CU_add_test(bxilog_suite, "test logger console", test_logger_console))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file rotation", test_logger_file_rotation))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file compressed", test_logger_file_compressed))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file durability", test_logger_file_durability))
+        || (NULL == CU_add_test(bxilog_suite, "test logger file routes", test_logger_file_routes))
+        || (NULL == CU_add_test(bxilog_suite, "test logger syslog native", test_logger_syslog_native))
+        || (NULL == CU_add_test(bxilog_suite, "test logger many filters", test_logger_many_filters))
+        || (NULL == CU_add_test(bxilog_suite, "test logger handlers mask", test_logger_handlers_mask))
+        || (NULL == CU_add_test(bxilog_suite, "test logger handlers beyond mask", test_logger_handlers_beyond_mask))
+        || (NULL == CU_add_test(bxilog_suite, "test logger set filters", test_logger_set_filters))
+        || (NULL == CU_add_test(bxilog_suite, "test logger limit", test_logger_limit))
+        || (NULL == CU_add_test(bxilog_suite, "test logger pool", test_logger_pool))
+        || (NULL == CU_add_test(bxilog_suite, "test logger batch", test_logger_batch))
+        || (NULL == CU_add_test(bxilog_suite, "test logger overflow", test_logger_overflow))
         || (NULL == CU_add_test(bxilog_suite, "test logger fork", test_logger_fork))
 //        || (NULL == CU_add_test(bxilog_suite, "test logger signal", test_logger_signal))
 